@@ -0,0 +1,36 @@
+#ifndef ANIMATION_CONTROL_HPP_INCLUDED
+#define ANIMATION_CONTROL_HPP_INCLUDED
+
+#include <renderer.hpp>
+
+#include <QWidget>
+#include <QLabel>
+#include <QCheckBox>
+#include <QDoubleSpinBox>
+#include <QPushButton>
+
+class AnimationControl : public QWidget
+{
+public:
+	AnimationControl(QWidget *parent, Renderer *renderer);
+
+	void timespin_valueChanged(double time);
+	void setKey_clicked();
+	void removeKey_clicked();
+	void clearKeys_clicked();
+	void play_stateChanged(int state);
+	void updateKeysLabel();
+
+private:
+	QLabel *titlelabel_;
+	QLabel *timelabel_;
+	QDoubleSpinBox *timespin_;
+	QPushButton *setKeybtn_;
+	QPushButton *removeKeybtn_;
+	QPushButton *clearKeysbtn_;
+	QCheckBox *playchk_;
+	QLabel *keyslabel_;
+	Renderer *renderer_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,55 @@
+#ifndef ANIMATION_RENDERER_HPP_INCLUDED
+#define ANIMATION_RENDERER_HPP_INCLUDED
+
+#include <QSize>
+#include <QString>
+
+#include <patch_animation.hpp>
+
+#include <functional>
+
+class FergusonPatch;
+
+// Renders an animation offline into numbered PNGs as a three stage pipeline:
+// worker threads tessellate frames ahead into snapshots, the calling thread
+// draws them in order and reads them back through a FrameCapture, and a pool
+// of encoders writes the images. Every stage runs concurrently with the others.
+class AnimationRenderer
+{
+public:
+	// called on the rendering thread after each frame is drawn
+	using Progress = std::function<void(unsigned int frame, unsigned int frames)>;
+
+	AnimationRenderer(const FergusonPatch &patch, const PatchAnimation &animation, QSize size, float fps);
+
+	float  lineWidth() const { return lineWidth_; }
+	void   lineWidth(float val) { lineWidth_ = val; }
+
+	int  samples() const { return samples_; }
+	void samples(int val) { samples_ = val; }
+
+	// threads for each of the CPU stages, hardware threads by default
+	unsigned int  threads() const { return threads_; }
+	void          threads(unsigned int val) { threads_ = val; }
+
+	void onProgress(Progress progress) { progress_ = progress; }
+
+	// one frame per 1/fps seconds up to the animation's duration
+	unsigned int frames() const;
+
+	// must be called with a context current; the patch must not change until
+	// it returns. Writes directory/frame_00000.png and onwards.
+	bool render(const QString &directory);
+
+private:
+	const FergusonPatch &patch_;
+	const PatchAnimation &animation_;
+	QSize size_;
+	float fps_;
+	float lineWidth_;
+	int samples_;
+	unsigned int threads_;
+	Progress progress_;
+};
+
+#endif
\ No newline at end of file
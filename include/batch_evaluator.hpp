@@ -0,0 +1,86 @@
+#ifndef BATCH_EVALUATOR_HPP_INCLUDED
+#define BATCH_EVALUATOR_HPP_INCLUDED
+
+#include <QIODevice>
+
+#include <cstdint>
+#include <vector>
+
+#include <ferguson_geometry.hpp>
+
+// Evaluates Ferguson patches at a stream of (patch, u, v) samples. The
+// input is read in chunks of constant size; each chunk is cut into slices
+// that are parsed, evaluated and formatted on all cores, then written in
+// input order while the next chunk is being read. Memory does not depend
+// on the length of the stream.
+//
+// Text samples are lines of "u v" (patch 0) or "patch u v"; blank lines and
+// lines starting with # are skipped. Binary samples are records of a 32 bit
+// patch index and two 32 bit floats, in host byte order.
+//
+// Text output has one line per sample, "x y" or "x y xu yu xv yv" with the
+// derivatives; binary output has two or six 32 bit floats per sample.
+class BatchEvaluator
+{
+public:
+	enum class Format { Text, Binary };
+
+	BatchEvaluator(std::vector<FergusonGeometry> patches);
+
+	// reads patches from whitespace separated numbers, 24 per patch in the
+	// order p0 p1 p2 p3 t01 t10 t13 t31 t23 t32 t02 t20, x before y; # starts
+	// a comment running to the end of the line
+	static bool readPatches(QIODevice &in, std::vector<FergusonGeometry> &patches);
+
+	Format  inputFormat() const { return inputFormat_; }
+	Format &inputFormat() { return inputFormat_; }
+	void    inputFormat(Format val) { inputFormat_ = val; }
+
+	Format  outputFormat() const { return outputFormat_; }
+	Format &outputFormat() { return outputFormat_; }
+	void    outputFormat(Format val) { outputFormat_ = val; }
+
+	// also write su and sv
+	bool  derivatives() const { return derivatives_; }
+	bool &derivatives() { return derivatives_; }
+	void  derivatives(bool val) { derivatives_ = val; }
+
+	// bytes of input per chunk, also the longest text line accepted
+	std::size_t  chunkSize() const { return chunkSize_; }
+	std::size_t &chunkSize() { return chunkSize_; }
+	void         chunkSize(std::size_t val) { chunkSize_ = val; }
+
+	// Evaluates every sample of in into out. Fails on a malformed sample or
+	// a patch index out of range, having written the chunks before it, or
+	// when out cannot be written.
+	bool run(QIODevice &in, QIODevice &out);
+
+	// samples evaluated by the last run
+	std::uint64_t evaluated() const { return evaluated_; }
+
+private:
+	struct Slice
+	{
+		const char *begin;
+		const char *end;
+		std::vector<char> output;
+		std::size_t samples;
+		bool ok;
+	};
+
+	// cuts [begin, end) into slices of whole lines or records
+	void slice(const char *begin, const char *end, std::vector<Slice> &slices) const;
+	void evaluate(Slice &slice) const;
+
+	bool evaluate(std::uint32_t patch, float u, float v, std::vector<char> &out) const;
+
+private:
+	std::vector<FergusonGeometry> patches_;
+	Format inputFormat_;
+	Format outputFormat_;
+	bool derivatives_;
+	std::size_t chunkSize_;
+	std::uint64_t evaluated_;
+};
+
+#endif
\ No newline at end of file
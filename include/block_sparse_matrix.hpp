@@ -0,0 +1,202 @@
+#ifndef BLOCK_SPARSE_MATRIX_HPP_INCLUDED
+#define BLOCK_SPARSE_MATRIX_HPP_INCLUDED
+
+#include <parallel_for.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Symmetric matrix of B x B blocks with a fixed, symmetric sparsity pattern,
+// stored as compressed block rows. Solves with conjugate gradients
+// preconditioned by the inverses of the diagonal blocks.
+template <std::size_t B>
+class BlockSparseMatrix
+{
+public:
+	using Block = std::array<double, B*B>;
+
+	// columns[i] lists the block columns present in block row i
+	void setPattern(const std::vector<std::vector<std::size_t>> &columns)
+	{
+		rowStart_.assign(1, 0);
+		columns_.clear();
+		diagonal_.clear();
+
+		for (std::size_t i = 0; i < columns.size(); ++i) {
+			std::vector<std::size_t> row = columns[i];
+			std::sort(row.begin(), row.end());
+			row.erase(std::unique(row.begin(), row.end()), row.end());
+
+			diagonal_.push_back(columns_.size() + (std::lower_bound(row.begin(), row.end(), i) - row.begin()));
+			columns_.insert(columns_.end(), row.begin(), row.end());
+			rowStart_.push_back(columns_.size());
+		}
+
+		blocks_.assign(columns_.size(), Block());
+	}
+
+	std::size_t rows() const { return diagonal_.size(); }
+	std::size_t size() const { return rows() * B; }
+
+	void setZero() { std::fill(blocks_.begin(), blocks_.end(), Block()); }
+
+	// the block must be part of the pattern
+	Block &block(std::size_t row, std::size_t column)
+	{
+		auto begin = columns_.begin() + rowStart_[row], end = columns_.begin() + rowStart_[row+1];
+		return blocks_[std::lower_bound(begin, end, column) - columns_.begin()];
+	}
+
+	Block       &diagonal(std::size_t row) { return blocks_[diagonal_[row]]; }
+	const Block &diagonal(std::size_t row) const { return blocks_[diagonal_[row]]; }
+
+	// fixes unknown component of block row at zero: clears its row and
+	// column and puts a one on the diagonal
+	void constrain(std::size_t row, std::size_t component)
+	{
+		for (std::size_t k = rowStart_[row]; k < rowStart_[row+1]; ++k) {
+			Block &rowBlock = blocks_[k];
+			Block &columnBlock = block(columns_[k], row);
+			for (std::size_t j = 0; j < B; ++j) {
+				rowBlock[component*B + j] = 0.0;
+				columnBlock[j*B + component] = 0.0;
+			}
+		}
+		diagonal(row)[component*B + component] = 1.0;
+	}
+
+	void multiply(const std::vector<double> &x, std::vector<double> &y) const
+	{
+		y.resize(size());
+		parallelFor(rows(), [&](std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i) {
+				double sum[B] = {};
+				for (std::size_t k = rowStart_[i]; k < rowStart_[i+1]; ++k) {
+					const Block &a = blocks_[k];
+					const double *xj = &x[columns_[k] * B];
+					for (std::size_t r = 0; r < B; ++r)
+						for (std::size_t c = 0; c < B; ++c)
+							sum[r] += a[r*B + c] * xj[c];
+				}
+				std::copy(sum, sum + B, &y[i * B]);
+			}
+		}, 64);
+	}
+
+	// Solves A x = b starting from x, until the residual norm drops below
+	// tolerance times that of b. Returns the iterations taken.
+	unsigned int solve(const std::vector<double> &b, std::vector<double> &x,
+		unsigned int maxIterations, double tolerance) const
+	{
+		const std::size_t n = size();
+		x.resize(n, 0.0);
+
+		// block Jacobi preconditioner, one Cholesky factor per diagonal block
+		std::vector<Block> factors(rows());
+		parallelFor(rows(), [&](std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i)
+				factors[i] = cholesky(diagonal(i));
+		}, 64);
+
+		auto precondition = [&](const std::vector<double> &r, std::vector<double> &z) {
+			z.resize(n);
+			parallelFor(rows(), [&](std::size_t begin, std::size_t end) {
+				for (std::size_t i = begin; i < end; ++i)
+					solveCholesky(factors[i], &r[i*B], &z[i*B]);
+			}, 256);
+		};
+
+		std::vector<double> r(n), z, p, q;
+		multiply(x, q);
+		for (std::size_t i = 0; i < n; ++i)
+			r[i] = b[i] - q[i];
+
+		double target = tolerance * tolerance * dot(b, b);
+		precondition(r, z);
+		p = z;
+		double rz = dot(r, z);
+
+		unsigned int iteration = 0;
+		while (iteration < maxIterations && dot(r, r) > target) {
+			multiply(p, q);
+			double pq = dot(p, q);
+			if (pq <= 0.0)
+				break;
+
+			double alpha = rz / pq;
+			for (std::size_t i = 0; i < n; ++i) {
+				x[i] += alpha * p[i];
+				r[i] -= alpha * q[i];
+			}
+
+			precondition(r, z);
+			double next = dot(r, z);
+			double beta = next / rz;
+			rz = next;
+			for (std::size_t i = 0; i < n; ++i)
+				p[i] = z[i] + beta * p[i];
+
+			++iteration;
+		}
+
+		return iteration;
+	}
+
+private:
+	static double dot(const std::vector<double> &a, const std::vector<double> &b)
+	{
+		double sum = 0.0;
+		for (std::size_t i = 0; i < a.size(); ++i)
+			sum += a[i] * b[i];
+		return sum;
+	}
+
+	// lower triangular L with A = L L^T; non-positive pivots are replaced so
+	// that a singular block only weakens the preconditioner
+	static Block cholesky(const Block &a)
+	{
+		Block l = Block();
+		for (std::size_t j = 0; j < B; ++j) {
+			double d = a[j*B + j];
+			for (std::size_t k = 0; k < j; ++k)
+				d -= l[j*B + k] * l[j*B + k];
+			l[j*B + j] = d > 1e-12 ? std::sqrt(d) : 1.0;
+
+			for (std::size_t i = j + 1; i < B; ++i) {
+				double s = a[i*B + j];
+				for (std::size_t k = 0; k < j; ++k)
+					s -= l[i*B + k] * l[j*B + k];
+				l[i*B + j] = d > 1e-12 ? s / l[j*B + j] : 0.0;
+			}
+		}
+		return l;
+	}
+
+	static void solveCholesky(const Block &l, const double *b, double *x)
+	{
+		double y[B];
+		for (std::size_t i = 0; i < B; ++i) {
+			double s = b[i];
+			for (std::size_t k = 0; k < i; ++k)
+				s -= l[i*B + k] * y[k];
+			y[i] = s / l[i*B + i];
+		}
+		for (std::size_t i = B; i-- > 0; ) {
+			double s = y[i];
+			for (std::size_t k = i + 1; k < B; ++k)
+				s -= l[k*B + i] * x[k];
+			x[i] = s / l[i*B + i];
+		}
+	}
+
+private:
+	std::vector<std::size_t> rowStart_;
+	std::vector<std::size_t> columns_;
+	std::vector<std::size_t> diagonal_;
+	std::vector<Block> blocks_;
+};
+
+#endif
\ No newline at end of file
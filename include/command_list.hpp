@@ -0,0 +1,84 @@
+#ifndef COMMAND_LIST_HPP_INCLUDED
+#define COMMAND_LIST_HPP_INCLUDED
+
+#include <QOpenGLFunctions_3_2_Core>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QVector2D>
+#include <QVector3D>
+
+#include <vector>
+
+#include <grid_index_buffer.hpp>
+
+// One draw call together with the state it needs. Packets are drawn in
+// layer order; within a layer they are free to be reordered by state.
+struct DrawPacket
+{
+	enum Layer : unsigned int { Fill, Grid, Highlight, Curves, Handles, Overlay };
+
+	unsigned int layer = Curves;
+	QOpenGLShaderProgram *shader = nullptr;
+	// a VertexArena's, shared by every drawing of the same vertex layout
+	QOpenGLVertexArrayObject *vao = nullptr;
+
+	// shader uniforms
+	QVector2D offset = QVector2D(0.f, 0.f);
+	QVector2D scale = QVector2D(1.f, 1.f);
+	QVector3D colour;
+
+	GLenum mode = GL_LINE_STRIP;
+	// vertex range, or when given indices a range of them drawn with
+	// primitive restart, each offset by baseVertex
+	GridIndexBuffer *indices = nullptr;
+	GLint baseVertex = 0;
+	GLint first = 0;
+	GLsizei count = 0;
+};
+
+// Packets recorded by every drawing, kept between frames. Submitting sorts
+// them by state once after a change and merges packets sharing the same
+// state into glMultiDrawArrays and glMultiDrawElementsBaseVertex batches.
+class CommandList
+{
+public:
+	CommandList();
+
+	void clear();
+	void add(const DrawPacket &packet);
+	bool empty() const { return packets_.empty(); }
+
+	void submit(QOpenGLFunctions_3_2_Core *gl);
+
+	// statistics of the last submit
+	std::size_t packets() const { return packets_.size(); }
+	std::size_t batches() const { return batches_.size(); }
+	std::size_t stateChanges() const { return stateChanges_; }
+
+private:
+	void build();
+
+	static bool sameState(const DrawPacket &a, const DrawPacket &b);
+	static bool stateLess(const DrawPacket &a, const DrawPacket &b);
+
+private:
+	struct Batch
+	{
+		const DrawPacket *state;
+		std::size_t begin;
+		std::size_t end;
+	};
+
+	std::vector<DrawPacket> packets_;
+	bool built_;
+
+	// merged ranges, one slice per batch
+	std::vector<Batch> batches_;
+	std::vector<GLint> firsts_;
+	std::vector<GLsizei> counts_;
+	std::vector<GLint> baseVertices_;
+	std::vector<const void*> indexOffsets_;
+	std::size_t stateChanges_;
+};
+
+#endif
\ No newline at end of file
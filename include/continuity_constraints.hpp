@@ -0,0 +1,87 @@
+#ifndef CONTINUITY_CONSTRAINTS_HPP_INCLUDED
+#define CONTINUITY_CONSTRAINTS_HPP_INCLUDED
+
+#include <QPointF>
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <ferguson_patch.hpp>
+#include <patch_animation.hpp>
+
+// Keeps neighbouring patches joined while their handles are edited. Handles
+// are numbered as in HandleSelection, patch * Handles + PatchPose channel.
+// Every constraint ties two handles: coincident corners stay together, the
+// tangents of a shared edge stay equal, and tangents meeting at a corner
+// from opposite sides stay equal (C1) or collinear (G1). Ties are kept in
+// union-find sets as they are added, so the handles depending on each other
+// are always known, and an edit only moves the set it belongs to. Solving
+// a set is a projection in time linear in its size, no system is factored.
+class ContinuityConstraints
+{
+public:
+	using Patches = std::vector<std::shared_ptr<FergusonPatch>>;
+
+	// the four corners and the eight tangents, as PatchPose channels
+	static const unsigned int Handles = 12;
+
+	enum class Continuity { None, G1, C1 };
+
+	// Ties what is joined in patches already: corners within tolerance of
+	// each other, edges running through the same corners along the same
+	// curve, and tangents that continue each other across a corner within a
+	// few degrees. Nothing is tied with None.
+	void detect(const Patches &patches, Continuity continuity, double tolerance = 1e-6);
+	void clear();
+
+	// Adding constraints one by one. a and b are corner handles for
+	// joinCorners and tangent handles for joinTangents, where tangent a
+	// equals sign times tangent b, or only points the same way if collinear.
+	void joinCorners(std::uint32_t a, std::uint32_t b);
+	void joinTangents(std::uint32_t a, std::uint32_t b, int sign, bool collinear);
+
+	Continuity continuity() const { return continuity_; }
+	const Patches &patches() const { return patches_; }
+	std::size_t constraintCount() const { return constraints_; }
+	// handles moved by the last enforce, edited ones included
+	std::size_t lastTouched() const { return lastTouched_; }
+
+	// Once the handles in edited have been moved, moves every handle tied to
+	// them to match and returns the new pose of each patch that has to
+	// change. A corner moves its set along; a tangent sets the value of the
+	// tangents equal to it and the direction of those collinear with it.
+	std::vector<std::pair<std::size_t, PatchPose>> enforce(const std::vector<std::uint32_t> &edited);
+
+private:
+	// union-find over handles, each carrying a sign relative to its root:
+	// value(h) = sign(h) * value(root)
+	struct Sets
+	{
+		std::vector<std::uint32_t> parent;
+		std::vector<signed char> sign;
+		// every handle of a set, kept at its root, empty for lone handles
+		std::vector<std::vector<std::uint32_t>> members;
+
+		void reset(std::size_t size);
+		std::uint32_t find(std::uint32_t h, int &s);
+		// false when a and b were in one set already
+		bool join(std::uint32_t a, std::uint32_t b, int s);
+	};
+
+private:
+	Patches patches_;
+	Continuity continuity_ = Continuity::None;
+
+	Sets corners_;
+	// tangents equal up to sign
+	Sets values_;
+	// tangents collinear up to sign, each set of values_ lies in one
+	Sets directions_;
+
+	std::size_t constraints_ = 0;
+	std::size_t lastTouched_ = 0;
+};
+
+#endif
\ No newline at end of file
@@ -1,8 +1,12 @@
 #ifndef DRAWING_HPP_INCLUDED
 #define DRAWING_HPP_INCLUDED
 
+#include <QRectF>
+
 class QKeyEvent;
 class QMouseEvent;
+struct SceneSnapshot;
+class CommandList;
 
 class Drawing
 {
@@ -10,6 +14,28 @@ public:
 	virtual void init() = 0;
 	virtual void render() = 0;
 
+	// Split used by layer caching: the static part is kept in a cached layer
+	// and redrawn only while dirty, the overlay is drawn on every frame.
+	virtual void renderStatic() { render(); }
+	virtual void renderOverlay() {}
+	virtual bool isStaticDirty() const { return true; }
+	// region to redraw in NDC, the whole viewport when null
+	virtual QRectF staticDirtyRegion() const { return QRectF(); }
+	virtual void markStaticClean() {}
+
+	// Drawings that record their draw calls into the canvas' retained command
+	// list return true and are not rendered one by one. The list is recorded
+	// again whenever a drawing reports that its commands changed.
+	virtual bool record(CommandList &list) { return false; }
+	virtual bool commandsChanged() const { return false; }
+	virtual void frameRendered() {}
+
+	// Used by threaded rendering: append everything drawn to an immutable
+	// snapshot, and bring the drawing's own buffers back up to date once the
+	// GUI context renders again.
+	virtual void snapshot(SceneSnapshot &scene) const {}
+	virtual void syncGPUBuffers() {}
+
 	// Keyboard events
 	virtual void keyPress(QKeyEvent *e) = 0;
 	virtual void keyRelease(QKeyEvent *e) = 0;
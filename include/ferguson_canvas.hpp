@@ -3,12 +3,24 @@
 
 #include <QOpenGLWidget>
 #include <QOpenGLFunctions>
+#include <QOpenGLFunctions_3_2_Core>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLTextureBlitter>
 
 #include <canvas.hpp>
+#include <command_list.hpp>
 #include <drawing.hpp>
+#include <foldover_checker.hpp>
+#include <render_thread.hpp>
+#include <shader_registry.hpp>
+#include <vertex_arena.hpp>
+#include <array>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
+class FergusonPatch;
+
 class FergusonCanvas : public Canvas, protected QOpenGLFunctions  
 {
 public:
@@ -26,23 +38,105 @@ public:
 	void mouseMove(QMouseEvent *e) override;
 	void mouseRelease(QMouseEvent *e) override;
 
-	void insertDrawing(std::shared_ptr<Drawing> d) { drawings_.push_back(d); }
+	void insertDrawing(std::shared_ptr<Drawing> d) { drawings_.push_back(d); commandsValid_ = false; patchesValid_ = false; }
+	// replaces every drawing, cleaning up the old ones; needs the context
+	// current once initialised
+	void setDrawings(std::vector<std::shared_ptr<Drawing>> drawings);
+	// as setDrawings, but drawings that stay keep their buffers: only those
+	// dropped are cleaned up and only those new are initialised
+	void updateDrawings(std::vector<std::shared_ptr<Drawing>> drawings);
+	std::size_t drawingCount() const { return drawings_.size(); }
+
+	// keeps the static part of every drawing in an offscreen layer
+	bool layerCaching() const { return layerCaching_; }
+	void setLayerCaching(bool enabled);
+
+	// width of curves and lines in device independent pixels
+	float lineWidth() const { return lineWidth_; }
+	void setLineWidth(float width);
+
+	// renders the drawings into the bound framebuffer with the NDC region
+	// filling its viewport; lines are pixelScale times wider than on screen
+	void renderRegion(const QRectF &region, QSize viewport, float pixelScale);
+
+	// renders snapshots of the drawings on a separate thread, the widget
+	// only composites the finished frames
+	bool threaded() const { return renderThread_ != nullptr; }
+	void setThreaded(bool enabled);
+
+	// Foldovers are checked for the whole mesh at once. Patches report their
+	// edits here, and right before the next frame or snapshot the edited
+	// patches and their neighbours are checked again on all cores.
+	void touchFoldover(const FergusonPatch *patch) { foldoverTouched_.push_back(patch); }
+	const FoldoverChecker &foldoverChecker() const { return foldovers_; }
+
+	// Vertex buffers shared by every drawing, one per vertex layout. Drawings
+	// keep ranges in them and record their draws against the arena's VAO.
+	VertexArena &arena(VertexArena::Format format) { return *arenas_[format]; }
 
 	void destroy() override;
 
 	int height() const override { return height_; }
 	int width() const override { return width_; }
 
-	void update() const { renderer_->update(); } ;
-	void makeCurrent() const { renderer_->makeCurrent(); }
-	void doneCurrent() const { renderer_->doneCurrent(); }
+	void update();
+	unsigned long long updateRequests() const { return updateRequests_; }
+	// no-ops while threaded, drawings do not touch GL then
+	void makeCurrent() const { if (!threaded()) renderer_->makeCurrent(); }
+	void doneCurrent() const { if (!threaded()) renderer_->doneCurrent(); }
 
 	inline std::shared_ptr<Drawing> getDrawing(unsigned int index) { return drawings_[index]; }
+
+private:
+	void renderCached();
+	void updateLayer();
+	void destroyLayer();
+
+	// view transform and line uniforms shared by every program
+	void prepareShaders(const QRectF &region, QSize viewport, float pixelScale);
+	void renderCommands();
+	void renderThreaded();
+	void publishSnapshot();
+	// hands every patch checked again its foldovers, the context current
+	void checkFoldovers();
+
 private:
 	std::vector<std::shared_ptr<Drawing>> drawings_;
 	QOpenGLWidget *renderer_;
 	int width_;
 	int height_;
+
+	bool layerCaching_;
+	bool layerValid_;
+	std::unique_ptr<QOpenGLFramebufferObject> layer_;
+	std::unique_ptr<QOpenGLFramebufferObject> resolvedLayer_;
+	QOpenGLTextureBlitter blitter_;
+
+	QOpenGLFunctions_3_2_Core *gl_;
+
+	// shared with the drawings, which only set colours and transforms
+	std::shared_ptr<QOpenGLShaderProgram> shader_;
+	std::shared_ptr<QOpenGLShaderProgram> lineShader_;
+	std::shared_ptr<QOpenGLShaderProgram> fillShader_;
+	float lineWidth_;
+	std::array<std::unique_ptr<VertexArena>, VertexArena::FormatCount> arenas_;
+
+	// draws of every recording drawing, sorted and merged by state
+	CommandList commands_;
+	std::vector<bool> recorded_;
+	bool commandsValid_;
+	std::unique_ptr<RenderThread> renderThread_;
+	bool snapshotScheduled_;
+	unsigned long long snapshotSerial_;
+
+	// the patches among the drawings, in order, for the foldover checker
+	std::vector<FergusonPatch*> patches_;
+	std::unordered_map<const FergusonPatch*, std::size_t> patchIndex_;
+	bool patchesValid_;
+	std::vector<const FergusonPatch*> foldoverTouched_;
+	FoldoverChecker foldovers_;
+
+	unsigned long long updateRequests_;
 };
 
 #endif
\ No newline at end of file
@@ -6,6 +6,9 @@
 #include <QWidget>
 #include <QLabel>
 #include <QCheckBox>
+#include <QSpinBox>
+#include <QDoubleSpinBox>
+#include <QComboBox>
 
 class FergusonControl : public QWidget
 {
@@ -13,10 +16,41 @@ public:
 	FergusonControl(QWidget *parent, Renderer *renderer);
 
 	void showHandlers_stateChanged(int state);
+	void sketch_stateChanged(int state);
+	void showInterior_stateChanged(int state);
+	void showFoldover_stateChanged(int state);
+	void showIsoGrid_stateChanged(int state);
+	void isoGridspin_valueChanged(int lines);
+	void lineWidthspin_valueChanged(double width);
+	void quantised_stateChanged(int state);
+	void layerCaching_stateChanged(int state);
+	void threaded_stateChanged(int state);
+	void continuity_currentIndexChanged(int index);
+	void updateTrafficLabel();
+	void updateMeasuresLabel();
+	void updateCacheLabel();
+	void updateConstraintsLabel();
 
 private:
 	QLabel *titlelabel_;
 	QCheckBox *showHandlerschk_;
+	QCheckBox *sketchchk_;
+	QCheckBox *showInteriorchk_;
+	QCheckBox *showFoldoverchk_;
+	QCheckBox *showIsoGridchk_;
+	QLabel *isoGridlabel_;
+	QSpinBox *isoGridspin_;
+	QLabel *lineWidthlabel_;
+	QDoubleSpinBox *lineWidthspin_;
+	QCheckBox *quantisedchk_;
+	QCheckBox *layerCachingchk_;
+	QCheckBox *threadedchk_;
+	QLabel *continuitylabel_;
+	QComboBox *continuitycombo_;
+	QLabel *trafficlabel_;
+	QLabel *measureslabel_;
+	QLabel *cachelabel_;
+	QLabel *constraintslabel_;
 	Renderer *renderer_;
 };
 
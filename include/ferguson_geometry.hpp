@@ -0,0 +1,118 @@
+#ifndef FERGUSON_GEOMETRY_HPP_INCLUDED
+#define FERGUSON_GEOMETRY_HPP_INCLUDED
+
+#include <QPointF>
+#include <QRectF>
+#include <array>
+#include <vector>
+
+// Planar cubic in power basis: a0 + a1*t + a2*t^2 + a3*t^3
+class CubicCurve
+{
+public:
+	CubicCurve() = default;
+	CubicCurve(QPointF a0, QPointF a1, QPointF a2, QPointF a3);
+
+	// Hermite form: end points p0, p1 and the derivatives t0, t1 at them
+	static CubicCurve fromHermite(QPointF p0, QPointF t0, QPointF p1, QPointF t1);
+
+	const QPointF &coefficient(unsigned int i) const { return a_[i]; }
+	QPointF       &coefficient(unsigned int i) { return a_[i]; }
+	void           coefficient(unsigned int i, QPointF val) { a_[i] = val; }
+
+	QPointF point(float t) const { return a_[0] + t*(a_[1] + t*(a_[2] + t*a_[3])); }
+	QPointF derivative(float t) const { return a_[1] + t*(2.f*a_[2] + t*3.f*a_[3]); }
+
+	// writes n >= 2 equally spaced samples as (x, y) pairs into out; without
+	// the last, n samples 1/n apart from t = 0 leave out the one at t = 1
+	void tessellate(unsigned int n, float *out, bool last = true) const;
+
+	// smallest box around t in [0,1], from the roots of the derivative
+	QRectF bounds() const;
+	// arc length over t in [0,1] by adaptive Gauss-Legendre quadrature,
+	// to within about tolerance
+	double length(double tolerance = 1e-7) const;
+	// (1/2) integral of x dy - y dx, the curve's part of the signed area
+	// enclosed by a loop it belongs to
+	double areaIntegral() const;
+	// integrals of x^2 dy and y^2 dx, the curve's part of the loop's moments
+	QPointF momentIntegrals() const;
+
+	// the same for many curves at once, on all cores
+	static std::vector<QRectF> bounds(const std::vector<CubicCurve> &curves);
+	static std::vector<double> lengths(const std::vector<CubicCurve> &curves, double tolerance = 1e-7);
+
+private:
+	std::array<QPointF, 4> a_;
+};
+
+// Measures of the surface of a patch. Area and centroid count the image
+// of every (u,v) with the sign of the Jacobian, so folded parts subtract.
+struct PatchMeasures
+{
+	double area = 0.0;
+	QPointF centroid;
+	QRectF bounds;
+	double perimeter = 0.0;
+};
+
+// Control data of a Ferguson patch, the bicubic Hermite surface
+//
+//     s(u,v) = sum_ij b_i(v) b_j(u) G_ij
+//
+// with zero twist vectors. Corners p0 = s(0,0), p1 = s(0,1), p2 = s(1,0) and
+// p3 = s(1,1). Tangent tab is the derivative at corner a of the boundary curve
+// between a and b, taken along its parameter: t01, t02, t13 and t23 at the
+// start corner point towards b, while t10, t20, t31 and t32 at the end corner
+// point on, away from b.
+class FergusonGeometry
+{
+public:
+	using BezierNet = std::array<std::array<QPointF, 4>, 4>;
+
+	FergusonGeometry() = default;
+	FergusonGeometry(
+		QPointF p0, QPointF p1, QPointF p2, QPointF p3,
+		QPointF t01, QPointF t10, QPointF t13, QPointF t31,
+		QPointF t23, QPointF t32, QPointF t02, QPointF t20);
+
+	// G_ij, i indexing the v basis and j the u basis
+	const QPointF &g(unsigned int i, unsigned int j) const { return g_[i][j]; }
+
+	QPointF s(float u, float v) const;
+	QPointF su(float u, float v) const;
+	QPointF sv(float u, float v) const;
+
+	// the patch restricted to a fixed u (a cubic in v) or fixed v (a cubic in u)
+	CubicCurve isoU(float u) const;
+	CubicCurve isoV(float v) const;
+
+	// tensor product Bezier control net, indexed as [v][u]
+	BezierNet bezier() const;
+
+	// the boundary loop s(u,0), s(1,v), s(1-u,1), s(0,1-v), each curve
+	// running in its own parameter direction
+	std::array<CubicCurve, 4> boundary() const;
+
+	// Signed area and centroid in closed form by Green's theorem over the
+	// boundary: integral det(J) du dv = (1/2) loop integral of x dy - y dx,
+	// positive when p0, p2, p3 run counter-clockwise
+	double area() const;
+	QPointF centroid() const;
+	// smallest box around the surface: the boundary curves' bounds and
+	// any critical point of x or y inside, which only a fold can have
+	QRectF bounds() const;
+	double perimeter(double tolerance = 1e-7) const;
+	PatchMeasures measures() const;
+
+	// the same for many patches at once, on all cores
+	static std::vector<PatchMeasures> measures(const std::vector<FergusonGeometry> &patches);
+
+	bool operator==(const FergusonGeometry &other) const { return g_ == other.g_; }
+	bool operator!=(const FergusonGeometry &other) const { return g_ != other.g_; }
+
+private:
+	std::array<std::array<QPointF, 4>, 4> g_;
+};
+
+#endif
\ No newline at end of file
@@ -3,15 +3,28 @@
 
 #include <QOpenGLFunctions>
 #include <QOpenGLShaderProgram>
-#include <QOpenGLVertexArrayObject>
-#include <QOpenGLBuffer>
+#include <QOpenGLFunctions_3_2_Core>
 
 #include <QPointF>
+#include <QRectF>
+#include <QVector2D>
+#include <QVector3D>
+#include <array>
 #include <vector>
 #include <memory>
 
+#include <command_list.hpp>
 #include <drawing.hpp>
 #include <ferguson_canvas.hpp>
+#include <ferguson_geometry.hpp>
+#include <foldover_checker.hpp>
+#include <grid_index_buffer.hpp>
+#include <patch_animation.hpp>
+#include <scene_snapshot.hpp>
+#include <shader_registry.hpp>
+#include <tessellation_cache.hpp>
+#include <vertex_arena.hpp>
+#include <vertex_quantiser.hpp>
 
 class Circle
 {
@@ -84,15 +97,29 @@ public:
 	QPointF        &t1() { return t1_; }
 	void            t1(QPointF val) { t1_ = val; }
 
-	std::vector<float> computePoints() const;
+	// the curve, its tangent handles and the handle circles, shared through
+	// the TessellationCache; hits hand out the cached block without copying
+	TessellationCache::Block computePoints() const;
+
+	CubicCurve curve() const { return CubicCurve::fromHermite(p0_, t0_, p1_, t1_); }
+	// tight box around the curve, without the handles
+	QRectF bounds() const { return curve().bounds(); }
+	double length(double tolerance = 1e-7) const { return curve().length(tolerance); }
+
+	// moves the end points and tangents together with their handles
+	void setControls(QPointF p0, QPointF t0, QPointF p1, QPointF t1);
 
 	bool hasControlPointSelected() const;
+	// bits 1, 2, 4 and 8 for p0, t0, p1 and t1 when grabbed
+	unsigned int selectedControls() const;
 
 	void mousePress(QPointF pos);
 	void mouseMove(QPointF pos);
 	void mouseRelease(QPointF pos);
 
 private:
+	std::vector<float> tessellate() const;
+
 	float b0(float u3, float u2, float u1) const;
 	float b1(float u3, float u2, float u1) const;
 	float b2(float u3, float u2, float u1) const;
@@ -115,6 +142,15 @@ private:
 	Circle ct1_;
 };
 
+// vertex bytes moved for the interior and iso-grid buffers during one frame
+struct VertexTraffic
+{
+	std::size_t uploaded = 0;
+	std::size_t fetched = 0;
+	// compared with uploading and fetching the same vertices as floats
+	std::size_t saved = 0;
+};
+
 class FergusonPatch : public Drawing, protected QOpenGLFunctions
 {
 public:
@@ -123,15 +159,76 @@ public:
 		HermiteCurveComputer h2, HermiteCurveComputer h3,
 		unsigned int resolution, std::shared_ptr<FergusonCanvas> canvas);
 
+	// a patch in pose whose boundary curves have the given resolution
+	static std::shared_ptr<FergusonPatch> create(
+		const PatchPose &pose, unsigned int resolution, std::shared_ptr<FergusonCanvas> canvas);
+
 	unsigned int  resolution() const { return resolution_; }
 	unsigned int &resolution() { return resolution_; }
 	void resolution(unsigned int val) { resolution_ = val; }
 
+	unsigned int  interiorResolution() const { return interiorResolution_; }
+	unsigned int &interiorResolution() { return interiorResolution_; }
+	void interiorResolution(unsigned int val) { interiorResolution_ = val; }
+
+	// colours at the corners p0, p1, p2 and p3
+	const QVector3D &cornerColour(unsigned int i) const { return colours_[i]; }
+	QVector3D       &cornerColour(unsigned int i) { return colours_[i]; }
+	void             cornerColour(unsigned int i, QVector3D val) { colours_[i] = val; }
+	const std::array<QVector3D, 4> &cornerColours() const { return colours_; }
+	// sets all four and re-uploads the interior if any changed
+	void setCornerColours(const std::array<QVector3D, 4> &colours);
+
+	FergusonGeometry geometry() const;
+
+	// closed form measures of the surface, see FergusonGeometry
+	double area() const { return geometry().area(); }
+	QPointF centroid() const { return geometry().centroid(); }
+	QRectF surfaceBounds() const { return geometry().bounds(); }
+	PatchMeasures measures() const { return geometry().measures(); }
+
+	PatchPose pose() const;
+	// re-tessellates and re-uploads only what the new pose changes
+	void setPose(const PatchPose &pose);
+	// computes what setPose(pose) tessellates into the TessellationCache,
+	// leaving the patch alone; safe to call from several threads
+	void prepare(const PatchPose &pose) const;
+	// the PatchPose channels of the handles held by the mouse
+	std::vector<unsigned int> grabbedChannels() const;
+
 	std::vector<float> computePoints() const;
+	// blocks shared through the TessellationCache, see HermiteCurveComputer
+	TessellationCache::Block computeInteriorPoints() const;
+	std::vector<float> computeFoldoverPoints() const;
+	TessellationCache::Block computeIsoGridPoints() const;
+
+	unsigned int isoGridULines() const { return isoGridULines_; }
+	unsigned int isoGridVLines() const { return isoGridVLines_; }
+	void setIsoGridLines(unsigned int uLines, unsigned int vLines);
 
 	void init() override;
 	void render() override; 
 
+	// the blue interpolating lines are the overlay, everything else is static
+	void renderStatic() override;
+	void renderOverlay() override;
+	bool isStaticDirty() const override { return staticDirty_; }
+	QRectF staticDirtyRegion() const override { return staticDirtyRegion_; }
+	void markStaticClean() override;
+
+	bool record(CommandList &list) override;
+	bool commandsChanged() const override { return commandsDirty_; }
+	void frameRendered() override;
+
+	void snapshot(SceneSnapshot &scene) const override;
+	// the patch as it would be drawn in pose, without changing it. Safe to
+	// call from several threads while the patch itself is left alone.
+	void snapshot(SceneSnapshot &scene, const PatchPose &pose) const;
+	void syncGPUBuffers() override;
+
+	// NDC box containing the patch and its handles
+	QRectF bounds() const;
+
 	// keyboard events
 	void keyPress(QKeyEvent *e) override;
 	void keyRelease(QKeyEvent *e) override;
@@ -147,31 +244,71 @@ public:
 
 	~FergusonPatch();
 
-	inline void showInterpolateLines() { shouldShowInterpolateLines_ = true; }
-	inline void hideInterpolateLines() { shouldShowInterpolateLines_ = false; }
+	inline void showInterpolateLines() { shouldShowInterpolateLines_ = true; commandsDirty_ = true; }
+	inline void hideInterpolateLines() { shouldShowInterpolateLines_ = false; commandsDirty_ = true; }
 
-	inline void showHandlers() { shouldShowHandlers_ = true; }
-	inline void hideHandlers() { shouldShowHandlers_ = false; }
+	inline void showHandlers() { shouldShowHandlers_ = true; invalidateStatic(); }
+	inline void hideHandlers() { shouldShowHandlers_ = false; invalidateStatic(); }
+	bool handlersShown() const { return shouldShowHandlers_; }
+
+	inline void showInterior() { shouldShowInterior_ = true; invalidateStatic(); }
+	inline void hideInterior() { shouldShowInterior_ = false; invalidateStatic(); }
+
+	inline void showIsoGrid() { shouldShowIsoGrid_ = true; invalidateStatic(); }
+	inline void hideIsoGrid() { shouldShowIsoGrid_ = false; invalidateStatic(); }
+
+	inline void showFoldover() { shouldShowFoldover_ = true; invalidateStatic(); }
+	inline void hideFoldover() { shouldShowFoldover_ = false; invalidateStatic(); }
+
+	// stores interior and iso-grid vertices as normalised shorts and bytes
+	bool quantised() const { return quantised_; }
+	void setQuantised(bool quantised);
+
+	const VertexTraffic &lastFrameTraffic() const { return lastFrameTraffic_; }
+
+	// folded regions as last checked by the canvas, see FergusonCanvas::touchFoldover
+	const FoldoverChecker::Result &foldover() const { return foldover_; }
+	// keeps the result and uploads its cells, the GUI context current
+	void setFoldover(const FoldoverChecker::Result &folds);
 
 private:
-	float b0(float u3, float u2, float u1) const;
-	float b1(float u3, float u2, float u1) const;
-	float b2(float u3, float u2, float u1) const;
-	float b3(float u3, float u2, float u1) const;
 	QPointF s(float u, float v) const;
-
-	std::vector<float> computePointsForInterpolatingLines(float u, float v);
+	QVector3D c(float u, float v) const;
+
+	std::vector<float> computePointsForInterpolatingLines(float u, float v) const;
+
+	// the compute functions for geometry other than the patch's own
+	using Curves = std::array<HermiteCurveComputer, 4>;
+	Curves curves(const PatchPose &pose) const;
+	static std::vector<float> computePoints(const Curves &curves);
+	TessellationCache::Block computeInteriorPoints(const FergusonGeometry &g) const;
+	std::vector<float> computeFoldoverPoints(const FergusonGeometry &g, const FoldoverChecker::Result &folds) const;
+	TessellationCache::Block computeIsoGridPoints(const FergusonGeometry &g) const;
+	std::vector<float> computePointsForInterpolatingLines(const FergusonGeometry &g, float u, float v) const;
+	// what the interior and iso grid compute functions cache
+	std::vector<float> tessellateInterior(const FergusonGeometry &g) const;
+	std::vector<float> tessellateIsoGrid(const FergusonGeometry &g) const;
+	void snapshot(SceneSnapshot &scene, const Curves &curves, const FergusonGeometry &g, 
+		QPointF uv, const FoldoverChecker::Result &folds) const;
 
 private:
-	void setupShaders();
+	bool setupShaders();
 	void setupGeometry();
+	void setupInteriorGeometry();
 
 	void updateGPUBuffers(const HermiteCurveComputer &h);
 	void updateGPUBuffersInterpolatingLines(float u, float v);
+	void updateGPUBuffersInterior();
+	void updateGPUBuffersFoldover();
+	void updateGPUBuffersIsoGrid();
 
 	QPointF toViewportCoordSystem(const QPointF &screenCoords) const;
+
+	// whole viewport unless given a region
+	void invalidateStatic(const QRectF &region = QRectF(-1.f, -1.f, 2.f, 2.f));
 private:
 	unsigned int resolution_;
+	unsigned int interiorResolution_;
 
 	float lastu_;
 	float lastv_;
@@ -181,14 +318,60 @@ private:
 	HermiteCurveComputer h2_;
 	HermiteCurveComputer h3_;
 
+	std::array<QVector3D, 4> colours_;
+
 	std::shared_ptr<FergusonCanvas> canvas_;
 
-	QOpenGLShaderProgram *shader_;
-	QOpenGLVertexArrayObject vao_;
-	QOpenGLBuffer vbo_;
+	QOpenGLFunctions_3_2_Core *gl_;
+
+	std::shared_ptr<QOpenGLShaderProgram> shader_;
+	// curves and lines, expanded into anti-aliased quads
+	std::shared_ptr<QOpenGLShaderProgram> lineShader_;
+	// curves, handles and interpolating lines, in the canvas' Position arena
+	VertexArena::Range lines_;
+
+	// filled interior: vertices in the canvas' arena of their layout,
+	// indices shared by resolution
+	std::shared_ptr<QOpenGLShaderProgram> fillShader_;
+	VertexArena *interiorArena_;
+	VertexArena::Range interior_;
+	std::shared_ptr<GridIndexBuffer> gridIndices_;
+	QVector2D interiorOffset_;
+	QVector2D interiorScale_;
+	std::size_t interiorBytes_;
+	std::size_t interiorFloatBytes_;
+
+	// folded regions, checked by the canvas whenever the geometry changes
+	FoldoverChecker::Result foldover_;
+	VertexArena::Range fold_;
+
+	// iso-parameter grid, one line strip per isoline drawn in a single batch
+	unsigned int isoGridULines_;
+	unsigned int isoGridVLines_;
+	unsigned int isoGridResolution_;
+	VertexArena *isoGridArena_;
+	VertexArena::Range isoGrid_;
+	// in the arena
+	std::vector<GLint> isoGridFirsts_;
+	std::vector<GLsizei> isoGridCounts_;
+	QVector2D isoGridOffset_;
+	QVector2D isoGridScale_;
+	std::size_t isoGridBytes_;
+	std::size_t isoGridFloatBytes_;
+
+	bool quantised_;
+	VertexTraffic pendingTraffic_;
+	VertexTraffic lastFrameTraffic_;
+
+	bool staticDirty_;
+	QRectF staticDirtyRegion_;
+	bool commandsDirty_;
 
 	bool shouldShowInterpolateLines_;
 	bool shouldShowHandlers_;
+	bool shouldShowInterior_;
+	bool shouldShowFoldover_;
+	bool shouldShowIsoGrid_;
 };
 
 #endif
\ No newline at end of file
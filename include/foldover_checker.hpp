@@ -0,0 +1,82 @@
+#ifndef FOLDOVER_CHECKER_HPP_INCLUDED
+#define FOLDOVER_CHECKER_HPP_INCLUDED
+
+#include <ferguson_geometry.hpp>
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Detects where a Ferguson patch folds over itself, i.e. where the Jacobian
+// det[s_u s_v] takes the opposite sign to the patch orientation. The Jacobian
+// is a polynomial of degree (5,5) whose Bernstein coefficients over a sub-cell
+// bound it from above and below, so a cell is cleared without sampling.
+class FoldoverChecker
+{
+public:
+	// region of the (u,v) domain where the Jacobian may vanish or flip sign
+	struct Cell
+	{
+		float u0, v0;
+		float u1, v1;
+	};
+
+	struct Result
+	{
+		// true when the Jacobian provably flips sign somewhere
+		bool folded = false;
+		std::vector<Cell> cells;
+	};
+
+	FoldoverChecker(unsigned int cells = 8, unsigned int depth = 2);
+
+	unsigned int  cells() const { return cells_; }
+	unsigned int &cells() { return cells_; }
+	void cells(unsigned int val) { cells_ = val; }
+
+	unsigned int  depth() const { return depth_; }
+	unsigned int &depth() { return depth_; }
+	void depth(unsigned int val) { depth_ = val; }
+
+	Result check(const FergusonGeometry &geometry) const;
+
+	// Checks again, in parallel, only the patches whose geometry changed since
+	// the previous call. Results are indexed like patches.
+	const std::vector<Result> &update(const std::vector<FergusonGeometry> &patches);
+	// As above, but only the edited patches and those sharing a corner with
+	// them, before or after the edit, are compared and checked again. Patches
+	// past the count of the previous call are always checked.
+	const std::vector<Result> &update(const std::vector<FergusonGeometry> &patches,
+		const std::vector<std::size_t> &edited);
+	// forgets every patch, the next update checks them all
+	void clear();
+
+	const std::vector<Result> &results() const { return results_; }
+	// the patches checked by the last update
+	const std::vector<std::size_t> &checked() const { return checked_; }
+
+private:
+	// Bernstein coefficients of the Jacobian, indexed as [v][u]
+	using Jacobian = std::array<std::array<float, 6>, 6>;
+
+	static Jacobian jacobian(const FergusonGeometry &geometry);
+	static Jacobian restrict(const Jacobian &j, const Cell &cell);
+
+	void classify(const Jacobian &j, float orientation, const Cell &cell,
+		unsigned int depth, Result &result) const;
+	// adds patch i to or removes it from the patches at its corners
+	void index(std::size_t i, bool add);
+
+private:
+	unsigned int cells_;
+	unsigned int depth_;
+
+	std::vector<FergusonGeometry> geometries_;
+	std::vector<Result> results_;
+	std::vector<std::size_t> checked_;
+	// patches by the grid cell of each of their corners, see cornerKey
+	std::unordered_map<std::uint64_t, std::vector<std::size_t>> corners_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,114 @@
+#ifndef FRAME_CAPTURE_HPP_INCLUDED
+#define FRAME_CAPTURE_HPP_INCLUDED
+
+#include <QOpenGLBuffer>
+#include <QOpenGLFunctions_3_2_Core>
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Saves images on worker threads. With a single worker they are written in
+// the order they were queued.
+class ImageEncoder
+{
+public:
+	// called on a worker thread after each image, or on the caller's thread
+	// for those reported by fail
+	using Done = std::function<void(const QString &filename, bool ok)>;
+
+	ImageEncoder(unsigned int threads = 1);
+	// finishes every queued image first
+	~ImageEncoder();
+
+	void onDone(Done done) { done_ = done; }
+
+	// flipped images are stored bottom row first, as OpenGL reads them back
+	void encode(QImage image, const QString &filename, bool flipped);
+	// reports an image that never made it here as not written
+	void fail(const QString &filename);
+
+	std::size_t backlog() const;
+	// blocks until at most images are waiting
+	void waitForBacklog(std::size_t images);
+
+private:
+	void run();
+
+private:
+	struct Job
+	{
+		QImage image;
+		QString filename;
+		bool flipped;
+	};
+
+	mutable std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable taken_;
+	std::deque<Job> jobs_;
+	bool stopping_;
+	Done done_;
+	std::vector<std::thread> workers_;
+};
+
+// Reads frames back through a ring of pixel pack buffers. A capture only
+// queues the read; poll() later maps the buffers whose fences have passed
+// and hands the pixels to the encoder, so neither side waits on the GPU.
+class FrameCapture
+{
+public:
+	FrameCapture(unsigned int slots = 3, unsigned int encoders = 1);
+
+	// must be called with the context current
+	void init();
+	void cleanUp();
+
+	// reads the colour buffer of framebuffer, resolving it first when it is
+	// multisampled. False when every slot is still in flight, or when more
+	// images than the backlog limit wait for the encoder.
+	bool capture(GLuint framebuffer, QSize size, int samples, const QString &filename);
+	// 0, the default, leaves the encoder's queue unbounded
+	void setBacklogLimit(std::size_t images) { backlogLimit_ = images; }
+
+	// true while reads are still in flight
+	bool poll();
+	// blocks on the oldest read when every slot is in flight
+	void waitForSlot();
+
+	ImageEncoder &encoder() { return encoder_; }
+	unsigned int slots() const { return unsigned(slots_.size()); }
+	// frames refused by capture or lost to a failed mapping
+	std::size_t dropped() const { return dropped_; }
+
+private:
+	struct Slot
+	{
+		QOpenGLBuffer pbo{QOpenGLBuffer::PixelPackBuffer};
+		GLsync fence = nullptr;
+		QSize size;
+		QString filename;
+	};
+
+	QOpenGLFunctions_3_2_Core *gl_;
+	std::vector<Slot> slots_;
+	// oldest read in flight and number of reads in flight
+	unsigned int oldest_;
+	unsigned int inFlight_;
+	std::size_t dropped_;
+	std::size_t backlogLimit_;
+
+	GLuint resolveFbo_;
+	GLuint resolveColour_;
+	QSize resolveSize_;
+
+	ImageEncoder encoder_;
+};
+
+#endif
\ No newline at end of file
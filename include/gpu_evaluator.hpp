@@ -0,0 +1,105 @@
+#ifndef GPU_EVALUATOR_HPP_INCLUDED
+#define GPU_EVALUATOR_HPP_INCLUDED
+
+#include <QOpenGLBuffer>
+#include <QOpenGLFunctions_3_2_Core>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QString>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <ferguson_geometry.hpp>
+
+// Evaluates patches at (patch, u, v) samples on the GPU, without compute
+// shaders: samples are drawn as points through a vertex shader evaluating
+// s, and su and sv if asked, whose outputs transform feedback captures
+// while rasterisation is discarded. The control data of the patches is
+// uploaded once into a buffer texture. Samples are streamed in batches
+// through two sets of buffers, so one batch is read back while the next
+// one is evaluated. Needs no compute shaders, so it also runs on llvmpipe.
+class GpuEvaluator
+{
+public:
+	struct Sample
+	{
+		std::uint32_t patch;
+		float u;
+		float v;
+	};
+
+	// the CPU path, FergusonGeometry on all cores, against this one
+	struct Benchmark
+	{
+		std::size_t samples = 0;
+		double cpuSeconds = 0.0;
+		double gpuSeconds = 0.0;
+		// largest difference between the results of the two
+		double maxDifference = 0.0;
+
+		bool gpuFaster() const { return gpuSeconds < cpuSeconds; }
+		QString toString() const;
+	};
+
+	GpuEvaluator(std::size_t batchSize = std::size_t(1) << 20);
+
+	// must be called with the context current; false when the programs do
+	// not link. Everything below needs the same context current.
+	bool init();
+	void cleanUp();
+
+	// up to GL_MAX_TEXTURE_BUFFER_SIZE / 16 patches; samples of patches
+	// beyond them evaluate to 0
+	void setPatches(const std::vector<FergusonGeometry> &patches);
+	std::size_t patchCount() const { return patchCount_; }
+
+	// also evaluate su and sv
+	bool  derivatives() const { return derivatives_; }
+	bool &derivatives() { return derivatives_; }
+	void  derivatives(bool val) { derivatives_ = val; }
+
+	// floats per sample: x y, or x y xu yu xv yv with the derivatives
+	unsigned int valuesPerSample() const { return derivatives_ ? 6 : 2; }
+
+	// writes valuesPerSample() floats per sample to out
+	void evaluate(const Sample *samples, std::size_t count, float *out);
+
+	// evaluates in one go into a buffer left on the GPU, to draw from
+	// directly: valuesPerSample() floats per vertex, the position first.
+	// Valid until the next evaluation.
+	QOpenGLBuffer &evaluateToBuffer(const Sample *samples, std::size_t count);
+
+	// times both paths on samples random samples over patches
+	static Benchmark benchmark(const std::vector<FergusonGeometry> &patches, std::size_t samples, bool derivatives);
+
+private:
+	struct Slot
+	{
+		QOpenGLVertexArrayObject vao;
+		QOpenGLBuffer samples;
+		QOpenGLBuffer results;
+		std::size_t count = 0;
+	};
+
+	void submit(Slot &slot, const Sample *samples, std::size_t count);
+	void readBack(Slot &slot, float *out);
+
+private:
+	QOpenGLFunctions_3_2_Core *gl_;
+	std::shared_ptr<QOpenGLShaderProgram> program_;
+	std::shared_ptr<QOpenGLShaderProgram> derivativesProgram_;
+
+	// G_ij of every patch as RG32F texels
+	QOpenGLBuffer geometry_;
+	GLuint geometryTexture_;
+	std::size_t patchCount_;
+
+	std::array<Slot, 2> slots_;
+	std::size_t batchSize_;
+	bool derivatives_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,56 @@
+#ifndef GRADIENT_MESH_HPP_INCLUDED
+#define GRADIENT_MESH_HPP_INCLUDED
+
+#include <QPointF>
+#include <QRectF>
+#include <QVector3D>
+#include <array>
+#include <vector>
+
+#include <patch_animation.hpp>
+
+// Grid of Ferguson patches sharing their corners. Each vertex carries one
+// tangent along the rows (u) and one along the columns (v), shared by every
+// patch around it, so the mesh is C1 across patch boundaries. Colours are
+// per vertex and bilinear within a patch, as in FergusonPatch.
+class GradientMesh
+{
+public:
+	struct Vertex
+	{
+		QPointF position;
+		// derivatives with respect to u (down the rows) and v (along the columns)
+		QPointF tu;
+		QPointF tv;
+		QVector3D colour;
+	};
+
+	GradientMesh(unsigned int rows = 1, unsigned int columns = 1);
+
+	// rows x columns patches filling region, with straight edges
+	static GradientMesh grid(unsigned int rows, unsigned int columns, const QRectF &region);
+
+	// number of patches along each direction
+	unsigned int rows() const { return rows_; }
+	unsigned int columns() const { return columns_; }
+
+	// vertices are (rows+1) x (columns+1), row major
+	const Vertex &vertex(unsigned int r, unsigned int c) const { return vertices_[r*(columns_+1) + c]; }
+	Vertex       &vertex(unsigned int r, unsigned int c) { return vertices_[r*(columns_+1) + c]; }
+	void          vertex(unsigned int r, unsigned int c, const Vertex &val) { vertices_[r*(columns_+1) + c] = val; }
+
+	const std::vector<Vertex> &vertices() const { return vertices_; }
+	std::vector<Vertex>       &vertices() { return vertices_; }
+
+	// patch (r, c) has p0 = vertex(r, c), p1 = vertex(r, c+1),
+	// p2 = vertex(r+1, c) and p3 = vertex(r+1, c+1)
+	PatchPose pose(unsigned int r, unsigned int c) const;
+	std::array<QVector3D, 4> colours(unsigned int r, unsigned int c) const;
+
+private:
+	unsigned int rows_;
+	unsigned int columns_;
+	std::vector<Vertex> vertices_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef GRID_INDEX_BUFFER_HPP_INCLUDED
+#define GRID_INDEX_BUFFER_HPP_INCLUDED
+
+#include <QOpenGLFunctions>
+#include <QOpenGLBuffer>
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class QOpenGLContext;
+
+// Element buffer describing a (resolution+1)^2 vertex grid as one triangle
+// strip per row, separated by primitive restart indices. Buffers are shared
+// by every patch of the same resolution within a context.
+class GridIndexBuffer
+{
+public:
+	static const GLuint RestartIndex = 0xFFFFFFFFu;
+
+	// must be called with the target context current
+	static std::shared_ptr<GridIndexBuffer> acquire(unsigned int resolution);
+
+	unsigned int resolution() const { return resolution_; }
+	GLsizei count() const { return count_; }
+
+	void bind() { ebo_.bind(); }
+
+	~GridIndexBuffer();
+
+private:
+	GridIndexBuffer(QOpenGLContext *context, unsigned int resolution);
+
+	static std::vector<GLuint> computeIndices(unsigned int resolution);
+
+private:
+	using Key = std::pair<QOpenGLContext*, unsigned int>;
+	static std::map<Key, std::weak_ptr<GridIndexBuffer>> registry_;
+
+	QOpenGLContext *context_;
+	unsigned int resolution_;
+	GLsizei count_;
+	QOpenGLBuffer ebo_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,79 @@
+#ifndef HANDLE_SELECTION_HPP_INCLUDED
+#define HANDLE_SELECTION_HPP_INCLUDED
+
+#include <QPointF>
+#include <QRectF>
+#include <QTransform>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <ferguson_patch.hpp>
+#include <patch_animation.hpp>
+
+// Handles of any number of patches selected at once, kept as a sorted set
+// of indices patch * Handles + channel. A drag gathers the positions of the
+// selected handles into contiguous x and y arrays once; every step of it
+// maps them in a single branch-free pass, then writes each affected patch
+// back with one setPose, after its new tessellation has been computed on
+// all cores into the TessellationCache.
+class HandleSelection
+{
+public:
+	using Patches = std::vector<std::shared_ptr<FergusonPatch>>;
+
+	// the four corners and the eight tangent handles, as PatchPose channels
+	static const unsigned int Handles = 12;
+
+	// Selects the handles inside rect, adding to the selection when extend.
+	// Corners are always picked, tangent handles only where they are shown.
+	void select(const Patches &patches, const QRectF &rect, bool extend);
+	void clear();
+
+	bool empty() const { return indices_.empty(); }
+	std::size_t size() const { return indices_.size(); }
+	const std::vector<std::uint32_t> &indices() const { return indices_; }
+	// patches the indices refer to
+	const Patches &patches() const { return patches_; }
+
+	// where the selected handles are now, in index order
+	std::vector<QPointF> positions() const;
+	// mean of the selected handles
+	QPointF centre() const;
+
+	// Starts a drag from where the handles are now. Every transform maps
+	// those positions, not the last ones, so rounding does not build up.
+	// A selected tangent handle moves on its own; one that is not keeps its
+	// tangent and follows its corner, as when dragging a single corner.
+	void begin();
+	void transform(const QTransform &m);
+	void end();
+
+	// where a handle is drawn: the corner, or the corner plus the tangent
+	static QPointF position(const PatchPose &pose, unsigned int channel);
+
+private:
+	// the selected handles of one patch, [first, last) in indices_
+	struct Group
+	{
+		std::size_t patch;
+		PatchPose pose;
+		std::size_t first;
+		std::size_t last;
+	};
+
+private:
+	std::vector<std::uint32_t> indices_;
+	Patches patches_;
+
+	std::vector<Group> groups_;
+	// positions at begin() and after the last transform, one per index
+	std::vector<double> x0_;
+	std::vector<double> y0_;
+	std::vector<double> x_;
+	std::vector<double> y_;
+	std::vector<PatchPose> poses_;
+};
+
+#endif
\ No newline at end of file
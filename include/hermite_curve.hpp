@@ -13,6 +13,7 @@
 
 #include <drawing.hpp>
 #include <ferguson_canvas.hpp>
+#include <shader_registry.hpp>
 
 class Circle 
 {
@@ -96,7 +97,8 @@ private:
 	float b2(float u3, float u2, float u1) const;
 	float b3(float u3, float u2, float u1) const;
 
-	void setupShaders();
+	// false when the program cannot be built
+	bool setupShaders();
 	void setupGeometry();
 
 	void updateGPUBuffers();
@@ -105,7 +107,7 @@ private:
 
 private:
 	int resolution_;
-	QOpenGLShaderProgram *shader_;
+	std::shared_ptr<QOpenGLShaderProgram> shader_;
 	QOpenGLVertexArrayObject vao_;
 	QOpenGLBuffer vbo_;
 
@@ -0,0 +1,95 @@
+#ifndef HERMITE_SPLINE_HPP_INCLUDED
+#define HERMITE_SPLINE_HPP_INCLUDED
+
+#include <QPointF>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <ferguson_geometry.hpp>
+
+// Chain of cubic Hermite segments through knots p_0 .. p_n-1, segment i
+// running from p_i to p_i+1 over a unit parameter interval. Tangents are
+// set by hand or derived from the knots:
+//
+//  - CatmullRom: t_i = (p_i+1 - p_i-1) / 2, one sided at the ends
+//  - C2: the natural cubic spline, continuous in the second derivative,
+//
+//        t_i-1 + 4 t_i + t_i+1 = 3 (p_i+1 - p_i-1)
+//
+//    with 2 t_0 + t_1 and t_n-2 + 2 t_n-1 at the ends, solved in O(n) by
+//    the Thomas algorithm.
+//
+// A knot edit only redoes the tangents it affects. The influence of a knot
+// on C2 tangents shrinks by 2 - sqrt(3) per knot, so the system is solved
+// again in a window around the edit with the tangents outside held fixed.
+// The segments that changed are kept until markClean so that a tessellated
+// buffer can be brought up to date piecewise.
+class HermiteSpline
+{
+public:
+	enum class Tangents { Manual, CatmullRom, C2 };
+
+	HermiteSpline(Tangents tangents = Tangents::C2);
+	HermiteSpline(std::vector<QPointF> points, Tangents tangents = Tangents::C2);
+
+	// recomputes every tangent unless Manual
+	Tangents tangentMode() const { return tangentMode_; }
+	void     tangentMode(Tangents val);
+
+	std::size_t knots() const { return points_.size(); }
+	std::size_t segments() const { return points_.empty() ? 0 : points_.size() - 1; }
+
+	const std::vector<QPointF> &points() const { return points_; }
+	const std::vector<QPointF> &tangents() const { return tangents_; }
+	void setPoints(std::vector<QPointF> points);
+
+	const QPointF &point(std::size_t i) const { return points_[i]; }
+	void           point(std::size_t i, QPointF val);
+
+	// setting a tangent switches to Manual
+	const QPointF &tangent(std::size_t i) const { return tangents_[i]; }
+	void           tangent(std::size_t i, QPointF val);
+
+	// the new knot becomes knot i
+	void insertKnot(std::size_t i, QPointF p);
+	void removeKnot(std::size_t i);
+
+	CubicCurve segment(std::size_t i) const;
+	// t in [0, segments()], segment floor(t) at t - floor(t)
+	QPointF evaluate(double t) const;
+
+	// perSegment (x, y) samples of every segment from its start, then the last knot
+	std::size_t tessellatedPoints(unsigned int perSegment) const { return points_.empty() ? 0 : segments() * perSegment + 1; }
+	// the whole chain into out, with tessellatedPoints pairs, on all cores
+	void tessellate(unsigned int perSegment, float *out) const;
+	// only segments [first, last) into their place in a buffer laid out as above
+	void tessellate(std::size_t first, std::size_t last, unsigned int perSegment, float *out) const;
+
+	// segments changed since markClean, as [first, last); empty when first == last
+	std::pair<std::size_t, std::size_t> changedSegments() const { return changed_; }
+	void markClean() { changed_ = { 0, 0 }; }
+
+private:
+	// brings tangents [first, last] up to date after the knots changed
+	void updateTangents(std::size_t first, std::size_t last);
+	void catmullRom(std::size_t first, std::size_t last);
+	// solves for tangents [first, last] with their neighbours outside fixed
+	void solveC2(std::size_t first, std::size_t last);
+
+	// knots [first, last] changed, the tangents around them follow
+	void knotsChanged(std::size_t first, std::size_t last);
+	void segmentsChanged(std::size_t first, std::size_t last);
+
+private:
+	Tangents tangentMode_;
+	std::vector<QPointF> points_;
+	std::vector<QPointF> tangents_;
+	std::pair<std::size_t, std::size_t> changed_;
+
+	// Thomas algorithm scratch, kept between solves
+	std::vector<double> upper_;
+	std::vector<QPointF> rhs_;
+};
+
+#endif
\ No newline at end of file
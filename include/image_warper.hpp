@@ -0,0 +1,70 @@
+#ifndef IMAGE_WARPER_HPP_INCLUDED
+#define IMAGE_WARPER_HPP_INCLUDED
+
+#include <QImage>
+#include <QRectF>
+#include <QSize>
+
+#include <ferguson_geometry.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Maps an image through a Ferguson patch: source column v and row u end up
+// at s(u,v). The patch is evaluated once on a forward grid that is refined
+// until each cell is flat to within the tolerance, then every cell is
+// rasterised as two triangles across which (u,v) is interpolated linearly.
+// Output rows are split into bands that are filled on separate threads.
+class ImageWarper
+{
+public:
+	ImageWarper(const FergusonGeometry &geometry);
+
+	// largest distance in output pixels between the patch and its grid
+	float  tolerance() const { return tolerance_; }
+	void   tolerance(float val) { tolerance_ = val; }
+
+	// cells per side of the grid used by the last warp
+	unsigned int gridCells() const { return gridCells_; }
+
+	// region is the part of NDC covered by the output. Pixels outside the
+	// patch are transparent.
+	QImage warp(const QImage &source, QSize size, const QRectF &region = QRectF(-1.f, -1.f, 2.f, 2.f));
+
+private:
+	// grid vertex in output pixels with its source position in 16.16 fixed
+	// point, 64 bits wide so that sources of 32768 pixels and more fit
+	struct Vertex
+	{
+		float x, y;
+		std::int64_t sx, sy;
+	};
+
+	struct Source
+	{
+		const quint32 *bits;
+		int stride;
+		int width;
+		int height;
+	};
+
+	struct Target
+	{
+		quint32 *bits;
+		int stride;
+		int width;
+		int height;
+	};
+
+	void buildGrid(QSize source, QSize size, const QRectF &region);
+	static void rasterise(const Vertex &a, const Vertex &b, const Vertex &c,
+		const Source &source, const Target &target, int rowBegin, int rowEnd);
+
+private:
+	FergusonGeometry geometry_;
+	float tolerance_;
+	unsigned int gridCells_;
+	std::vector<Vertex> grid_;
+};
+
+#endif
\ No newline at end of file
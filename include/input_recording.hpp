@@ -0,0 +1,124 @@
+#ifndef INPUT_RECORDING_HPP_INCLUDED
+#define INPUT_RECORDING_HPP_INCLUDED
+
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QPointF>
+#include <QString>
+#include <QTimer>
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+class QKeyEvent;
+class QMouseEvent;
+class Renderer;
+
+// One mouse or key event as it reached the renderer. Positions are in widget
+// coordinates, times in nanoseconds since the recording started.
+struct RecordedEvent
+{
+	qint64 time = 0;
+	int type = 0;
+
+	// mouse events
+	QPointF pos;
+	int button = 0;
+	int buttons = 0;
+
+	// key events
+	int key = 0;
+	bool autoRepeat = false;
+	QString text;
+
+	int modifiers = 0;
+};
+
+QDataStream &operator<<(QDataStream &out, const RecordedEvent &e);
+QDataStream &operator>>(QDataStream &in, RecordedEvent &e);
+
+// Streams the input that reaches the renderer into a file.
+class InputRecorder
+{
+public:
+	static const quint32 Magic = 0x46474952; // "FGIR"
+	static const quint32 Version = 1;
+
+	bool start(const QString &filename);
+	void stop();
+	bool recording() const { return file_.isOpen(); }
+
+	void record(const QMouseEvent *e);
+	void record(const QKeyEvent *e);
+
+	~InputRecorder() { stop(); }
+
+private:
+	void write(RecordedEvent &e);
+
+private:
+	QFile file_;
+	QDataStream stream_;
+	QElapsedTimer clock_;
+};
+
+// Feeds a recording back into a Renderer and measures how long each event
+// takes to show up on screen.
+class InputReplayer
+{
+public:
+	enum class Pace { Original, MaximumRate };
+
+	struct Report
+	{
+		std::size_t events = 0;
+		// events that requested a repaint, the latencies are measured on those
+		std::size_t updates = 0;
+		std::size_t frames = 0;
+		double seconds = 0.0;
+
+		// event to frame latency percentiles, milliseconds
+		double p50 = 0.0;
+		double p90 = 0.0;
+		double p99 = 0.0;
+		double max = 0.0;
+
+		QString toString() const;
+	};
+
+	InputReplayer(Renderer *renderer);
+
+	bool load(const QString &filename);
+	std::size_t size() const { return events_.size(); }
+
+	void start(Pace pace, std::function<void(const Report &)> finished);
+
+private:
+	void dispatchDue();
+	void dispatch(const RecordedEvent &e);
+	void frameSwapped();
+	void finish();
+
+private:
+	Renderer *renderer_;
+	std::vector<RecordedEvent> events_;
+	std::size_t next_;
+	Pace pace_;
+
+	QTimer timer_;
+	QElapsedTimer clock_;
+	bool started_;
+	qint64 start_;
+	qint64 lastEvent_;
+
+	// dispatch times of events still waiting for their frame
+	std::deque<qint64> pending_;
+	std::vector<qint64> latencies_;
+	std::size_t frames_;
+
+	std::function<void(const Report &)> finished_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,109 @@
+#ifndef MESH_FITTER_HPP_INCLUDED
+#define MESH_FITTER_HPP_INCLUDED
+
+#include <QImage>
+
+#include <block_sparse_matrix.hpp>
+#include <gradient_mesh.hpp>
+
+#include <functional>
+#include <vector>
+
+// Fits the positions, tangents and colours of a GradientMesh to an image by
+// damped Gauss-Newton (Levenberg-Marquardt) on the colour error at a fixed
+// grid of (u,v) samples in every patch:
+//
+//     E = sum_samples |c(u,v) - I(s(u,v))|^2 / samples per patch + smoothing
+//
+// Derivatives of s come from the Hermite basis, those of I from its bilinear
+// interpolant. The normal equations have one 9x9 block per vertex and are
+// solved by preconditioned conjugate gradients. Residuals are evaluated and
+// assembled on all cores: patches are split into four classes by the parity
+// of their row and column, and patches of one class share no vertex.
+//
+// The image covers NDC [-1,1]^2 like the canvas. Boundary vertices stay on
+// the boundary.
+class MeshFitter
+{
+public:
+	struct Progress
+	{
+		unsigned int iteration;
+		// root mean square colour error per channel, in [0, 1]
+		double error;
+		unsigned int solverIterations;
+	};
+
+	// return false to stop after the current iteration
+	using ProgressCallback = std::function<bool(const Progress &progress)>;
+
+	MeshFitter(const QImage &image);
+
+	unsigned int  samples() const { return samples_; }
+	void          samples(unsigned int val) { samples_ = val; }
+
+	// weight of keeping neighbouring vertices apart evenly and tangents
+	// along the edges, relative to the colour error of a patch
+	double  smoothness() const { return smoothness_; }
+	void    smoothness(double val) { smoothness_ = val; }
+
+	void onProgress(ProgressCallback progress) { progress_ = progress; }
+
+	// straight patches over the whole image, coloured from it
+	GradientMesh initialMesh(unsigned int rows, unsigned int columns);
+
+	// returns the root mean square error reached
+	double fit(GradientMesh &mesh, unsigned int iterations);
+
+private:
+	// image value and its derivatives along x and y, per channel
+	struct Sample
+	{
+		double value[3];
+		double dx[3];
+		double dy[3];
+	};
+
+	// box filters the image down until its pixels are about as far apart
+	// as the samples of a rows x columns mesh
+	void prepare(unsigned int rows, unsigned int columns);
+	// at a position in pixels of the full image
+	Sample sample(double x, double y) const;
+
+	// colour error of one patch, and its Gauss-Newton normal equations
+	// over the 4 x 9 unknowns of its corners when hessian is not null
+	double patchEnergy(const std::vector<double> &x, unsigned int r, unsigned int c,
+		double *hessian, double *gradient) const;
+	// smoothing of every mesh edge, added to normal_ when assembling
+	double smoothingEnergy(const std::vector<double> &x, bool assembling);
+
+	// total energy of the mesh with unknowns x, the rms colour error in error
+	double energy(const std::vector<double> &x, double &error);
+	// the same, and the normal equations around x in normal_ and gradient_
+	double assemble(const std::vector<double> &x, double &error);
+
+	// nine unknowns per vertex, in pixels of the image: position, tu, tv, rgb
+	void toUnknowns(const GradientMesh &mesh, std::vector<double> &x) const;
+	void fromUnknowns(const std::vector<double> &x, GradientMesh &mesh) const;
+
+private:
+	QImage image_;
+
+	unsigned int samples_;
+	double smoothness_;
+	ProgressCallback progress_;
+
+	// filtered image, r, g and b planes in [0, 1]
+	int scale_;
+	int width_;
+	int height_;
+	std::vector<float> planes_[3];
+
+	// mesh being fitted
+	unsigned int rows_;
+	unsigned int columns_;
+	BlockSparseMatrix<9> normal_;
+	std::vector<double> gradient_;
+};
+
+#endif
\ No newline at end of file
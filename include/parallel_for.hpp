@@ -0,0 +1,42 @@
+#ifndef PARALLEL_FOR_HPP_INCLUDED
+#define PARALLEL_FOR_HPP_INCLUDED
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Calls f(begin, end) on contiguous chunks of [0, count), one chunk per
+// hardware thread. Ranges smaller than minChunk per thread run inline.
+template <typename F>
+void parallelFor(std::size_t count, F f, std::size_t minChunk = 1)
+{
+	if (count == 0)
+		return;
+
+	std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+	threads = std::min(threads, std::max<std::size_t>(1, count / std::max<std::size_t>(1, minChunk)));
+
+	if (threads <= 1) {
+		f(std::size_t(0), count);
+		return;
+	}
+
+	std::size_t chunk = (count + threads - 1) / threads;
+	std::vector<std::thread> workers;
+	workers.reserve(threads - 1);
+
+	for (std::size_t t = 1; t < threads; ++t) {
+		std::size_t begin = t * chunk;
+		std::size_t end = std::min(count, begin + chunk);
+		if (begin < end)
+			workers.emplace_back(f, begin, end);
+	}
+
+	f(std::size_t(0), std::min(count, chunk));
+
+	for (std::thread &worker : workers)
+		worker.join();
+}
+
+#endif
\ No newline at end of file
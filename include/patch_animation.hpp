@@ -0,0 +1,112 @@
+#ifndef PATCH_ANIMATION_HPP_INCLUDED
+#define PATCH_ANIMATION_HPP_INCLUDED
+
+#include <QElapsedTimer>
+#include <QPointF>
+#include <array>
+#include <vector>
+
+// Everything of a patch that can be animated: the corners, the tangent of
+// each boundary curve at both of its ends and the (u,v) of the inner point.
+// Corners and tangents are named as in FergusonGeometry.
+struct PatchPose
+{
+	enum Channel
+	{
+		P0, P1, P2, P3,
+		T01, T10, T13, T31, T23, T32, T02, T20,
+		InnerPoint,
+		Channels
+	};
+
+	std::array<QPointF, Channels> values;
+
+	const QPointF &operator[](unsigned int channel) const { return values[channel]; }
+	QPointF       &operator[](unsigned int channel) { return values[channel]; }
+
+	bool operator==(const PatchPose &other) const { return values == other.values; }
+	bool operator!=(const PatchPose &other) const { return values != other.values; }
+};
+
+// Keyed 2D values over time. Keys are joined by cubic Hermite segments whose
+// tangents are the Catmull-Rom estimates, so the motion is C1 through every
+// key; before the first and after the last key the value is held.
+class Track
+{
+public:
+	struct Key
+	{
+		float time;
+		QPointF value;
+	};
+
+	// replaces the key at the same time, if there is one
+	void setKey(float time, QPointF value);
+	bool removeKey(float time);
+	void clear() { keys_.clear(); }
+
+	bool empty() const { return keys_.empty(); }
+	const std::vector<Key> &keys() const { return keys_; }
+
+	QPointF value(float time) const;
+
+private:
+	QPointF tangent(std::size_t k) const;
+
+private:
+	// sorted by time
+	std::vector<Key> keys_;
+};
+
+// One track per pose channel. Channels without keys are left as they are.
+class PatchAnimation
+{
+public:
+	Track       &track(unsigned int channel) { return tracks_[channel]; }
+	const Track &track(unsigned int channel) const { return tracks_[channel]; }
+
+	// keys every channel at once
+	void setKeys(float time, const PatchPose &pose);
+	void removeKeys(float time);
+	void clear();
+
+	bool empty() const;
+	// time of the last key
+	float duration() const;
+
+	// rest supplies the channels that have no keys
+	PatchPose evaluate(float time, const PatchPose &rest) const;
+
+private:
+	std::array<Track, PatchPose::Channels> tracks_;
+};
+
+// Wall clock time of a playback, in seconds. Looping wraps around duration.
+class PlaybackClock
+{
+public:
+	PlaybackClock();
+
+	float  duration() const { return duration_; }
+	void   duration(float val) { duration_ = val; }
+
+	bool  looping() const { return looping_; }
+	void  looping(bool val) { looping_ = val; }
+
+	void play();
+	void pause();
+	void seek(float time);
+
+	bool playing() const { return playing_; }
+	float time() const;
+
+private:
+	QElapsedTimer timer_;
+	// playback time when the timer was started, or the paused time
+	float origin_;
+	float duration_;
+	bool looping_;
+	bool playing_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef PNG_STREAM_WRITER_HPP_INCLUDED
+#define PNG_STREAM_WRITER_HPP_INCLUDED
+
+#include <QFile>
+#include <QString>
+
+#include <vector>
+#include <zlib.h>
+
+// Writes an 8 bit RGB PNG a few rows at a time. Rows are compressed as they
+// arrive, so memory use does not depend on the height of the image.
+class PngStreamWriter
+{
+public:
+	PngStreamWriter();
+	~PngStreamWriter();
+
+	bool open(const QString &filename, int width, int height);
+
+	// rows of width * 3 bytes, top to bottom
+	bool writeRows(const unsigned char *rgb, int rows);
+
+	// fails when fewer rows than the height were written
+	bool close();
+
+private:
+	bool deflate(int flush);
+	bool writeChunk(const char *type, const unsigned char *data, quint32 size);
+
+private:
+	QFile file_;
+	z_stream stream_;
+	bool deflating_;
+
+	int width_;
+	int height_;
+	int rowsWritten_;
+
+	std::vector<unsigned char> row_;
+	std::vector<unsigned char> out_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,83 @@
+#ifndef RENDER_THREAD_HPP_INCLUDED
+#define RENDER_THREAD_HPP_INCLUDED
+
+#include <QThread>
+#include <QSize>
+#include <QOpenGLFunctions_3_2_Core>
+#include <QOpenGLBuffer>
+
+#include <scene_snapshot.hpp>
+#include <snapshot_painter.hpp>
+#include <triple_buffer.hpp>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+class QOpenGLContext;
+class QOffscreenSurface;
+class QOpenGLFramebufferObject;
+
+// A rendered frame handed from the render thread to the GUI thread. The
+// producer fences its rendering in ready, the consumer fences its last use
+// of the texture in consumed before the slot goes back to the producer.
+struct RenderedFrame
+{
+	QOpenGLFramebufferObject *target = nullptr;
+	GLsync ready = nullptr;
+	GLsync consumed = nullptr;
+	unsigned long long serial = 0;
+};
+
+// Owns an OpenGL context shared with the widget and renders the most recent
+// SceneSnapshot at a fixed pace, independently of how often the GUI thread
+// publishes. Snapshots and frames travel through lock-free triple buffers.
+class RenderThread : public QThread
+{
+public:
+	// must be constructed on the GUI thread with shareContext current
+	RenderThread(QOpenGLContext *shareContext, QSize size, int samples, int interval = 16);
+	~RenderThread();
+
+	// GUI side: fill snapshot() and publish it
+	SceneSnapshot &snapshot() { return snapshots_.back(); }
+	void publish() { snapshots_.publish(); }
+
+	// GUI side: latest finished frame, nullptr until the first one exists
+	RenderedFrame *acquireFrame();
+
+	// called from the render thread whenever a new frame is available
+	void onFrameReady(std::function<void()> callback) { frameReady_ = callback; }
+
+	void stop();
+
+protected:
+	void run() override;
+
+private:
+	void setup();
+	void renderSnapshot(const SceneSnapshot &scene, RenderedFrame &frame);
+	void cleanUp();
+
+private:
+	QSize size_;
+	int samples_;
+	int interval_;
+
+	QOpenGLContext *context_;
+	QOffscreenSurface *surface_;
+	QOpenGLFunctions_3_2_Core *gl_;
+
+	// owned by the render thread
+	SnapshotPainter painter_;
+	QOpenGLFramebufferObject *multisampled_;
+
+	TripleBuffer<SceneSnapshot> snapshots_;
+	TripleBuffer<RenderedFrame> frames_;
+	bool hasFrame_;
+
+	std::function<void()> frameReady_;
+	std::atomic<bool> running_;
+};
+
+#endif
\ No newline at end of file
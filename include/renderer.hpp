@@ -5,13 +5,43 @@
 #include <QOpenGLFunctions>
 #include <QOpenGLVertexArrayObject>
 #include <QOpenGLBuffer>
+#include <QFileSystemWatcher>
+#include <QTimer>
 
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <continuity_constraints.hpp>
 #include <ferguson_canvas.hpp>
+#include <ferguson_patch.hpp>
+#include <frame_capture.hpp>
+#include <gpu_evaluator.hpp>
+#include <gradient_mesh.hpp>
+#include <handle_selection.hpp>
+#include <input_recording.hpp>
+#include <mesh_fitter.hpp>
+#include <patch_animation.hpp>
+#include <selection_overlay.hpp>
+#include <stroke_sketch.hpp>
+#include <svg_mesh_reader.hpp>
 // #include "hermite_curve.hpp"
 
 
 QT_FORWARD_DECLARE_CLASS(QOpenGLShaderProgram)
 
+// what reloading a watched scene did to its patches
+struct SceneDiff
+{
+	std::size_t unchanged = 0;
+	// given a new pose, re-tessellating only the curves that moved
+	std::size_t moved = 0;
+	// given new corner colours, re-uploading only the interior
+	std::size_t recoloured = 0;
+	std::size_t added = 0;
+	std::size_t removed = 0;
+};
+
 class Renderer : public QOpenGLWidget, protected QOpenGLFunctions
 {
 public:
@@ -25,7 +55,18 @@ public:
 	void mousePressEvent(QMouseEvent *e);
 	void mouseReleaseEvent(QMouseEvent *e);
 
-	bool save(const QString &filename);
+	// called on the GUI thread once a captured image has been written
+	using CaptureDone = std::function<void(const QString &filename, bool ok)>;
+	void onCaptureDone(CaptureDone done) { captureDone_ = done; }
+
+	// captures the next frame; reading back and encoding never block the GUI
+	void save(const QString &filename);
+	// captures every frame, at most at the given rate, as numbered PNGs in directory
+	void startImageSequence(const QString &directory, int fps = 60);
+	void stopImageSequence();
+	bool recordingSequence() const { return sequenceTimer_.isActive(); }
+	// renders at any size in tiles, see TiledExporter
+	bool exportImage(const QString &filename, QSize size, int supersampling);
 
 	void interpolateInnerPoint(float u, float v);
 	void hideInnerPointInterpolation();
@@ -33,15 +74,160 @@ public:
 	void showHandlers();
 	void hideHandlers();
 
+	void showInterior();
+	void hideInterior();
+
+	void showFoldover();
+	void hideFoldover();
+
+	void showIsoGrid();
+	void hideIsoGrid();
+	void setIsoGridLines(unsigned int lines);
+
+	// While sketching, mouse strokes are fitted by Hermite segments as they
+	// are drawn and, once released, replace the boundary curve of the
+	// patch whose corners are nearest to their ends
+	void setSketching(bool enabled);
+	bool sketching() const { return sketching_; }
+
+	// Shift-drag selects every handle inside the rubber band, Ctrl-Shift
+	// adds to the selection. While handles are selected, dragging moves
+	// them all, with Ctrl rotates and with Alt scales them about their
+	// centre; a click without dragging or Escape clears the selection.
+	const HandleSelection &selection() const { return selection_; }
+	void clearSelection();
+
+	// Keeps neighbouring patches joined at their shared corners and edges
+	// while handles are dragged, see ContinuityConstraints. The ties are
+	// found in the scene when set and again whenever it is replaced.
+	void setContinuity(ContinuityConstraints::Continuity continuity);
+	ContinuityConstraints::Continuity continuity() const { return constraints_.continuity(); }
+	const ContinuityConstraints &constraints() const { return constraints_; }
+
+	void setQuantised(bool quantised);
+	void setLayerCaching(bool enabled);
+	void setThreadedRendering(bool enabled);
+	void setLineWidth(float width);
+	VertexTraffic vertexTraffic() const;
+	// area, centroid, bounds and perimeter of every patch, in NDC
+	std::vector<PatchMeasures> measures() const;
+	// times evaluating the patches at random samples on the GPU against the
+	// CPU, see GpuEvaluator
+	GpuEvaluator::Benchmark benchmarkEvaluation(std::size_t samples, bool derivatives);
+
+	// keys the current pose of every channel at the playback time
+	void setKey();
+	void removeKey();
+	void clearKeys();
+	const PatchAnimation &animation() const { return animation_; }
+
+	void play();
+	void pause();
+	void seek(float time);
+	bool playing() const { return clock_.playing(); }
+	float playbackTime() const { return clock_.time(); }
+	// called on every frame of the playback with its time
+	void onPlaybackTick(std::function<void(float)> tick) { playbackTick_ = tick; }
+
+	// maps the image in input through the patch into output, see ImageWarper.
+	// The output has the canvas' aspect ratio and the input's width unless given.
+	bool warpImage(const QString &input, const QString &output, int width = 0);
+
+	// replaces the patches on the canvas with one per patch of mesh
+	void loadMesh(const GradientMesh &mesh);
+	// fits a mesh of patches x patches to the image, see MeshFitter, and
+	// shows it stretched over the canvas
+	bool fitImage(const QString &filename, unsigned int patches, unsigned int iterations,
+		MeshFitter::ProgressCallback progress = MeshFitter::ProgressCallback());
+	// replaces the patches on the canvas with those of the SVG mesh
+	// gradients in filename, see SvgMeshReader, scaled to fit the canvas
+	bool importSvg(const QString &filename);
+	// imports filename and follows it: whenever the file changes it is read
+	// again and diffed against the scene patch by patch, and only the
+	// patches that differ are updated, added or removed. The mapping onto
+	// the canvas is kept from the import. Stopped by any other import.
+	bool watchSvg(const QString &filename);
+	void stopWatchingSvg();
+	bool watchingSvg() const { return !watchedSvg_.isEmpty(); }
+	// called after every reload of the watched file
+	void onSceneReloaded(std::function<void(const SceneDiff &)> reloaded) { sceneReloaded_ = reloaded; }
+
+	// renders every frame of the animation offline, see AnimationRenderer
+	bool renderAnimation(const QString &directory, QSize size, float fps);
+
+	// every key and mouse event reaching the renderer is also passed to
+	// recorder, before it goes to the selection, the sketch or the canvas
+	void setInputRecorder(InputRecorder *recorder) { recorder_ = recorder; }
+	// repaints requested by the drawings so far
+	unsigned long long updateRequests() const;
+
 	~Renderer();
 
 protected:
 	void initializeGL() override;
 	void paintGL() override;
 	void cleanUp();
+	void applyAnimation(float time);
+	// every drawing that is a patch
+	std::vector<std::shared_ptr<FergusonPatch>> patches() const;
+	QPointF toViewportCoordSystem(const QPointF &screenCoords) const;
+	// replaces the boundary closest to the sketched stroke, in whichever patch
+	void applyStroke();
+	// a patch of a loaded mesh, interior shown and handles hidden
+	std::shared_ptr<FergusonPatch> meshPatch(const PatchPose &pose, const std::array<QVector3D, 4> &colours);
+	// false when the file has no mesh gradient
+	static bool readSvg(const QString &filename, std::vector<SvgMeshReader::Patch> &patches);
+	// scales the patches to fit the canvas, mapSvg applies it
+	void fitSvg(const std::vector<SvgMeshReader::Patch> &patches);
+	void mapSvg(std::vector<SvgMeshReader::Patch> &patches) const;
+	bool reloadSvg();
+	// the transform of the selection for the drag from dragStart_ to p
+	QTransform selectionDrag(QPointF p) const;
+	// moves what is tied to the edited handles, numbered as in HandleSelection
+	void applyConstraints(const std::vector<std::uint32_t> &edited);
 
 protected:
 	std::shared_ptr<FergusonCanvas> canvas_;
+
+	std::unique_ptr<FrameCapture> capture_;
+	CaptureDone captureDone_;
+	QString pendingCapture_;
+	QString sequenceDirectory_;
+	unsigned int sequenceFrame_;
+	// capture_->dropped() when the sequence started
+	std::size_t sequenceDropped_;
+	// keeps frames coming while a sequence records, and polls reads in flight
+	QTimer sequenceTimer_;
+	QTimer pollTimer_;
+
+	std::shared_ptr<StrokeSketch> sketch_;
+	bool sketching_;
+
+	enum class Drag { None, Marquee, Translate, Rotate, Scale };
+	HandleSelection selection_;
+	std::shared_ptr<SelectionOverlay> selectionOverlay_;
+	Drag drag_;
+	QPointF dragStart_;
+	QPointF dragCentre_;
+	bool dragMoved_;
+
+	ContinuityConstraints constraints_;
+	// handles held by the mouse on the canvas
+	std::vector<std::uint32_t> grabbed_;
+
+	PatchAnimation animation_;
+	PlaybackClock clock_;
+	QTimer playbackTimer_;
+	std::function<void(float)> playbackTick_;
+
+	QFileSystemWatcher watcher_;
+	QTimer reloadTimer_;
+	QString watchedSvg_;
+	QPointF svgCentre_;
+	QPointF svgScale_;
+	std::function<void(const SceneDiff &)> sceneReloaded_;
+
+	InputRecorder *recorder_;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,44 @@
+#ifndef SCENE_SNAPSHOT_HPP_INCLUDED
+#define SCENE_SNAPSHOT_HPP_INCLUDED
+
+#include <QOpenGLFunctions>
+#include <QVector3D>
+#include <vector>
+
+// Everything needed to draw one frame, published by the GUI thread and left
+// untouched once published. Positions are NDC (x, y) pairs; coloured
+// vertices carry (x, y, r, g, b) and are drawn before the plain ones.
+struct SceneSnapshot
+{
+	struct Draw
+	{
+		GLenum mode;
+		GLint first;
+		GLsizei count;
+		QVector3D colour;
+	};
+
+	std::vector<float> vertices;
+	std::vector<Draw> draws;
+
+	std::vector<float> colouredVertices;
+	std::vector<Draw> colouredDraws;
+
+	// in pixels, for line and line strip draws
+	float lineWidth = 1.f;
+	unsigned long long serial = 0;
+
+	// keeps the capacity so that republishing does not allocate
+	void clear()
+	{
+		vertices.clear();
+		draws.clear();
+		colouredVertices.clear();
+		colouredDraws.clear();
+	}
+
+	GLint vertexCount() const { return GLint(vertices.size() / 2); }
+	GLint colouredVertexCount() const { return GLint(colouredVertices.size() / 5); }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef SELECTION_OVERLAY_HPP_INCLUDED
+#define SELECTION_OVERLAY_HPP_INCLUDED
+
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QPointF>
+#include <QRectF>
+
+#include <memory>
+#include <vector>
+
+#include <drawing.hpp>
+#include <ferguson_canvas.hpp>
+#include <vertex_arena.hpp>
+
+// Draws the rubber band of a marquee selection and a square around every
+// selected handle, all as one batch of lines. Fed by the owner in NDC, the
+// canvas' own events are ignored.
+class SelectionOverlay : public Drawing, protected QOpenGLFunctions
+{
+public:
+	SelectionOverlay(std::shared_ptr<FergusonCanvas> canvas);
+
+	// no rubber band when rect is null
+	void setMarquee(const QRectF &rect);
+	void setHandles(const std::vector<QPointF> &handles);
+
+	void init() override;
+	void render() override;
+	void renderStatic() override {}
+	void renderOverlay() override;
+	bool isStaticDirty() const override { return false; }
+
+	bool record(CommandList &list) override;
+	bool commandsChanged() const override { return commandsDirty_; }
+
+	void snapshot(SceneSnapshot &scene) const override;
+	void syncGPUBuffers() override;
+
+	void keyPress(QKeyEvent *e) override {}
+	void keyRelease(QKeyEvent *e) override {}
+	void mousePress(QMouseEvent *e) override {}
+	void mouseMove(QMouseEvent *e) override {}
+	void mouseRelease(QMouseEvent *e) override {}
+
+	void cleanUp() override;
+
+	~SelectionOverlay();
+
+private:
+	void updateVertices();
+	void updateGPUBuffers();
+
+private:
+	std::shared_ptr<FergusonCanvas> canvas_;
+	QRectF marquee_;
+	std::vector<QPointF> handles_;
+
+	// (x, y) pairs of GL_LINES, the rubber band first
+	std::vector<float> vertices_;
+
+	std::shared_ptr<QOpenGLShaderProgram> lineShader_;
+	VertexArena::Range range_;
+	bool commandsDirty_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef SHADER_REGISTRY_HPP_INCLUDED
+#define SHADER_REGISTRY_HPP_INCLUDED
+
+#include <QOpenGLShaderProgram>
+#include <QString>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+class QOpenGLContext;
+
+// Linked shader programs shared by every drawing within a context. Sources
+// are embedded as resources under :/shaders, and linked binaries are kept in
+// Qt's shader disk cache so later runs skip compiling and linking.
+class ShaderRegistry
+{
+public:
+	// "ferguson", "ferguson_line" (thick anti-aliased lines, takes lineWidth
+	// and viewport in pixels), "ferguson_fill", or "ferguson_eval" and
+	// "ferguson_eval_derivatives" for transform feedback, see GpuEvaluator.
+	// Must be called with the target context current, returns nullptr when
+	// the program does not link.
+	static std::shared_ptr<QOpenGLShaderProgram> acquire(const QString &name);
+
+private:
+	static QOpenGLShaderProgram *build(const QString &name);
+
+private:
+	using Key = std::pair<QOpenGLContext*, QString>;
+	static std::map<Key, std::weak_ptr<QOpenGLShaderProgram>> registry_;
+	// render threads acquire programs for their own contexts
+	static std::mutex mutex_;
+};
+
+#endif
\ No newline at end of file
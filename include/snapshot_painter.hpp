@@ -0,0 +1,42 @@
+#ifndef SNAPSHOT_PAINTER_HPP_INCLUDED
+#define SNAPSHOT_PAINTER_HPP_INCLUDED
+
+#include <QOpenGLFunctions_3_2_Core>
+#include <QOpenGLBuffer>
+#include <QSize>
+
+#include <scene_snapshot.hpp>
+#include <shader_registry.hpp>
+
+#include <memory>
+
+class QOpenGLVertexArrayObject;
+
+// Draws a SceneSnapshot into the bound framebuffer with buffers of its own,
+// so that it can be used on any context sharing the application's programs.
+class SnapshotPainter
+{
+public:
+	SnapshotPainter();
+
+	// must be called with the context current; false when the programs
+	// are missing, paint then only clears
+	bool init();
+	void cleanUp();
+
+	// clears to white and draws the whole scene
+	void paint(const SceneSnapshot &scene, QSize viewport);
+
+private:
+	QOpenGLFunctions_3_2_Core *gl_;
+
+	std::shared_ptr<QOpenGLShaderProgram> shader_;
+	std::shared_ptr<QOpenGLShaderProgram> lineShader_;
+	std::shared_ptr<QOpenGLShaderProgram> fillShader_;
+	QOpenGLVertexArrayObject *vao_;
+	QOpenGLVertexArrayObject *fillVao_;
+	QOpenGLBuffer vbo_;
+	QOpenGLBuffer fillVbo_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,64 @@
+#ifndef STROKE_FITTER_HPP_INCLUDED
+#define STROKE_FITTER_HPP_INCLUDED
+
+#include <QPointF>
+#include <vector>
+
+#include <ferguson_geometry.hpp>
+
+// Fits a chain of cubic Hermite segments to a freehand stroke while it is
+// being drawn. The last segment is refitted by least squares, with chord
+// length parameters, to the points since its start on every new point; once
+// its error exceeds the tolerance, or it spans too many points, the fit
+// before that point is kept and a new segment starts there, leaving with
+// the same tangent direction. Every point therefore costs a fit over a
+// bounded number of points, however long the stroke.
+class StrokeFitter
+{
+public:
+	struct Segment
+	{
+		QPointF p0, t0, p1, t1;
+
+		CubicCurve curve() const { return CubicCurve::fromHermite(p0, t0, p1, t1); }
+	};
+
+	StrokeFitter(float tolerance = 0.004f);
+
+	// largest distance between a point and its segment, in stroke units
+	float  tolerance() const { return tolerance_; }
+	void   tolerance(float val) { tolerance_ = val; }
+
+	void begin(QPointF p);
+	void addPoint(QPointF p);
+	void finish();
+
+	bool drawing() const { return drawing_; }
+	bool empty() const { return segments_.empty(); }
+	std::size_t points() const { return points_; }
+
+	// the last segment keeps changing until the next one starts or the
+	// stroke is finished; those before it are final
+	const std::vector<Segment> &segments() const { return segments_; }
+	std::size_t finalSegments() const { return drawing_ && !segments_.empty() ? segments_.size() - 1 : segments_.size(); }
+
+	// a single segment between the ends of the stroke, fitted to the chain,
+	// e.g. for a patch boundary
+	Segment boundary() const;
+
+private:
+	// fits a segment from the first to the last of points; when direction
+	// is not null the start tangent is kept along it. Returns the largest
+	// distance from a point to the segment.
+	static float fit(const std::vector<QPointF> &points, const QPointF *direction, Segment &segment);
+
+private:
+	float tolerance_;
+	bool drawing_;
+	std::size_t points_;
+	// points of the last segment
+	std::vector<QPointF> active_;
+	std::vector<Segment> segments_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,74 @@
+#ifndef STROKE_SKETCH_HPP_INCLUDED
+#define STROKE_SKETCH_HPP_INCLUDED
+
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+
+#include <memory>
+#include <vector>
+
+#include <drawing.hpp>
+#include <ferguson_canvas.hpp>
+#include <stroke_fitter.hpp>
+#include <vertex_arena.hpp>
+
+// Draws the chain a StrokeFitter fits to the stroke in progress. Final
+// segments are tessellated and uploaded once; every new point only
+// rewrites the open segment at the end of its range in the canvas' arena. Mouse events are
+// fed in by the owner in NDC, the canvas' own events are ignored.
+class StrokeSketch : public Drawing, protected QOpenGLFunctions
+{
+public:
+	StrokeSketch(std::shared_ptr<FergusonCanvas> canvas);
+
+	const StrokeFitter &fitter() const { return fitter_; }
+	StrokeFitter       &fitter() { return fitter_; }
+
+	void begin(QPointF p);
+	void addPoint(QPointF p);
+	void finish();
+	void clear();
+
+	void init() override;
+	void render() override;
+	void renderStatic() override {}
+	void renderOverlay() override;
+	bool isStaticDirty() const override { return false; }
+
+	bool record(CommandList &list) override;
+	bool commandsChanged() const override { return commandsDirty_; }
+
+	void snapshot(SceneSnapshot &scene) const override;
+	void syncGPUBuffers() override;
+
+	void keyPress(QKeyEvent *e) override {}
+	void keyRelease(QKeyEvent *e) override {}
+	void mousePress(QMouseEvent *e) override {}
+	void mouseMove(QMouseEvent *e) override {}
+	void mouseRelease(QMouseEvent *e) override {}
+
+	void cleanUp() override;
+
+	~StrokeSketch();
+
+private:
+	// tessellates the segments from the first not yet final one on
+	void updateVertices();
+	// uploads vertices from first on
+	void updateGPUBuffers(std::size_t first);
+
+private:
+	std::shared_ptr<FergusonCanvas> canvas_;
+	StrokeFitter fitter_;
+
+	// (x, y) pairs, PerSegment per segment and the last point
+	std::vector<float> vertices_;
+	// segments tessellated for good
+	std::size_t finalSegments_;
+
+	std::shared_ptr<QOpenGLShaderProgram> lineShader_;
+	VertexArena::Range range_;
+	bool commandsDirty_;
+};
+
+#endif
\ No newline at end of file
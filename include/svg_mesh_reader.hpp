@@ -0,0 +1,86 @@
+#ifndef SVG_MESH_READER_HPP_INCLUDED
+#define SVG_MESH_READER_HPP_INCLUDED
+
+#include <QIODevice>
+#include <QPointF>
+#include <QString>
+#include <QTransform>
+#include <QVector3D>
+#include <QXmlStreamReader>
+#include <array>
+#include <functional>
+#include <vector>
+
+#include <patch_animation.hpp>
+
+// Reads the patches of SVG 2 <meshgradient> elements. The document is read
+// as a stream of tokens, no tree is built: a patch is handed on as soon as
+// its </meshpatch> is read, and only the edges of the row above are kept to
+// share with the next row, so memory depends on the width of a mesh only.
+//
+// Each Bezier edge becomes a Hermite boundary curve with the tangents 3
+// (b1 - b0) and 3 (b3 - b2). The boundaries and corner colours are exact;
+// the interior is the Ferguson patch's, with zero twists, rather than the
+// Coons patch's of the SVG renderer. gradientTransform is applied, x and y
+// of the gradient are in user space, whatever the gradientUnits.
+class SvgMeshReader
+{
+public:
+	struct Patch
+	{
+		// as for FergusonPatch: p0 top left, p1 top right, p2 bottom left
+		// and p3 bottom right, in SVG user units with y down
+		PatchPose pose;
+		std::array<QVector3D, 4> colours;
+	};
+
+	using PatchCallback = std::function<void(const Patch &)>;
+
+	SvgMeshReader();
+
+	// calls onPatch for every patch of every mesh in the document, in
+	// document order. Fails when the document is not well formed or a patch
+	// is missing edges.
+	bool read(QIODevice &device, PatchCallback onPatch);
+	bool read(const QString &filename, PatchCallback onPatch);
+
+	// meshes and patches of the last read
+	unsigned int meshes() const { return meshes_; }
+	unsigned long long patches() const { return patches_; }
+
+private:
+	// the four edges of a patch, each running from the corner before it
+	// clockwise: top from c0, right from c1, bottom from c2 and left from c3,
+	// with the colour of its start corner
+	struct Edges
+	{
+		std::array<std::array<QPointF, 4>, 4> points;
+		std::array<QVector3D, 4> colours;
+	};
+
+	struct Stop
+	{
+		QByteArray path;
+		QVector3D colour;
+	};
+
+	void beginMesh(const QXmlStreamAttributes &attributes);
+	bool endPatch(PatchCallback &onPatch);
+	Patch toPatch(const Edges &edges) const;
+
+private:
+	QTransform transform_;
+	QPointF origin_;
+
+	int row_;
+	int column_;
+	std::vector<Stop> stops_;
+	// the patches of the row above and of this row so far
+	std::vector<Edges> above_;
+	std::vector<Edges> current_;
+
+	unsigned int meshes_;
+	unsigned long long patches_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,91 @@
+#ifndef TESSELLATION_CACHE_HPP_INCLUDED
+#define TESSELLATION_CACHE_HPP_INCLUDED
+
+#include <QPointF>
+#include <QVector3D>
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Vertex blocks shared by everything tessellated from the same control
+// data: undo going back and forth, handles dragged back where they were,
+// duplicated patches. A block is looked up by a hash of the data it was
+// computed from, which is then compared word for word, so a collision
+// never hands out the wrong vertices. Past the byte budget the least
+// recently used blocks are dropped. Safe to call from several threads.
+class TessellationCache
+{
+public:
+	using Block = std::shared_ptr<const std::vector<float>>;
+
+	// what a block was computed from, bit for bit
+	class Key
+	{
+	public:
+		// kind tells apart blocks computed by different functions
+		explicit Key(unsigned int kind);
+
+		Key &add(unsigned int value);
+		Key &add(float value);
+		Key &add(double value);
+		Key &add(const QPointF &p) { return add(p.x()).add(p.y()); }
+		Key &add(const QVector3D &c) { return add(c.x()).add(c.y()).add(c.z()); }
+
+		std::size_t hash() const { return hash_; }
+		std::size_t size() const { return words_.size(); }
+		bool operator==(const Key &other) const { return hash_ == other.hash_ && words_ == other.words_; }
+
+	private:
+		std::vector<std::uint32_t> words_;
+		std::size_t hash_;
+	};
+
+	struct Stats
+	{
+		unsigned long long hits = 0;
+		unsigned long long misses = 0;
+		unsigned long long evictions = 0;
+		std::size_t blocks = 0;
+		std::size_t bytes = 0;
+	};
+
+	// the block cached for key, or the one compute returns, which is cached
+	// from then on. compute runs without the lock held.
+	static Block get(const Key &key, const std::function<std::vector<float>()> &compute);
+
+	// bytes of vertices and keys kept at most, 32 MiB by default
+	static std::size_t capacity();
+	static void setCapacity(std::size_t bytes);
+
+	static Stats stats();
+	// drops every block and zeroes the counters
+	static void clear();
+
+private:
+	struct KeyHash
+	{
+		std::size_t operator()(const Key &key) const { return key.hash(); }
+	};
+
+	using Entry = std::pair<Key, Block>;
+
+	static std::size_t bytes(const Entry &entry);
+	// drops blocks from the back until within capacity, the lock held
+	static void evict();
+
+private:
+	static std::mutex mutex_;
+	// most recently used first
+	static std::list<Entry> entries_;
+	static std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+	static std::size_t capacity_;
+	static Stats stats_;
+};
+
+#endif
\ No newline at end of file
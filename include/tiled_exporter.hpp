@@ -0,0 +1,29 @@
+#ifndef TILED_EXPORTER_HPP_INCLUDED
+#define TILED_EXPORTER_HPP_INCLUDED
+
+#include <QSize>
+#include <QString>
+
+class FergusonCanvas;
+
+// Renders the canvas at an arbitrary size, one tile at a time into a fixed
+// size framebuffer, and streams each finished band of tiles into a PNG. Only
+// one band of the output and a few rows of samples are held in memory at any
+// time. Tiles shrink to fit the driver's framebuffer size limits.
+class TiledExporter
+{
+public:
+	// each output pixel averages supersampling^2 rendered samples
+	TiledExporter(FergusonCanvas *canvas, QSize size, int supersampling = 1, int tileSize = 1024);
+
+	// must be called with the canvas' context current
+	bool write(const QString &filename);
+
+private:
+	FergusonCanvas *canvas_;
+	QSize size_;
+	int supersampling_;
+	int tileSize_;
+};
+
+#endif
\ No newline at end of file
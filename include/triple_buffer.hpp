@@ -0,0 +1,51 @@
+#ifndef TRIPLE_BUFFER_HPP_INCLUDED
+#define TRIPLE_BUFFER_HPP_INCLUDED
+
+#include <array>
+#include <atomic>
+
+// Lock-free single writer, single reader triple buffer. The writer fills
+// back() and publishes it; the reader picks up the most recent published
+// value with update() and reads front(). Neither side ever waits, and the
+// writer never touches the buffer the reader holds.
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() : back_{0}, middle_{1}, front_{2} {}
+
+	// writer side
+	T &back() { return buffers_[back_]; }
+
+	void publish()
+	{
+		back_ = middle_.exchange(back_ | FreshBit) & IndexMask;
+	}
+
+	// reader side, true when a newer value replaced front()
+	bool update()
+	{
+		if ((middle_.load() & FreshBit) == 0)
+			return false;
+
+		front_ = middle_.exchange(front_) & IndexMask;
+		return true;
+	}
+
+	T &front() { return buffers_[front_]; }
+	const T &front() const { return buffers_[front_]; }
+
+	// every slot, for set up and tear down while no other thread is active
+	std::array<T, 3> &buffers() { return buffers_; }
+
+private:
+	static constexpr unsigned int IndexMask = 3u;
+	static constexpr unsigned int FreshBit = 4u;
+
+	std::array<T, 3> buffers_;
+	unsigned int back_;
+	std::atomic<unsigned int> middle_;
+	unsigned int front_;
+};
+
+#endif
\ No newline at end of file
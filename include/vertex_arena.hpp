@@ -0,0 +1,75 @@
+#ifndef VERTEX_ARENA_HPP_INCLUDED
+#define VERTEX_ARENA_HPP_INCLUDED
+
+#include <QOpenGLFunctions_3_2_Core>
+#include <QOpenGLVertexArrayObject>
+#include <QOpenGLBuffer>
+
+#include <cstddef>
+#include <map>
+
+// One vertex buffer and VAO shared by every drawing whose vertices have the
+// same layout, so that their draws differ only in the ranges they cover and
+// can be merged. Ranges are whole vertices, handed out first fit; the
+// buffer doubles when full, keeping its contents and every range.
+class VertexArena
+{
+public:
+	enum Format : unsigned int
+	{
+		Position,               // float x, y
+		ColouredPosition,       // float x, y, r, g, b
+		PackedPosition,         // normalised GLshort x, y
+		PackedColouredPosition, // PackedColourVertex
+		FormatCount
+	};
+
+	struct Range
+	{
+		GLint first = 0;
+		// vertices in use and reserved
+		GLsizei count = 0;
+		GLsizei capacity = 0;
+	};
+
+	VertexArena(Format format);
+
+	Format format() const { return format_; }
+	std::size_t vertexSize() const;
+
+	// must be called with the target context current
+	void create();
+	void destroy();
+	bool isCreated() const { return vao_.isCreated(); }
+
+	QOpenGLVertexArrayObject *vao() { return &vao_; }
+
+	// Makes range hold count vertices. It only moves once it outgrows what
+	// it reserved, and then reserves twice as much; returns true when it
+	// moved, its old contents are lost then.
+	bool resize(Range &range, GLsizei count);
+	// the range is empty afterwards
+	void free(Range &range);
+	// bytes at offset from the start of range, which must hold them
+	void write(const Range &range, std::size_t offset, const void *data, std::size_t bytes);
+
+	// in vertices
+	GLsizei capacity() const { return capacity_; }
+
+private:
+	GLint allocate(GLsizei count);
+	void release(GLint first, GLsizei count);
+	void grow(GLsizei count);
+	void setupAttributes();
+
+private:
+	Format format_;
+	QOpenGLFunctions_3_2_Core *gl_;
+	QOpenGLVertexArrayObject vao_;
+	QOpenGLBuffer vbo_;
+	GLsizei capacity_;
+	// unused ranges by first vertex, never touching each other
+	std::map<GLint, GLsizei> free_;
+};
+
+#endif
\ No newline at end of file
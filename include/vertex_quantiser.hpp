@@ -0,0 +1,34 @@
+#ifndef VERTEX_QUANTISER_HPP_INCLUDED
+#define VERTEX_QUANTISER_HPP_INCLUDED
+
+#include <QOpenGLFunctions>
+#include <QVector2D>
+#include <cstddef>
+
+// 2D position as normalised 16-bit integers plus a colour packed in bytes
+struct PackedColourVertex
+{
+	GLshort position[2];
+	GLubyte colour[4];
+};
+
+// Stores positions as normalised GL_SHORT pairs relative to the bounding box
+// of a vertex array, so that pos = offset + scale * q / 32767.
+class VertexQuantiser
+{
+public:
+	// vertices holds count vertices, stride floats apart, starting with (x, y)
+	VertexQuantiser(const float *vertices, std::size_t count, std::size_t stride);
+
+	const QVector2D &offset() const { return offset_; }
+	const QVector2D &scale() const { return scale_; }
+
+	void position(const float *p, GLshort *q) const;
+	static void colour(const float *c, GLubyte *q);
+
+private:
+	QVector2D offset_;
+	QVector2D scale_;
+};
+
+#endif
\ No newline at end of file
@@ -11,6 +11,16 @@ class MainWidget: public QWidget
 public:
 	MainWidget();
 	void save();
+	void exportImage();
+	// false when the sequence did not start
+	bool recordSequence(bool record);
+	void renderAnimation();
+	void warpImage();
+	void fitImage();
+	void importSvg();
+	// false when nothing is watched
+	bool watchSvg(bool watch);
+	Renderer *renderer() const { return renderer_; }
 private:
 	Renderer *renderer_;
 };
@@ -20,10 +30,27 @@ class Window: public QMainWindow
 public:
 	Window();	
 	void save();
+	void exportImage();
+	void recordSequence(bool record);
+	void renderAnimation();
+	void warpImage();
+	void fitImage();
+	void importSvg();
+	void watchSvg(bool watch);
+	// checks the watch action, for watching started from the command line
+	void setWatchingSvg(bool watching) { watchAct_->setChecked(watching); }
+	Renderer *renderer() const;
 
 private:
 	QMenu *fileMenu_;
 	QAction *saveAct_;
+	QAction *exportAct_;
+	QAction *sequenceAct_;
+	QAction *animationAct_;
+	QAction *warpAct_;
+	QAction *fitAct_;
+	QAction *svgAct_;
+	QAction *watchAct_;
 };
 
 
@@ -1,10 +1,15 @@
 #version 330 core
 out vec4 fragColor;
 
+// set by the geometry shader for thick lines, zero otherwise
+in float edge;
+uniform float lineWidth;
 
 uniform vec3 colour;
 
 void main()
 {
-	fragColor = vec4(colour, 1.0);
+	// analytic coverage of a pixel wide box filter across the line
+	float coverage = lineWidth > 0.0 ? clamp(0.5 * lineWidth + 0.5 - abs(edge), 0.0, 1.0) : 1.0;
+	fragColor = vec4(colour, coverage);
 }
\ No newline at end of file
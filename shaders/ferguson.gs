@@ -0,0 +1,34 @@
+#version 330 core
+layout (lines) in;
+layout (triangle_strip, max_vertices = 4) out;
+
+// line width and viewport size, both in pixels
+uniform float lineWidth;
+uniform vec2 viewport;
+
+// signed distance from the centre of the line, in pixels
+out float edge;
+
+void main()
+{
+	vec2 p0 = gl_in[0].gl_Position.xy;
+	vec2 p1 = gl_in[1].gl_Position.xy;
+
+	// work in pixels so the quad is screen aligned
+	vec2 d = (p1 - p0) * viewport * 0.5;
+	float len = length(d);
+	vec2 dir = len > 0.0 ? d / len : vec2(1.0, 0.0);
+	vec2 normal = vec2(-dir.y, dir.x);
+
+	// one extra pixel on each side for the coverage ramp, and square caps
+	// of half the width so consecutive segments of a strip overlap
+	float extent = 0.5 * lineWidth + 1.0;
+	vec2 side = normal * extent * 2.0 / viewport;
+	vec2 cap = dir * 0.5 * lineWidth * 2.0 / viewport;
+
+	edge = -extent;  gl_Position = vec4(p0 - cap - side, 0.0, 1.0);  EmitVertex();
+	edge =  extent;  gl_Position = vec4(p0 - cap + side, 0.0, 1.0);  EmitVertex();
+	edge = -extent;  gl_Position = vec4(p1 + cap - side, 0.0, 1.0);  EmitVertex();
+	edge =  extent;  gl_Position = vec4(p1 + cap + side, 0.0, 1.0);  EmitVertex();
+	EndPrimitive();
+}
\ No newline at end of file
@@ -1,8 +1,19 @@
 #version 330 core
 layout (location = 0) in vec2 pos;
 
+// maps stored positions to NDC, identity unless they are quantised
+uniform vec2 offset;
+uniform vec2 scale;
+
+// scale in xy and translation in zw, set per frame; tiles of an export
+// zoom into part of the canvas through it
+uniform vec4 view;
+
+// replaced by the geometry shader when drawing thick lines
+out float edge;
 
 void main()
 {
-	gl_Position = vec4(pos, 0.0, 1.0);
+	edge = 0.0;
+	gl_Position = vec4(view.xy * (offset + scale * pos) + view.zw, 0.0, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,49 @@
+#version 330 core
+layout (location = 0) in uint patchIndex;
+layout (location = 1) in vec2 uv;
+
+// G_ij of every patch, 16 (x, y) texels per patch at 4i + j, i indexing
+// the v basis and j the u basis as in FergusonGeometry
+uniform samplerBuffer geometry;
+
+// captured by transform feedback, nothing is rasterised
+out vec2 position;
+out vec2 su;
+out vec2 sv;
+
+vec4 hermite(float t)
+{
+	float t2 = t*t;
+	float t3 = t2*t;
+	return vec4(2.0*t3 - 3.0*t2 + 1.0, t3 - 2.0*t2 + t, t3 - t2, -2.0*t3 + 3.0*t2);
+}
+
+vec4 hermiteDerivative(float t)
+{
+	float t2 = t*t;
+	return vec4(6.0*t2 - 6.0*t, 3.0*t2 - 4.0*t + 1.0, 3.0*t2 - 2.0*t, -6.0*t2 + 6.0*t);
+}
+
+void main()
+{
+	vec4 bu = hermite(uv.x), du = hermiteDerivative(uv.x);
+	vec4 bv = hermite(uv.y), dv = hermiteDerivative(uv.y);
+	int base = int(patchIndex) * 16;
+
+	position = vec2(0.0);
+	su = vec2(0.0);
+	sv = vec2(0.0);
+	for (int i = 0; i < 4; ++i) {
+		vec2 row = vec2(0.0), rowu = vec2(0.0);
+		for (int j = 0; j < 4; ++j) {
+			vec2 g = texelFetch(geometry, base + 4*i + j).xy;
+			row += bu[j] * g;
+			rowu += du[j] * g;
+		}
+		position += bv[i] * row;
+		su += bv[i] * rowu;
+		sv += dv[i] * row;
+	}
+
+	gl_Position = vec4(position, 0.0, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+#version 330 core
+out vec4 fragColor;
+
+
+in vec3 colour;
+
+void main()
+{
+	fragColor = vec4(colour, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include <animation_control.hpp>
+
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QSignalBlocker>
+
+AnimationControl::AnimationControl(QWidget *parent, Renderer *renderer)
+	:QWidget(parent), renderer_{renderer}
+{
+	QVBoxLayout *mainLayout = new QVBoxLayout();
+	mainLayout->setAlignment(Qt::AlignTop);
+
+	QHBoxLayout *titleLayout = new QHBoxLayout();
+	titleLayout->setAlignment(Qt::AlignCenter);
+	titlelabel_ = new QLabel(tr("Animation"), this);
+	titlelabel_->setStyleSheet("font-weight: bold; font-size: 11pt");
+	titlelabel_->setContentsMargins(0, 2, 0, 15);
+	titleLayout->addWidget(titlelabel_);
+	mainLayout->addLayout(titleLayout);
+
+	QHBoxLayout *timeLayout = new QHBoxLayout();
+	timelabel_ = new QLabel(tr("Time (s): "), this);
+	timeLayout->addWidget(timelabel_);
+	timespin_ = new QDoubleSpinBox(this);
+	timespin_->setRange(0.0, 3600.0);
+	timespin_->setValue(0.0);
+	timespin_->setSingleStep(0.25);
+
+	QObject::connect(
+		timespin_, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+		this, &AnimationControl::timespin_valueChanged);
+
+	timeLayout->addWidget(timespin_);
+	mainLayout->addLayout(timeLayout);
+
+	QHBoxLayout *keyLayout = new QHBoxLayout();
+	setKeybtn_ = new QPushButton(tr("Set key"), this);
+	removeKeybtn_ = new QPushButton(tr("Remove key"), this);
+	clearKeysbtn_ = new QPushButton(tr("Clear"), this);
+
+	QObject::connect(setKeybtn_, &QPushButton::clicked,
+		this, &AnimationControl::setKey_clicked);
+	QObject::connect(removeKeybtn_, &QPushButton::clicked,
+		this, &AnimationControl::removeKey_clicked);
+	QObject::connect(clearKeysbtn_, &QPushButton::clicked,
+		this, &AnimationControl::clearKeys_clicked);
+
+	keyLayout->addWidget(setKeybtn_);
+	keyLayout->addWidget(removeKeybtn_);
+	keyLayout->addWidget(clearKeysbtn_);
+	mainLayout->addLayout(keyLayout);
+
+	QHBoxLayout *playLayout = new QHBoxLayout();
+	playchk_ = new QCheckBox("Play");
+	playchk_->setCheckState(Qt::Unchecked);
+
+	QObject::connect(playchk_, &QCheckBox::stateChanged,
+		this, &AnimationControl::play_stateChanged);
+
+	playLayout->addWidget(playchk_);
+	mainLayout->addLayout(playLayout);
+
+	QHBoxLayout *keysLayout = new QHBoxLayout();
+	keyslabel_ = new QLabel(this);
+	keysLayout->addWidget(keyslabel_);
+	mainLayout->addLayout(keysLayout);
+
+	// the spin box follows the playback without seeking back
+	renderer_->onPlaybackTick([this](float time) {
+		QSignalBlocker blocker(timespin_);
+		timespin_->setValue(time);
+	});
+
+	updateKeysLabel();
+	setLayout(mainLayout);
+}
+
+void AnimationControl::timespin_valueChanged(double time)
+{
+	renderer_->seek(float(time));
+}
+
+void AnimationControl::setKey_clicked()
+{
+	renderer_->setKey();
+	updateKeysLabel();
+}
+
+void AnimationControl::removeKey_clicked()
+{
+	renderer_->removeKey();
+	updateKeysLabel();
+}
+
+void AnimationControl::clearKeys_clicked()
+{
+	renderer_->clearKeys();
+	playchk_->setCheckState(Qt::Unchecked);
+	updateKeysLabel();
+}
+
+void AnimationControl::play_stateChanged(int state)
+{
+	switch(state)
+	{
+		case Qt::Unchecked:
+			renderer_->pause();
+			timespin_->setEnabled(true);
+		break;
+
+		case Qt::Checked:
+			renderer_->play();
+			timespin_->setEnabled(!renderer_->playing());
+			if (!renderer_->playing())
+				playchk_->setCheckState(Qt::Unchecked);
+		break;
+	}
+}
+
+void AnimationControl::updateKeysLabel()
+{
+	// every channel is keyed together, so one track has all key times
+	const Track &track = renderer_->animation().track(PatchPose::P0);
+	keyslabel_->setText(tr("Keys: %1, duration %2 s")
+		.arg(track.keys().size())
+		.arg(double(renderer_->animation().duration()), 0, 'f', 2));
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include <animation_renderer.hpp>
+#include <ferguson_patch.hpp>
+#include <frame_capture.hpp>
+#include <snapshot_painter.hpp>
+
+#include <QDir>
+#include <QOpenGLFramebufferObject>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+AnimationRenderer::AnimationRenderer(const FergusonPatch &patch, const PatchAnimation &animation, QSize size, float fps)
+	:patch_{patch}, animation_{animation}, size_{size}, fps_{std::max(1.f, fps)},
+	 lineWidth_{1.f}, samples_{0}, threads_{0}
+{ }
+
+unsigned int AnimationRenderer::frames() const
+{
+	if (animation_.empty())
+		return 0;
+
+	return unsigned(std::lround(animation_.duration() * fps_)) + 1;
+}
+
+bool AnimationRenderer::render(const QString &directory)
+{
+	const unsigned int frames = this->frames();
+	const unsigned int threads = threads_ > 0 ? threads_ : std::max(1u, std::thread::hardware_concurrency());
+	// how far the tessellation may run ahead of drawing
+	const unsigned int window = 2 * threads;
+	const PatchPose rest = patch_.pose();
+
+	QOpenGLFramebufferObjectFormat format;
+	format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+	format.setSamples(samples_);
+	QOpenGLFramebufferObject fbo(size_, format);
+	if (frames == 0 || !fbo.isValid())
+		return false;
+
+	// blank images are no animation
+	SnapshotPainter painter;
+	if (!painter.init())
+		return false;
+
+	std::mutex mutex;
+	std::condition_variable produced, consumed;
+	std::map<unsigned int, SceneSnapshot> ready;
+	unsigned int next = 0;
+	unsigned int drawn = 0;
+	bool stopping = false;
+
+	// stage one: snapshots only read the patch, so frames are independent
+	auto tessellate = [&]() {
+		for (;;) {
+			unsigned int frame;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				consumed.wait(lock, [&]() { return stopping || next >= frames || next < drawn + window; });
+				if (stopping || next >= frames)
+					return;
+				frame = next++;
+			}
+
+			SceneSnapshot scene;
+			scene.lineWidth = lineWidth_;
+			scene.serial = frame;
+			patch_.snapshot(scene, animation_.evaluate(float(frame) / fps_, rest));
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				ready.emplace(frame, std::move(scene));
+			}
+			produced.notify_all();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0; i < threads; ++i)
+		workers.emplace_back(tessellate);
+
+	std::atomic<bool> failed{false};
+	{
+		// stage three: one encoder per thread, the images are independent files
+		FrameCapture capture(3, threads);
+		capture.init();
+		capture.encoder().onDone([&failed](const QString &, bool ok) {
+			if (!ok)
+				failed = true;
+		});
+
+		// stage two: draw in order and queue the read back
+		QDir dir(directory);
+		for (unsigned int frame = 0; frame < frames && !failed; ++frame) {
+			SceneSnapshot scene;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				produced.wait(lock, [&]() { return ready.count(frame) > 0; });
+				auto it = ready.find(frame);
+				scene = std::move(it->second);
+				ready.erase(it);
+				drawn = frame + 1;
+			}
+			consumed.notify_all();
+
+			fbo.bind();
+			painter.paint(scene, size_);
+
+			capture.waitForSlot();
+			capture.capture(fbo.handle(), size_, samples_,
+				dir.filePath(QString("frame_%1.png").arg(frame, 5, 10, QChar('0'))));
+			capture.poll();
+
+			// images read back faster than they are encoded would pile up
+			capture.encoder().waitForBacklog(window);
+
+			if (progress_)
+				progress_(frame + 1, frames);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		consumed.notify_all();
+		for (std::thread &worker : workers)
+			worker.join();
+
+		fbo.release();
+		capture.cleanUp();
+		painter.cleanUp();
+		// the encoders finish the queued images when capture goes out of scope
+	}
+
+	return !failed;
+}
\ No newline at end of file
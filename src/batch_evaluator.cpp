@@ -0,0 +1,250 @@
+#include <batch_evaluator.hpp>
+#include <parallel_for.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <thread>
+
+namespace
+{
+	// patch index, u and v
+	const std::size_t RecordSize = 3 * 4;
+
+	bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+	}
+
+	// from_chars ignores the locale, which QCoreApplication sets from the environment
+	const char *parseNumber(const char *p, const char *end, double &value)
+	{
+		std::from_chars_result result = std::from_chars(p, end, value);
+		if (result.ec != std::errc() || (result.ptr != end && !isSpace(*result.ptr) && *result.ptr != '#'))
+			return nullptr;
+		return result.ptr;
+	}
+
+	void appendText(float value, char separator, std::vector<char> &out)
+	{
+		char buffer[32];
+		std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+		*result.ptr++ = separator;
+		out.insert(out.end(), buffer, result.ptr);
+	}
+
+	void appendBinary(float value, std::vector<char> &out)
+	{
+		const char *bytes = reinterpret_cast<const char *>(&value);
+		out.insert(out.end(), bytes, bytes + sizeof(float));
+	}
+}
+
+BatchEvaluator::BatchEvaluator(std::vector<FergusonGeometry> patches)
+	:patches_{std::move(patches)}, inputFormat_{Format::Text}, outputFormat_{Format::Text},
+	 derivatives_{false}, chunkSize_{std::size_t(8) << 20}, evaluated_{0}
+{ }
+
+bool BatchEvaluator::readPatches(QIODevice &in, std::vector<FergusonGeometry> &patches)
+{
+	QByteArray data = in.readAll();
+	const char *p = data.constData(), *end = p + data.size();
+
+	std::vector<double> numbers;
+	while (p < end) {
+		if (isSpace(*p)) {
+			++p;
+		} else if (*p == '#') {
+			p = std::find(p, end, '\n');
+		} else {
+			double value;
+			p = parseNumber(p, end, value);
+			if (p == nullptr)
+				return false;
+			numbers.push_back(value);
+		}
+	}
+
+	if (numbers.empty() || numbers.size() % 24 != 0)
+		return false;
+
+	patches.clear();
+	for (std::size_t i = 0; i < numbers.size(); i += 24) {
+		QPointF q[12];
+		for (unsigned int k = 0; k < 12; ++k)
+			q[k] = QPointF(numbers[i + 2*k], numbers[i + 2*k + 1]);
+		patches.emplace_back(q[0], q[1], q[2], q[3], q[4], q[5], q[6], q[7], q[8], q[9], q[10], q[11]);
+	}
+	return true;
+}
+
+bool BatchEvaluator::run(QIODevice &in, QIODevice &out)
+{
+	evaluated_ = 0;
+
+	bool binary = inputFormat_ == Format::Binary;
+	std::size_t size = binary ? std::max(RecordSize, chunkSize_ / RecordSize * RecordSize) : std::max<std::size_t>(1, chunkSize_);
+
+	auto read = [&in, size](std::vector<char> &buffer) {
+		buffer.resize(size);
+		qint64 n = in.read(buffer.data(), qint64(size));
+		buffer.resize(n > 0 ? std::size_t(n) : 0);
+		return n >= 0;
+	};
+
+	// the next chunk is read while this one is evaluated and written
+	std::vector<char> data, chunk;
+	std::future<bool> reading = std::async(std::launch::async, read, std::ref(chunk));
+	std::vector<Slice> slices;
+
+	for (;;) {
+		if (!reading.get())
+			return false;
+		bool last = chunk.empty();
+		data.insert(data.end(), chunk.begin(), chunk.end());
+		if (!last)
+			reading = std::async(std::launch::async, read, std::ref(chunk));
+
+		// whole lines or records only, the rest waits for the next chunk
+		std::size_t whole = data.size();
+		if (binary) {
+			whole = data.size() / RecordSize * RecordSize;
+			if (last && whole != data.size())
+				return false;
+		} else if (!last) {
+			std::vector<char>::reverse_iterator newline = std::find(data.rbegin(), data.rend(), '\n');
+			whole = std::size_t(data.rend() - newline);
+			if (whole == 0 && data.size() > size)
+				return false;
+		}
+
+		slice(data.data(), data.data() + whole, slices);
+		parallelFor(slices.size(), [this, &slices](std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i)
+				evaluate(slices[i]);
+		});
+
+		for (const Slice &s : slices) {
+			if (!s.ok)
+				return false;
+			if (!s.output.empty() && out.write(s.output.data(), qint64(s.output.size())) != qint64(s.output.size()))
+				return false;
+			evaluated_ += s.samples;
+		}
+
+		if (last)
+			return true;
+		data.erase(data.begin(), data.begin() + std::ptrdiff_t(whole));
+	}
+}
+
+void BatchEvaluator::slice(const char *begin, const char *end, std::vector<Slice> &slices) const
+{
+	// one slice per core, parallelFor runs them side by side
+	std::size_t pieces = std::max(1u, std::thread::hardware_concurrency());
+	std::size_t step = std::max<std::size_t>(std::size_t(end - begin) / pieces, 4096);
+	if (inputFormat_ == Format::Binary)
+		step = (step + RecordSize - 1) / RecordSize * RecordSize;
+
+	slices.clear();
+	while (begin < end) {
+		const char *stop = begin + std::min(step, std::size_t(end - begin));
+		if (inputFormat_ == Format::Text && stop < end)
+			stop = std::min(end, std::find(stop, end, '\n') + 1);
+
+		Slice s;
+		s.begin = begin;
+		s.end = stop;
+		s.samples = 0;
+		s.ok = true;
+		slices.push_back(std::move(s));
+		begin = stop;
+	}
+}
+
+void BatchEvaluator::evaluate(Slice &slice) const
+{
+	std::size_t values = derivatives_ ? 6 : 2;
+	std::size_t records = inputFormat_ == Format::Binary ?
+		std::size_t(slice.end - slice.begin) / RecordSize : std::size_t(slice.end - slice.begin) / 8;
+	slice.output.reserve(records * values * (outputFormat_ == Format::Binary ? sizeof(float) : 14));
+
+	if (inputFormat_ == Format::Binary) {
+		for (const char *p = slice.begin; p < slice.end; p += RecordSize) {
+			std::uint32_t patch;
+			float uv[2];
+			std::memcpy(&patch, p, sizeof(patch));
+			std::memcpy(uv, p + sizeof(patch), sizeof(uv));
+			if (!evaluate(patch, uv[0], uv[1], slice.output)) {
+				slice.ok = false;
+				return;
+			}
+			++slice.samples;
+		}
+		return;
+	}
+
+	const char *p = slice.begin;
+	while (p < slice.end) {
+		const char *eol = std::find(p, slice.end, '\n');
+
+		double numbers[3];
+		unsigned int count = 0;
+		while (p < eol) {
+			if (isSpace(*p)) {
+				++p;
+				continue;
+			}
+			if (*p == '#' || count == 3)
+				break;
+			p = parseNumber(p, eol, numbers[count++]);
+			if (p == nullptr) {
+				slice.ok = false;
+				return;
+			}
+		}
+
+		if (count != 0) {
+			bool indexed = count == 3;
+			double index = indexed ? numbers[0] : 0.0;
+			// a comment after the numbers is fine, a fourth number is not
+			if (count < 2 || (p < eol && *p != '#') || index < 0.0 || index != std::floor(index) ||
+			    index >= double(patches_.size()) ||
+			    !evaluate(std::uint32_t(index), float(numbers[indexed ? 1 : 0]), float(numbers[indexed ? 2 : 1]), slice.output)) {
+				slice.ok = false;
+				return;
+			}
+			++slice.samples;
+		}
+
+		p = eol + 1;
+	}
+}
+
+bool BatchEvaluator::evaluate(std::uint32_t patch, float u, float v, std::vector<char> &out) const
+{
+	if (patch >= patches_.size())
+		return false;
+
+	const FergusonGeometry &g = patches_[patch];
+	QPointF point[3];
+	point[0] = g.s(u, v);
+	if (derivatives_) {
+		point[1] = g.su(u, v);
+		point[2] = g.sv(u, v);
+	}
+
+	unsigned int points = derivatives_ ? 3 : 1;
+	for (unsigned int i = 0; i < points; ++i) {
+		if (outputFormat_ == Format::Binary) {
+			appendBinary(float(point[i].x()), out);
+			appendBinary(float(point[i].y()), out);
+		} else {
+			appendText(float(point[i].x()), ' ', out);
+			appendText(float(point[i].y()), i + 1 == points ? '\n' : ' ', out);
+		}
+	}
+	return true;
+}
\ No newline at end of file
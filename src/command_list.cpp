@@ -0,0 +1,150 @@
+#include <command_list.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <tuple>
+
+namespace {
+
+auto stateKey(const DrawPacket &p)
+{
+	// drawings share the VAO of each vertex layout, so this is where
+	// packets of different drawings meet
+	return std::make_tuple(p.layer,
+		reinterpret_cast<std::uintptr_t>(p.shader),
+		reinterpret_cast<std::uintptr_t>(p.vao),
+		reinterpret_cast<std::uintptr_t>(p.indices),
+		p.offset.x(), p.offset.y(), p.scale.x(), p.scale.y(),
+		p.colour.x(), p.colour.y(), p.colour.z(),
+		p.mode);
+}
+
+// independent primitives can be joined when their ranges touch
+bool joinable(GLenum mode)
+{
+	return mode == GL_POINTS || mode == GL_LINES || mode == GL_TRIANGLES;
+}
+
+}
+
+CommandList::CommandList()
+	:built_{false}, stateChanges_{0}
+{ }
+
+void CommandList::clear()
+{
+	packets_.clear();
+	built_ = false;
+}
+
+void CommandList::add(const DrawPacket &packet)
+{
+	if (packet.count <= 0)
+		return;
+
+	packets_.push_back(packet);
+	built_ = false;
+}
+
+bool CommandList::sameState(const DrawPacket &a, const DrawPacket &b)
+{
+	return stateKey(a) == stateKey(b);
+}
+
+bool CommandList::stateLess(const DrawPacket &a, const DrawPacket &b)
+{
+	return std::make_tuple(stateKey(a), a.baseVertex, a.first) < std::make_tuple(stateKey(b), b.baseVertex, b.first);
+}
+
+void CommandList::build()
+{
+	// equal states end up next to each other, ordered by their ranges
+	std::sort(packets_.begin(), packets_.end(), stateLess);
+
+	batches_.clear();
+	firsts_.clear();
+	counts_.clear();
+	baseVertices_.clear();
+	indexOffsets_.clear();
+
+	for (std::size_t i = 0; i < packets_.size(); ++i) {
+		const DrawPacket &p = packets_[i];
+
+		bool merge = !batches_.empty() && sameState(*batches_.back().state, p);
+		if (!merge) {
+			batches_.push_back({ &p, firsts_.size(), firsts_.size() });
+		}
+		else if (p.indices == nullptr && joinable(p.mode) && firsts_.back() + counts_.back() == p.first) {
+			counts_.back() += p.count;
+			continue;
+		}
+
+		firsts_.push_back(p.first);
+		counts_.push_back(p.count);
+		baseVertices_.push_back(p.baseVertex);
+		indexOffsets_.push_back(reinterpret_cast<const void*>(p.first * sizeof(GLuint)));
+		batches_.back().end = firsts_.size();
+	}
+
+	built_ = true;
+}
+
+void CommandList::submit(QOpenGLFunctions_3_2_Core *gl)
+{
+	if (!built_)
+		build();
+
+	stateChanges_ = 0;
+	const DrawPacket *current = nullptr;
+
+	gl->glEnable(GL_PRIMITIVE_RESTART);
+	gl->glPrimitiveRestartIndex(0xFFFFFFFFu);
+
+	for (const Batch &batch : batches_) {
+		const DrawPacket &p = *batch.state;
+
+		if (current == nullptr || current->shader != p.shader) {
+			p.shader->bind();
+			++stateChanges_;
+		}
+		bool vaoChanged = current == nullptr || current->vao != p.vao;
+		if (vaoChanged) {
+			p.vao->bind();
+			++stateChanges_;
+		}
+		// the element buffer binding is part of the VAO
+		if (p.indices != nullptr && (vaoChanged || current->indices != p.indices)) {
+			p.indices->bind();
+			++stateChanges_;
+		}
+
+		// uniforms live in the program, so they are reset after switching it
+		bool shaderChanged = current == nullptr || current->shader != p.shader;
+		if (shaderChanged || current->offset != p.offset || current->scale != p.scale) {
+			p.shader->setUniformValue("offset", p.offset);
+			p.shader->setUniformValue("scale", p.scale);
+			++stateChanges_;
+		}
+		if (p.indices == nullptr && (shaderChanged || current->colour != p.colour)) {
+			p.shader->setUniformValue("colour", p.colour);
+			++stateChanges_;
+		}
+		current = &p;
+
+		GLsizei size = GLsizei(batch.end - batch.begin);
+		if (p.indices != nullptr && size == 1)
+			gl->glDrawElementsBaseVertex(p.mode, counts_[batch.begin], GL_UNSIGNED_INT,
+				indexOffsets_[batch.begin], baseVertices_[batch.begin]);
+		else if (p.indices != nullptr)
+			gl->glMultiDrawElementsBaseVertex(p.mode, &counts_[batch.begin], GL_UNSIGNED_INT,
+				&indexOffsets_[batch.begin], size, &baseVertices_[batch.begin]);
+		else if (size == 1)
+			gl->glDrawArrays(p.mode, firsts_[batch.begin], counts_[batch.begin]);
+		else
+			gl->glMultiDrawArrays(p.mode, &firsts_[batch.begin], &counts_[batch.begin], size);
+	}
+
+	gl->glDisable(GL_PRIMITIVE_RESTART);
+	if (current != nullptr)
+		current->vao->release();
+}
\ No newline at end of file
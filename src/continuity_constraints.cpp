@@ -0,0 +1,282 @@
+#include <continuity_constraints.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+	// every boundary curve as start corner, start tangent, end corner and end tangent
+	const unsigned int Curves[4][4] = {
+		{ PatchPose::P0, PatchPose::T01, PatchPose::P1, PatchPose::T10 },
+		{ PatchPose::P1, PatchPose::T13, PatchPose::P3, PatchPose::T31 },
+		{ PatchPose::P2, PatchPose::T23, PatchPose::P3, PatchPose::T32 },
+		{ PatchPose::P0, PatchPose::T02, PatchPose::P2, PatchPose::T20 } };
+
+	// cosine between tangents within about 5 degrees of opposite
+	const double Continues = 0.996;
+
+	// a curve leaving a corner
+	struct End
+	{
+		std::uint32_t tangent;
+		std::size_t patch;
+		// +1 at the start of the curve, -1 at its end
+		int side;
+		// side * tangent, pointing into the curve
+		QPointF out;
+	};
+
+	QPointF midpoint(const PatchPose &pose, const unsigned int *curve)
+	{
+		return 0.5 * (pose[curve[0]] + pose[curve[2]]) + 0.125 * (pose[curve[1]] - pose[curve[3]]);
+	}
+
+	double length(const QPointF &p)
+	{
+		return std::hypot(p.x(), p.y());
+	}
+
+	std::uint64_t pairKey(std::uint64_t a, std::uint64_t b)
+	{
+		return (a << 32) | (b & 0xffffffffu);
+	}
+}
+
+void ContinuityConstraints::Sets::reset(std::size_t size)
+{
+	parent.resize(size);
+	std::iota(parent.begin(), parent.end(), std::uint32_t(0));
+	sign.assign(size, 1);
+	members.clear();
+	members.resize(size);
+}
+
+std::uint32_t ContinuityConstraints::Sets::find(std::uint32_t h, int &s)
+{
+	std::uint32_t root = h;
+	s = 1;
+	while (parent[root] != root) {
+		s *= sign[root];
+		root = parent[root];
+	}
+
+	// the path is pointed at the root, its signs made relative to it
+	int along = s;
+	for (std::uint32_t x = h; x != root && parent[x] != root; ) {
+		std::uint32_t next = parent[x];
+		int step = sign[x];
+		parent[x] = root;
+		sign[x] = static_cast<signed char>(along);
+		along *= step;
+		x = next;
+	}
+	return root;
+}
+
+bool ContinuityConstraints::Sets::join(std::uint32_t a, std::uint32_t b, int s)
+{
+	int sa, sb;
+	std::uint32_t ra = find(a, sa), rb = find(b, sb);
+	if (ra == rb)
+		return false;
+
+	// value(a) = sa * value(ra) and value(b) = sb * value(rb)
+	int relative = sa * s * sb;
+	if (std::max<std::size_t>(members[ra].size(), 1) < std::max<std::size_t>(members[rb].size(), 1))
+		std::swap(ra, rb);
+	parent[rb] = ra;
+	sign[rb] = static_cast<signed char>(relative);
+
+	if (members[ra].empty())
+		members[ra].push_back(ra);
+	if (members[rb].empty())
+		members[rb].push_back(rb);
+	members[ra].insert(members[ra].end(), members[rb].begin(), members[rb].end());
+	std::vector<std::uint32_t>().swap(members[rb]);
+	return true;
+}
+
+void ContinuityConstraints::detect(const Patches &patches, Continuity continuity, double tolerance)
+{
+	clear();
+	patches_ = patches;
+	continuity_ = continuity;
+	if (continuity == Continuity::None)
+		return;
+
+	std::size_t handles = patches.size() * Handles;
+	corners_.reset(handles);
+	values_.reset(handles);
+	directions_.reset(handles);
+
+	std::vector<PatchPose> poses(patches.size());
+	for (std::size_t p = 0; p < patches.size(); ++p)
+		poses[p] = patches[p]->pose();
+
+	// coincident corners, found through a grid of cells the size of the tolerance
+	double cell = std::max(tolerance, 1e-12);
+	std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> grid;
+	for (std::size_t p = 0; p < patches.size(); ++p)
+		for (unsigned int channel = PatchPose::P0; channel <= PatchPose::P3; ++channel) {
+			const QPointF &at = poses[p][channel];
+			std::int64_t cx = std::int64_t(std::floor(at.x() / cell)), cy = std::int64_t(std::floor(at.y() / cell));
+			std::uint32_t h = std::uint32_t(p * Handles + channel);
+
+			for (std::int64_t dx = -1; dx <= 1; ++dx)
+				for (std::int64_t dy = -1; dy <= 1; ++dy) {
+					auto found = grid.find(pairKey(std::uint64_t(cx + dx), std::uint64_t(cy + dy)));
+					if (found == grid.end())
+						continue;
+					for (std::uint32_t other : found->second)
+						if (other / Handles != p && length(poses[other / Handles][other % Handles] - at) <= tolerance)
+							joinCorners(h, other);
+				}
+			grid[pairKey(std::uint64_t(cx), std::uint64_t(cy))].push_back(h);
+		}
+
+	// the curves leaving every set of coincident corners, and the curves
+	// running between every pair of them
+	std::unordered_map<std::uint32_t, std::vector<End>> ends;
+	std::unordered_map<std::uint64_t, std::vector<std::pair<std::size_t, unsigned int>>> edges;
+	for (std::size_t p = 0; p < patches.size(); ++p)
+		for (unsigned int c = 0; c < 4; ++c) {
+			const unsigned int *curve = Curves[c];
+			int unused;
+			std::uint32_t start = corners_.find(std::uint32_t(p * Handles + curve[0]), unused);
+			std::uint32_t end = corners_.find(std::uint32_t(p * Handles + curve[2]), unused);
+			ends[start].push_back({ std::uint32_t(p * Handles + curve[1]), p, 1, poses[p][curve[1]] });
+			ends[end].push_back({ std::uint32_t(p * Handles + curve[3]), p, -1, -poses[p][curve[3]] });
+
+			// an edge shared with an earlier patch is the same curve, either way round
+			std::vector<std::pair<std::size_t, unsigned int>> &along = edges[pairKey(std::min(start, end), std::max(start, end))];
+			for (const std::pair<std::size_t, unsigned int> &other : along) {
+				const unsigned int *otherCurve = Curves[other.second];
+				if (other.first == p || length(midpoint(poses[other.first], otherCurve) - midpoint(poses[p], curve)) > tolerance)
+					continue;
+
+				std::uint32_t base = std::uint32_t(other.first * Handles);
+				bool sameWay = corners_.find(base + otherCurve[0], unused) == start;
+				joinTangents(std::uint32_t(p * Handles + curve[1]), base + otherCurve[sameWay ? 1 : 3], sameWay ? 1 : -1, false);
+				joinTangents(std::uint32_t(p * Handles + curve[3]), base + otherCurve[sameWay ? 3 : 1], sameWay ? 1 : -1, false);
+			}
+			along.emplace_back(p, c);
+		}
+
+	// curves of different patches leaving a corner in opposite directions
+	// continue each other: their tangents, taken the same way, are tied
+	for (const auto &corner : ends) {
+		const std::vector<End> &leaving = corner.second;
+		for (std::size_t i = 0; i < leaving.size(); ++i)
+			for (std::size_t j = i + 1; j < leaving.size(); ++j) {
+				const End &a = leaving[i], &b = leaving[j];
+				double la = length(a.out), lb = length(b.out);
+				if (a.patch == b.patch || la == 0.0 || lb == 0.0)
+					continue;
+				double cosine = (a.out.x() * b.out.x() + a.out.y() * b.out.y()) / (la * lb);
+				if (cosine <= -Continues)
+					joinTangents(a.tangent, b.tangent, -a.side * b.side, continuity == Continuity::G1);
+			}
+	}
+}
+
+void ContinuityConstraints::clear()
+{
+	patches_.clear();
+	continuity_ = Continuity::None;
+	corners_.reset(0);
+	values_.reset(0);
+	directions_.reset(0);
+	constraints_ = 0;
+	lastTouched_ = 0;
+}
+
+void ContinuityConstraints::joinCorners(std::uint32_t a, std::uint32_t b)
+{
+	if (std::max(a, b) >= corners_.parent.size())
+		return;
+	corners_.join(a, b, 1);
+	++constraints_;
+}
+
+void ContinuityConstraints::joinTangents(std::uint32_t a, std::uint32_t b, int sign, bool collinear)
+{
+	if (std::max(a, b) >= directions_.parent.size())
+		return;
+	if (!collinear)
+		values_.join(a, b, sign);
+	directions_.join(a, b, sign);
+	++constraints_;
+}
+
+std::vector<std::pair<std::size_t, PatchPose>> ContinuityConstraints::enforce(const std::vector<std::uint32_t> &edited)
+{
+	std::vector<std::pair<std::size_t, PatchPose>> changed;
+	lastTouched_ = 0;
+	if (continuity_ == Continuity::None)
+		return changed;
+
+	// the poses of the patches touched so far, each read once
+	std::unordered_map<std::size_t, std::size_t> slots;
+	auto pose = [&](std::size_t p) -> PatchPose & {
+		auto found = slots.find(p);
+		if (found == slots.end()) {
+			found = slots.emplace(p, changed.size()).first;
+			changed.emplace_back(p, patches_[p]->pose());
+		}
+		return changed[found->second].second;
+	};
+
+	// corner and tangent handles never share a root
+	std::unordered_set<std::uint32_t> solved;
+	for (std::uint32_t h : edited) {
+		if (h >= corners_.parent.size())
+			continue;
+		std::size_t p = h / Handles;
+		unsigned int channel = h % Handles;
+		int s;
+
+		if (channel <= PatchPose::P3) {
+			std::uint32_t root = corners_.find(h, s);
+			if (corners_.members[root].empty() || !solved.insert(root).second)
+				continue;
+
+			QPointF at = pose(p)[channel];
+			for (std::uint32_t m : corners_.members[root])
+				pose(m / Handles)[m % Handles] = at;
+			lastTouched_ += corners_.members[root].size();
+			continue;
+		}
+
+		std::uint32_t root = directions_.find(h, s);
+		if (directions_.members[root].empty() || !solved.insert(root).second)
+			continue;
+
+		// a tangent of no length has no direction to pass on
+		QPointF t = pose(p)[channel];
+		double l = length(t);
+		if (l == 0.0)
+			continue;
+
+		int sv;
+		std::uint32_t valueRoot = values_.find(h, sv);
+		QPointF value = double(sv) * t, direction = double(s) * t / l;
+
+		// tangents equal to the edited one take its value, the others only
+		// its direction and keep their length
+		for (std::uint32_t m : directions_.members[root]) {
+			int sm, svm;
+			directions_.find(m, sm);
+			QPointF &target = pose(m / Handles)[m % Handles];
+			if (values_.find(m, svm) == valueRoot)
+				target = double(svm) * value;
+			else
+				target = double(sm) * direction * length(target);
+		}
+		lastTouched_ += directions_.members[root].size();
+	}
+
+	return changed;
+}
\ No newline at end of file
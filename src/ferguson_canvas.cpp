@@ -1,62 +1,489 @@
 #include <ferguson_canvas.hpp>
+#include <ferguson_patch.hpp>
 
+#include <QDebug>
+#include <QMatrix4x4>
+#include <QMetaObject>
+#include <QOpenGLContext>
+#include <QVector2D>
+#include <QVector4D>
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
 
 FergusonCanvas::FergusonCanvas(QOpenGLWidget *renderer, int width, int height)
-	:renderer_{renderer}, width_{width}, height_{height} 
-{ }
+	:renderer_{renderer}, width_{width}, height_{height}, 
+	 layerCaching_{false}, layerValid_{false},
+	 gl_{nullptr}, lineWidth_{1.5f}, snapshotScheduled_{false}, snapshotSerial_{0},
+	 updateRequests_{0}, commandsValid_{false}, patchesValid_{false}
+{
+	for (unsigned int f = 0; f < VertexArena::FormatCount; ++f)
+		arenas_[f] = std::make_unique<VertexArena>(VertexArena::Format(f));
+}
 
 void FergusonCanvas::init()
 {	
 	initializeOpenGLFunctions();
+	gl_ = QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_3_2_Core>();
+	gl_->initializeOpenGLFunctions();
 	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
 
-	for (std::shared_ptr<Drawing> d : drawings_){
+	// lines carry their coverage in alpha, the framebuffer stays opaque
+	glEnable(GL_BLEND);
+	glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	shader_ = ShaderRegistry::acquire("ferguson");
+	lineShader_ = ShaderRegistry::acquire("ferguson_line");
+	fillShader_ = ShaderRegistry::acquire("ferguson_fill");
+	if (shader_ == nullptr || lineShader_ == nullptr || fillShader_ == nullptr) {
+		// the registry has logged why; the canvas stays uninitialised and only clears
+		qWarning() << "FergusonCanvas: missing shader programs, nothing is drawn";
+		shader_.reset();
+		lineShader_.reset();
+		fillShader_.reset();
+		return;
+	}
+	for (const std::unique_ptr<VertexArena> &arena : arenas_)
+		arena->create();
+
+	for (const std::shared_ptr<Drawing> &d : drawings_){
 		d->init();
 	}
 }
 
 void FergusonCanvas::render()
 {
+	if (shader_ == nullptr) {
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		return;
+	}
+
+	if (renderThread_) {
+		renderThreaded();
+		return;
+	}
+
+	checkFoldovers();
+	qreal ratio = renderer_->devicePixelRatioF();
+	prepareShaders(QRectF(-1.f, -1.f, 2.f, 2.f), QSize(int(width_ * ratio), int(height_ * ratio)), float(ratio));
+
+	if (layerCaching_) {
+		renderCached();
+		return;
+	}
+
+	renderCommands();
+}
+
+void FergusonCanvas::setLineWidth(float width)
+{
+	lineWidth_ = width;
+	layerValid_ = false;
+	update();
+}
+
+void FergusonCanvas::prepareShaders(const QRectF &region, QSize viewport, float pixelScale)
+{
+	// maps region onto the whole viewport
+	QVector4D view(
+		2.f / float(region.width()), 2.f / float(region.height()),
+		-2.f * float(region.center().x()) / float(region.width()),
+		-2.f * float(region.center().y()) / float(region.height()));
+
+	for (QOpenGLShaderProgram *program : { shader_.get(), lineShader_.get(), fillShader_.get() }) {
+		program->bind();
+		program->setUniformValue("view", view);
+	}
+
+	lineShader_->bind();
+	lineShader_->setUniformValue("lineWidth", lineWidth_ * pixelScale);
+	lineShader_->setUniformValue("viewport", QVector2D(float(viewport.width()), float(viewport.height())));
+}
+
+void FergusonCanvas::renderRegion(const QRectF &region, QSize viewport, float pixelScale)
+{
+	checkFoldovers();
+	glViewport(0, 0, viewport.width(), viewport.height());
+	if (shader_ == nullptr) {
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		return;
+	}
+	prepareShaders(region, viewport, pixelScale);
+	renderCommands();
+}
+
+void FergusonCanvas::renderCommands()
+{
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	bool changed = !commandsValid_;
+	for (const std::shared_ptr<Drawing> &d : drawings_)
+		changed = changed || d->commandsChanged();
+
+	if (changed) {
+		commands_.clear();
+		recorded_.resize(drawings_.size());
+		for (std::size_t i = 0; i < drawings_.size(); ++i)
+			recorded_[i] = drawings_[i]->record(commands_);
+		commandsValid_ = true;
+	}
+
+	commands_.submit(gl_);
+
+	for (std::size_t i = 0; i < drawings_.size(); ++i) {
+		if (recorded_[i])
+			drawings_[i]->frameRendered();
+		else
+			drawings_[i]->render();
+	}
+}
+
+void FergusonCanvas::setLayerCaching(bool enabled)
+{
+	layerCaching_ = enabled;
+	layerValid_ = false;
+}
+
+void FergusonCanvas::setThreaded(bool enabled)
+{
+	if (enabled == threaded())
+		return;
+
+	if (enabled) {
+		qreal ratio = renderer_->devicePixelRatioF();
+		QSize size(int(width_ * ratio), int(height_ * ratio));
+
+		renderer_->makeCurrent();
+		renderThread_ = std::make_unique<RenderThread>(
+			renderer_->context(), size, renderer_->format().samples());
+		renderer_->doneCurrent();
+
+		// runs on the render thread, the repaint is queued to the GUI thread
+		QOpenGLWidget *renderer = renderer_;
+		renderThread_->onFrameReady([renderer]() {
+			QMetaObject::invokeMethod(renderer, "update", Qt::QueuedConnection);
+		});
+		renderThread_->start();
+		publishSnapshot();
+		return;
+	}
+
+	renderThread_->stop();
+	renderer_->makeCurrent();
+	renderThread_.reset();
+	if (blitter_.isCreated())
+		blitter_.destroy();
+
+	// the drawings skipped their buffer updates while threaded
+	for (const std::shared_ptr<Drawing> &d : drawings_)
+		d->syncGPUBuffers();
+	layerValid_ = false;
+	renderer_->doneCurrent();
+	renderer_->update();
+}
+
+void FergusonCanvas::setDrawings(std::vector<std::shared_ptr<Drawing>> drawings)
+{
+	// the drawings keep their buffers on the GUI context, threaded or not
+	bool initialised = shader_ != nullptr;
+	if (initialised) {
+		renderer_->makeCurrent();
+		for (const std::shared_ptr<Drawing> &d : drawings_)
+			d->cleanUp();
+	}
+
+	drawings_ = std::move(drawings);
+	recorded_.clear();
+	commandsValid_ = false;
+	layerValid_ = false;
+	patchesValid_ = false;
+
+	if (initialised) {
+		for (const std::shared_ptr<Drawing> &d : drawings_)
+			d->init();
+		renderer_->doneCurrent();
+	}
+
+	update();
+}
+
+void FergusonCanvas::updateDrawings(std::vector<std::shared_ptr<Drawing>> drawings)
+{
+	std::unordered_set<const Drawing*> before, after;
+	for (const std::shared_ptr<Drawing> &d : drawings_)
+		before.insert(d.get());
+	for (const std::shared_ptr<Drawing> &d : drawings)
+		after.insert(d.get());
+
+	bool initialised = shader_ != nullptr;
+	if (initialised) {
+		renderer_->makeCurrent();
+		for (const std::shared_ptr<Drawing> &d : drawings_)
+			if (after.count(d.get()) == 0)
+				d->cleanUp();
+		for (const std::shared_ptr<Drawing> &d : drawings)
+			if (before.count(d.get()) == 0)
+				d->init();
+		renderer_->doneCurrent();
+	}
+
+	// drawings that stay in place invalidate what they changed themselves
+	bool changed = drawings != drawings_;
+	drawings_ = std::move(drawings);
+	if (changed) {
+		recorded_.clear();
+		commandsValid_ = false;
+		layerValid_ = false;
+		patchesValid_ = false;
+	}
+
+	update();
+}
+
+void FergusonCanvas::update()
+{
+	++updateRequests_;
+
+	if (!renderThread_) {
+		renderer_->update();
+		return;
+	}
+
+	// bursts of edits within one event loop iteration make a single snapshot
+	if (snapshotScheduled_)
+		return;
+
+	snapshotScheduled_ = true;
+	QMetaObject::invokeMethod(renderer_, [this]() { publishSnapshot(); }, Qt::QueuedConnection);
+}
+
+void FergusonCanvas::publishSnapshot()
+{
+	snapshotScheduled_ = false;
+	if (!renderThread_)
+		return;
+
+	// while threaded the patches only keep the results, nothing is uploaded
+	checkFoldovers();
+
+	SceneSnapshot &scene = renderThread_->snapshot();
+	scene.clear();
+	for (const std::shared_ptr<Drawing> &d : drawings_)
+		d->snapshot(scene);
+	scene.lineWidth = float(lineWidth_ * renderer_->devicePixelRatioF());
+	scene.serial = ++snapshotSerial_;
+
+	renderThread_->publish();
+}
+
+void FergusonCanvas::checkFoldovers()
+{
+	std::vector<std::size_t> edited;
+	if (!patchesValid_) {
+		std::vector<FergusonPatch*> patches;
+		for (const std::shared_ptr<Drawing> &d : drawings_)
+			if (FergusonPatch *patch = dynamic_cast<FergusonPatch*>(d.get()))
+				patches.push_back(patch);
+
+		// results are indexed by patch, a reordered scene is checked afresh
+		if (patches != patches_)
+			foldovers_.clear();
+		patches_ = std::move(patches);
+		patchIndex_.clear();
+		for (std::size_t i = 0; i < patches_.size(); ++i)
+			patchIndex_[patches_[i]] = i;
+		patchesValid_ = true;
+	} else if (foldoverTouched_.empty()) {
+		return;
+	}
+
+	for (const FergusonPatch *patch : foldoverTouched_) {
+		auto found = patchIndex_.find(patch);
+		if (found != patchIndex_.end())
+			edited.push_back(found->second);
+	}
+	foldoverTouched_.clear();
+
+	std::vector<FergusonGeometry> geometries;
+	geometries.reserve(patches_.size());
+	for (const FergusonPatch *patch : patches_)
+		geometries.push_back(patch->geometry());
+
+	const std::vector<FoldoverChecker::Result> &results = foldovers_.update(geometries, edited);
+	for (std::size_t i : foldovers_.checked())
+		patches_[i]->setFoldover(results[i]);
+}
+
+void FergusonCanvas::renderThreaded()
+{
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	RenderedFrame *frame = renderThread_->acquireFrame();
+	if (frame == nullptr)
+		return;
+
+	if (!blitter_.isCreated())
+		blitter_.create();
+
+	// waits on the GPU, never on the CPU
+	gl_->glWaitSync(frame->ready, 0, GL_TIMEOUT_IGNORED);
+
+	blitter_.bind();
+	blitter_.blit(frame->target->texture(), QMatrix4x4(), QOpenGLTextureBlitter::OriginBottomLeft);
+	blitter_.release();
+
+	// the render thread waits for this before drawing into the frame again
+	if (frame->consumed != nullptr)
+		gl_->glDeleteSync(frame->consumed);
+	frame->consumed = gl_->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	gl_->glFlush();
+}
+
+void FergusonCanvas::renderCached()
+{
+	updateLayer();
+
+	// composite the cached layer, then draw what changes every frame
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	for (std::shared_ptr<Drawing> d : drawings_)
-		d->render();
+
+	if (!blitter_.isCreated())
+		blitter_.create();
+
+	QOpenGLFramebufferObject *source = resolvedLayer_ ? resolvedLayer_.get() : layer_.get();
+	blitter_.bind();
+	blitter_.blit(source->texture(), QMatrix4x4(), QOpenGLTextureBlitter::OriginBottomLeft);
+	blitter_.release();
+
+	for (const std::shared_ptr<Drawing> &d : drawings_)
+		d->renderOverlay();
+}
+
+void FergusonCanvas::updateLayer()
+{
+	qreal ratio = renderer_->devicePixelRatioF();
+	QSize size(int(width_ * ratio), int(height_ * ratio));
+
+	if (!layer_ || layer_->size() != size) {
+		QOpenGLFramebufferObjectFormat format;
+		format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+		format.setSamples(renderer_->format().samples());
+		layer_ = std::make_unique<QOpenGLFramebufferObject>(size, format);
+
+		// multisampled layers cannot be sampled, they are resolved into a texture
+		if (format.samples() > 0)
+			resolvedLayer_ = std::make_unique<QOpenGLFramebufferObject>(size);
+		else
+			resolvedLayer_.reset();
+
+		layerValid_ = false;
+	}
+
+	bool dirty = !layerValid_;
+	QRectF region;
+	for (const std::shared_ptr<Drawing> &d : drawings_) {
+		if (!d->isStaticDirty())
+			continue;
+
+		QRectF r = d->staticDirtyRegion();
+		if (r.isNull())
+			r = QRectF(-1.f, -1.f, 2.f, 2.f);
+		region = dirty ? region.united(r) : r;
+		dirty = true;
+	}
+
+	if (!dirty)
+		return;
+
+	if (!layerValid_)
+		region = QRectF(-1.f, -1.f, 2.f, 2.f);
+
+	// NDC to pixels, GL window coordinates also start at the bottom left
+	int x0 = std::max(0, int(std::floor((region.left() + 1.f) * 0.5f * size.width())) - 2);
+	int y0 = std::max(0, int(std::floor((region.top() + 1.f) * 0.5f * size.height())) - 2);
+	int x1 = std::min(size.width(), int(std::ceil((region.right() + 1.f) * 0.5f * size.width())) + 2);
+	int y1 = std::min(size.height(), int(std::ceil((region.bottom() + 1.f) * 0.5f * size.height())) + 2);
+	QRect pixels(x0, y0, std::max(0, x1 - x0), std::max(0, y1 - y0));
+
+	layer_->bind();
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(pixels.x(), pixels.y(), pixels.width(), pixels.height());
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	for (const std::shared_ptr<Drawing> &d : drawings_)
+		d->renderStatic();
+
+	glDisable(GL_SCISSOR_TEST);
+
+	if (resolvedLayer_)
+		QOpenGLFramebufferObject::blitFramebuffer(resolvedLayer_.get(), pixels, layer_.get(), pixels);
+
+	for (const std::shared_ptr<Drawing> &d : drawings_)
+		d->markStaticClean();
+
+	layerValid_ = true;
+	glBindFramebuffer(GL_FRAMEBUFFER, renderer_->defaultFramebufferObject());
+}
+
+void FergusonCanvas::destroyLayer()
+{
+	layer_.reset();
+	resolvedLayer_.reset();
+	if (blitter_.isCreated())
+		blitter_.destroy();
+	layerValid_ = false;
 }
 
 // Keyboard Event
 void FergusonCanvas::keyPress(QKeyEvent *e)
 {
-	for (std::shared_ptr<Drawing> d : drawings_)
+	for (const std::shared_ptr<Drawing> &d : drawings_)
 		d->keyPress(e);
 }
 
 void FergusonCanvas::keyRelease(QKeyEvent *e)
 {
-	for (std::shared_ptr<Drawing> d : drawings_)
+	for (const std::shared_ptr<Drawing> &d : drawings_)
 		d->keyRelease(e);
 }
 
 // Mouse Event
 void FergusonCanvas::mousePress(QMouseEvent *e)
 {
-	for (std::shared_ptr<Drawing> d : drawings_)
+	for (const std::shared_ptr<Drawing> &d : drawings_)
 		d->mousePress(e);
 }
 
 void FergusonCanvas::mouseMove(QMouseEvent *e)
 {
-	for (std::shared_ptr<Drawing> d : drawings_)
+	for (const std::shared_ptr<Drawing> &d : drawings_)
 		d->mouseMove(e);
 }
 
 void FergusonCanvas::mouseRelease(QMouseEvent *e)
 {
-	for (std::shared_ptr<Drawing> d : drawings_)
+	for (const std::shared_ptr<Drawing> &d : drawings_)
 		d->mouseRelease(e);
 }
 
 #include <iostream>
 void FergusonCanvas::destroy()
 {
-	for (std::shared_ptr<Drawing> d : drawings_)
+	if (renderThread_) {
+		renderThread_->stop();
+		renderThread_.reset();
+	}
+	destroyLayer();
+	commands_.clear();
+	commandsValid_ = false;
+	shader_.reset();
+	lineShader_.reset();
+	fillShader_.reset();
+	for (const std::shared_ptr<Drawing> &d : drawings_)
 		d->cleanUp();
+	// after the drawings, which hand their ranges back
+	for (const std::unique_ptr<VertexArena> &arena : arenas_)
+		arena->destroy();
+	patches_.clear();
+	patchIndex_.clear();
+	patchesValid_ = false;
+	foldovers_.clear();
 }
\ No newline at end of file
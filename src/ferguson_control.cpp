@@ -2,6 +2,7 @@
 
 #include <QVBoxLayout>
 #include <QHBoxLayout>
+#include <QTimer>
 
 FergusonControl::FergusonControl(QWidget *parent, Renderer *renderer)
 	:QWidget(parent), renderer_{renderer}
@@ -27,6 +28,152 @@ FergusonControl::FergusonControl(QWidget *parent, Renderer *renderer)
 	showHandlerLayout->addWidget(showHandlerschk_);
 	mainLayout->addLayout(showHandlerLayout);
 
+	QHBoxLayout *sketchLayout = new QHBoxLayout();
+	sketchchk_ = new QCheckBox("Sketch boundaries");
+	sketchchk_->setCheckState(Qt::Unchecked);
+	sketchchk_->setToolTip(tr("Strokes drawn on the canvas replace the boundary curve between their ends"));
+
+	QObject::connect(sketchchk_, &QCheckBox::stateChanged,
+		this, &FergusonControl::sketch_stateChanged);
+
+	sketchLayout->addWidget(sketchchk_);
+	mainLayout->addLayout(sketchLayout);
+
+	QHBoxLayout *showInteriorLayout = new QHBoxLayout();
+	showInteriorchk_ = new QCheckBox("Show interior");
+	showInteriorchk_->setCheckState(Qt::Unchecked);
+
+	QObject::connect(showInteriorchk_, &QCheckBox::stateChanged,
+		this, &FergusonControl::showInterior_stateChanged);
+
+	showInteriorLayout->addWidget(showInteriorchk_);
+	mainLayout->addLayout(showInteriorLayout);
+
+	QHBoxLayout *showFoldoverLayout = new QHBoxLayout();
+	showFoldoverchk_ = new QCheckBox("Highlight foldovers");
+	showFoldoverchk_->setCheckState(Qt::Checked);
+
+	QObject::connect(showFoldoverchk_, &QCheckBox::stateChanged,
+		this, &FergusonControl::showFoldover_stateChanged);
+
+	showFoldoverLayout->addWidget(showFoldoverchk_);
+	mainLayout->addLayout(showFoldoverLayout);
+
+	QHBoxLayout *showIsoGridLayout = new QHBoxLayout();
+	showIsoGridchk_ = new QCheckBox("Show iso-parameter grid");
+	showIsoGridchk_->setCheckState(Qt::Unchecked);
+
+	QObject::connect(showIsoGridchk_, &QCheckBox::stateChanged,
+		this, &FergusonControl::showIsoGrid_stateChanged);
+
+	showIsoGridLayout->addWidget(showIsoGridchk_);
+	mainLayout->addLayout(showIsoGridLayout);
+
+	QHBoxLayout *isoGridLayout = new QHBoxLayout();
+	isoGridlabel_ = new QLabel(tr("Grid lines: "), this);
+	isoGridLayout->addWidget(isoGridlabel_);
+	isoGridspin_ = new QSpinBox(this);
+	isoGridspin_->setRange(2, 256);
+	isoGridspin_->setValue(32);
+	isoGridspin_->setEnabled(false);
+
+	QObject::connect(
+		isoGridspin_, QOverload<int>::of(&QSpinBox::valueChanged),
+		this, &FergusonControl::isoGridspin_valueChanged);
+
+	isoGridLayout->addWidget(isoGridspin_);
+	mainLayout->addLayout(isoGridLayout);
+
+	QHBoxLayout *lineWidthLayout = new QHBoxLayout();
+	lineWidthlabel_ = new QLabel(tr("Line width: "), this);
+	lineWidthLayout->addWidget(lineWidthlabel_);
+	lineWidthspin_ = new QDoubleSpinBox(this);
+	lineWidthspin_->setRange(0.5, 8.0);
+	lineWidthspin_->setValue(1.5);
+	lineWidthspin_->setSingleStep(0.25);
+
+	QObject::connect(
+		lineWidthspin_, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+		this, &FergusonControl::lineWidthspin_valueChanged);
+
+	lineWidthLayout->addWidget(lineWidthspin_);
+	mainLayout->addLayout(lineWidthLayout);
+
+	QHBoxLayout *quantisedLayout = new QHBoxLayout();
+	quantisedchk_ = new QCheckBox("Quantised vertices");
+	quantisedchk_->setCheckState(Qt::Unchecked);
+
+	QObject::connect(quantisedchk_, &QCheckBox::stateChanged,
+		this, &FergusonControl::quantised_stateChanged);
+
+	quantisedLayout->addWidget(quantisedchk_);
+	mainLayout->addLayout(quantisedLayout);
+
+	QHBoxLayout *layerCachingLayout = new QHBoxLayout();
+	layerCachingchk_ = new QCheckBox("Cache static layers");
+	layerCachingchk_->setCheckState(Qt::Unchecked);
+
+	QObject::connect(layerCachingchk_, &QCheckBox::stateChanged,
+		this, &FergusonControl::layerCaching_stateChanged);
+
+	layerCachingLayout->addWidget(layerCachingchk_);
+	mainLayout->addLayout(layerCachingLayout);
+
+	QHBoxLayout *threadedLayout = new QHBoxLayout();
+	threadedchk_ = new QCheckBox("Render on a separate thread");
+	threadedchk_->setCheckState(Qt::Unchecked);
+
+	QObject::connect(threadedchk_, &QCheckBox::stateChanged,
+		this, &FergusonControl::threaded_stateChanged);
+
+	threadedLayout->addWidget(threadedchk_);
+	mainLayout->addLayout(threadedLayout);
+
+	QHBoxLayout *continuityLayout = new QHBoxLayout();
+	continuitylabel_ = new QLabel(tr("Continuity: "), this);
+	continuityLayout->addWidget(continuitylabel_);
+	continuitycombo_ = new QComboBox(this);
+	// in the order of ContinuityConstraints::Continuity
+	continuitycombo_->addItems({ tr("None"), tr("G1 (collinear)"), tr("C1 (equal)") });
+
+	QObject::connect(
+		continuitycombo_, QOverload<int>::of(&QComboBox::currentIndexChanged),
+		this, &FergusonControl::continuity_currentIndexChanged);
+
+	continuityLayout->addWidget(continuitycombo_);
+	mainLayout->addLayout(continuityLayout);
+
+	QHBoxLayout *trafficLayout = new QHBoxLayout();
+	trafficlabel_ = new QLabel(this);
+	trafficLayout->addWidget(trafficlabel_);
+	mainLayout->addLayout(trafficLayout);
+
+	QHBoxLayout *measuresLayout = new QHBoxLayout();
+	measureslabel_ = new QLabel(this);
+	measuresLayout->addWidget(measureslabel_);
+	mainLayout->addLayout(measuresLayout);
+
+	QHBoxLayout *cacheLayout = new QHBoxLayout();
+	cachelabel_ = new QLabel(this);
+	cacheLayout->addWidget(cachelabel_);
+	mainLayout->addLayout(cacheLayout);
+
+	QHBoxLayout *constraintsLayout = new QHBoxLayout();
+	constraintslabel_ = new QLabel(this);
+	constraintsLayout->addWidget(constraintslabel_);
+	mainLayout->addLayout(constraintsLayout);
+
+	QTimer *trafficTimer = new QTimer(this);
+	QObject::connect(trafficTimer, &QTimer::timeout, 
+		this, &FergusonControl::updateTrafficLabel);
+	QObject::connect(trafficTimer, &QTimer::timeout, 
+		this, &FergusonControl::updateMeasuresLabel);
+	QObject::connect(trafficTimer, &QTimer::timeout, 
+		this, &FergusonControl::updateCacheLabel);
+	QObject::connect(trafficTimer, &QTimer::timeout, 
+		this, &FergusonControl::updateConstraintsLabel);
+	trafficTimer->start(500);
+
 	setLayout(mainLayout);
 }
 
@@ -42,4 +189,120 @@ void FergusonControl::showHandlers_stateChanged(int state)
 			renderer_->showHandlers();
 		break;
 	}
+}
+
+void FergusonControl::sketch_stateChanged(int state)
+{
+	renderer_->setSketching(state == Qt::Checked);
+}
+
+void FergusonControl::showInterior_stateChanged(int state)
+{
+	switch(state)
+	{
+		case Qt::Unchecked:
+			renderer_->hideInterior();
+		break;
+
+		case Qt::Checked:
+			renderer_->showInterior();
+		break;
+	}
+}
+
+void FergusonControl::showFoldover_stateChanged(int state)
+{
+	switch(state)
+	{
+		case Qt::Unchecked:
+			renderer_->hideFoldover();
+		break;
+
+		case Qt::Checked:
+			renderer_->showFoldover();
+		break;
+	}
+}
+
+void FergusonControl::showIsoGrid_stateChanged(int state)
+{
+	switch(state)
+	{
+		case Qt::Unchecked:
+			isoGridspin_->setEnabled(false);
+			renderer_->hideIsoGrid();
+		break;
+
+		case Qt::Checked:
+			isoGridspin_->setEnabled(true);
+			renderer_->showIsoGrid();
+		break;
+	}
+}
+
+void FergusonControl::isoGridspin_valueChanged(int lines)
+{
+	renderer_->setIsoGridLines(unsigned(lines));
+}
+
+void FergusonControl::lineWidthspin_valueChanged(double width)
+{
+	renderer_->setLineWidth(float(width));
+}
+
+void FergusonControl::quantised_stateChanged(int state)
+{
+	renderer_->setQuantised(state == Qt::Checked);
+}
+
+void FergusonControl::layerCaching_stateChanged(int state)
+{
+	renderer_->setLayerCaching(state == Qt::Checked);
+}
+
+void FergusonControl::threaded_stateChanged(int state)
+{
+	renderer_->setThreadedRendering(state == Qt::Checked);
+}
+
+void FergusonControl::continuity_currentIndexChanged(int index)
+{
+	renderer_->setContinuity(ContinuityConstraints::Continuity(index));
+}
+
+void FergusonControl::updateTrafficLabel()
+{
+	VertexTraffic traffic = renderer_->vertexTraffic();
+	trafficlabel_->setText(tr("Vertex bytes/frame: %1 (saved %2)")
+		.arg(traffic.uploaded + traffic.fetched)
+		.arg(traffic.saved));
+}
+
+void FergusonControl::updateMeasuresLabel()
+{
+	double area = 0.0, perimeter = 0.0;
+	for (const PatchMeasures &m : renderer_->measures()) {
+		area += m.area;
+		perimeter += m.perimeter;
+	}
+	measureslabel_->setText(tr("Area: %1  Perimeter: %2")
+		.arg(area, 0, 'f', 4)
+		.arg(perimeter, 0, 'f', 4));
+}
+
+void FergusonControl::updateCacheLabel()
+{
+	TessellationCache::Stats stats = TessellationCache::stats();
+	cachelabel_->setText(tr("Tessellation cache: %1 hits, %2 misses, %3 KiB")
+		.arg(stats.hits)
+		.arg(stats.misses)
+		.arg(stats.bytes / 1024));
+}
+
+void FergusonControl::updateConstraintsLabel()
+{
+	const ContinuityConstraints &constraints = renderer_->constraints();
+	constraintslabel_->setText(tr("Constraints: %1, last edit moved %2 handles")
+		.arg(constraints.constraintCount())
+		.arg(constraints.lastTouched()));
 }
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include <batch_evaluator.hpp>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+#include <cstdio>
+
+// Evaluates patches at (u,v) samples from a file or stdin and writes the
+// points to stdout, without a window or a GL context
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Evaluates Ferguson patches at streams of (u,v) samples.\n\n"
+		"Patches are 24 numbers each: p0 p1 p2 p3 t01 t10 t13 t31 t23 t32 t02 t20, x before y.\n"
+		"Text samples are lines of \"u v\" or \"patch u v\"; binary samples are a 32 bit patch\n"
+		"index and two 32 bit floats. Points are written one per line, or as 32 bit floats.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("patches", "File with the patches.");
+	parser.addPositionalArgument("samples", "File with the samples, stdin when left out or -.", "[samples]");
+
+	QCommandLineOption derivativesOption({"d", "derivatives"}, "Also write su and sv after each point.");
+	QCommandLineOption binaryInOption("binary-in", "Read binary samples.");
+	QCommandLineOption binaryOutOption("binary-out", "Write binary points.");
+	QCommandLineOption chunkOption("chunk", "Bytes of input evaluated at a time (default 8388608).", "bytes", "8388608");
+	QCommandLineOption statsOption("stats", "Report the evaluation rate on stderr.");
+	parser.addOption(derivativesOption);
+	parser.addOption(binaryInOption);
+	parser.addOption(binaryOutOption);
+	parser.addOption(chunkOption);
+	parser.addOption(statsOption);
+	parser.process(app);
+
+	QStringList arguments = parser.positionalArguments();
+	if (arguments.isEmpty() || arguments.size() > 2)
+		parser.showHelp(1);
+
+	QFile patchFile(arguments[0]);
+	std::vector<FergusonGeometry> patches;
+	if (!patchFile.open(QIODevice::ReadOnly) || !BatchEvaluator::readPatches(patchFile, patches)) {
+		QTextStream(stderr) << "cannot read patches from " << arguments[0] << Qt::endl;
+		return 1;
+	}
+
+	QFile in;
+	bool fromStdin = arguments.size() < 2 || arguments[1] == "-";
+	if (!fromStdin)
+		in.setFileName(arguments[1]);
+	if (!(fromStdin ? in.open(stdin, QIODevice::ReadOnly) : in.open(QIODevice::ReadOnly))) {
+		QTextStream(stderr) << "cannot open " << arguments[1] << Qt::endl;
+		return 1;
+	}
+
+	QFile out;
+	out.open(stdout, QIODevice::WriteOnly);
+
+	BatchEvaluator evaluator(std::move(patches));
+	evaluator.derivatives(parser.isSet(derivativesOption));
+	evaluator.inputFormat(parser.isSet(binaryInOption) ? BatchEvaluator::Format::Binary : BatchEvaluator::Format::Text);
+	evaluator.outputFormat(parser.isSet(binaryOutOption) ? BatchEvaluator::Format::Binary : BatchEvaluator::Format::Text);
+	evaluator.chunkSize(std::size_t(std::max(1ll, parser.value(chunkOption).toLongLong())));
+
+	QElapsedTimer timer;
+	timer.start();
+	bool ok = evaluator.run(in, out);
+	out.flush();
+	qint64 elapsed = std::max<qint64>(1, timer.elapsed());
+
+	if (!ok) {
+		QTextStream(stderr) << "malformed sample or write error after " << evaluator.evaluated() << " samples" << Qt::endl;
+		return 1;
+	}
+
+	if (parser.isSet(statsOption))
+		QTextStream(stderr) << evaluator.evaluated() << " samples in " << elapsed << " ms, "
+			<< qint64(double(evaluator.evaluated()) * 60000.0 / double(elapsed)) << " per minute" << Qt::endl;
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,441 @@
+#include <ferguson_geometry.hpp>
+#include <parallel_for.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// power basis coefficients of the Hermite basis functions, ordered as
+	// start point, start tangent, end tangent, end point
+	const float HermitePower[4][4] = {
+		{ 1.f, 0.f, -3.f,  2.f },
+		{ 0.f, 1.f, -2.f,  1.f },
+		{ 0.f, 0.f, -1.f,  1.f },
+		{ 0.f, 0.f,  3.f, -2.f }
+	};
+
+	void hermite(float t, float b[4])
+	{
+		float t2 = t*t;
+		float t3 = t2*t;
+		b[0] = 2.f*t3 - 3.f*t2 + 1.f;
+		b[1] = t3 - 2.f*t2 + t;
+		b[2] = t3 - t2;
+		b[3] = -2.f*t3 + 3.f*t2;
+	}
+
+	void hermiteDerivative(float t, float d[4])
+	{
+		float t2 = t*t;
+		d[0] = 6.f*t2 - 6.f*t;
+		d[1] = 3.f*t2 - 4.f*t + 1.f;
+		d[2] = 3.f*t2 - 2.f*t;
+		d[3] = -6.f*t2 + 6.f*t;
+	}
+
+	CubicCurve toPowerBasis(const QPointF q[4])
+	{
+		CubicCurve curve;
+		for (unsigned int k = 0; k < 4; ++k) {
+			QPointF a(0.f, 0.f);
+			for (unsigned int i = 0; i < 4; ++i)
+				a += HermitePower[i][k] * q[i];
+			curve.coefficient(k, a);
+		}
+		return curve;
+	}
+
+	// power basis coefficients of one coordinate of a curve
+	std::array<double, 4> component(const CubicCurve &curve, unsigned int k)
+	{
+		std::array<double, 4> c;
+		for (unsigned int i = 0; i < 4; ++i)
+			c[i] = k == 0 ? curve.coefficient(i).x() : curve.coefficient(i).y();
+		return c;
+	}
+
+	// integral over [0,1] of p(t) q'(t), both in power basis
+	template <std::size_t N, std::size_t M>
+	double integrateWithDerivative(const std::array<double, N> &p, const std::array<double, M> &q)
+	{
+		double sum = 0.0;
+		for (std::size_t i = 0; i < N; ++i)
+			for (std::size_t j = 1; j < M; ++j)
+				sum += p[i] * double(j) * q[j] / double(i + j);
+		return sum;
+	}
+
+	std::array<double, 7> square(const std::array<double, 4> &p)
+	{
+		std::array<double, 7> r = {};
+		for (std::size_t i = 0; i < 4; ++i)
+			for (std::size_t j = 0; j < 4; ++j)
+				r[i+j] += p[i] * p[j];
+		return r;
+	}
+
+	// 5 point Gauss-Legendre rule on [0,1]
+	const double GaussNodes[5] = {
+		0.5 - 0.5 * 0.9061798459386640, 0.5 - 0.5 * 0.5384693101056831, 0.5,
+		0.5 + 0.5 * 0.5384693101056831, 0.5 + 0.5 * 0.9061798459386640 };
+	const double GaussWeights[5] = {
+		0.5 * 0.2369268850561891, 0.5 * 0.4786286704993665, 0.5 * 0.5688888888888889,
+		0.5 * 0.4786286704993665, 0.5 * 0.2369268850561891 };
+
+	double speedIntegral(const CubicCurve &curve, double a, double b)
+	{
+		double sum = 0.0;
+		for (unsigned int i = 0; i < 5; ++i) {
+			QPointF d = curve.derivative(float(a + (b - a) * GaussNodes[i]));
+			sum += GaussWeights[i] * std::sqrt(d.x()*d.x() + d.y()*d.y());
+		}
+		return sum * (b - a);
+	}
+
+	double adaptiveLength(const CubicCurve &curve, double a, double b, double whole, double tolerance, unsigned int depth)
+	{
+		double m = 0.5 * (a + b);
+		double left = speedIntegral(curve, a, m), right = speedIntegral(curve, m, b);
+		if (depth == 0 || std::abs(left + right - whole) <= tolerance)
+			return left + right;
+		return adaptiveLength(curve, a, m, left, 0.5 * tolerance, depth - 1) +
+		       adaptiveLength(curve, m, b, right, 0.5 * tolerance, depth - 1);
+	}
+
+	// Hermite basis and its first and second derivatives
+	void hermiteAll(double t, double b[3][4])
+	{
+		double t2 = t*t, t3 = t2*t;
+		b[0][0] = 2.0*t3 - 3.0*t2 + 1.0; b[0][1] = t3 - 2.0*t2 + t;
+		b[0][2] = t3 - t2;               b[0][3] = -2.0*t3 + 3.0*t2;
+		b[1][0] = 6.0*t2 - 6.0*t;        b[1][1] = 3.0*t2 - 4.0*t + 1.0;
+		b[1][2] = 3.0*t2 - 2.0*t;        b[1][3] = -6.0*t2 + 6.0*t;
+		b[2][0] = 12.0*t - 6.0;          b[2][1] = 6.0*t - 4.0;
+		b[2][2] = 6.0*t - 2.0;           b[2][3] = -12.0*t + 6.0;
+	}
+}
+
+// ------------------------------- CUBIC CURVE ---------------------------------------------------------
+CubicCurve::CubicCurve(QPointF a0, QPointF a1, QPointF a2, QPointF a3)
+	:a_{a0, a1, a2, a3}
+{}
+
+CubicCurve CubicCurve::fromHermite(QPointF p0, QPointF t0, QPointF p1, QPointF t1)
+{
+	const QPointF q[4] = { p0, t0, t1, p1 };
+	return toPowerBasis(q);
+}
+
+void CubicCurve::tessellate(unsigned int n, float *out, bool last) const
+{
+	// forward differences: three additions per sample
+	double h  = 1.0 / double(last ? n-1 : n);
+	double h2 = h*h;
+	double h3 = h2*h;
+
+	double p[2], d1[2], d2[2], d3[2];
+	for (unsigned int k = 0; k < 2; ++k) {
+		double a0 = k == 0 ? a_[0].x() : a_[0].y();
+		double a1 = k == 0 ? a_[1].x() : a_[1].y();
+		double a2 = k == 0 ? a_[2].x() : a_[2].y();
+		double a3 = k == 0 ? a_[3].x() : a_[3].y();
+
+		p[k]  = a0;
+		d1[k] = a1*h + a2*h2 + a3*h3;
+		d2[k] = 2.0*a2*h2 + 6.0*a3*h3;
+		d3[k] = 6.0*a3*h3;
+	}
+
+	for (unsigned int i = 0; i < n; ++i) {
+		for (unsigned int k = 0; k < 2; ++k) {
+			out[2*i+k] = float(p[k]);
+			p[k]  += d1[k];
+			d1[k] += d2[k];
+			d2[k] += d3[k];
+		}
+	}
+}
+
+QRectF CubicCurve::bounds() const
+{
+	double lo[2], hi[2];
+	for (unsigned int k = 0; k < 2; ++k) {
+		std::array<double, 4> c = component(*this, k);
+		auto value = [&c](double t) { return c[0] + t*(c[1] + t*(c[2] + t*c[3])); };
+
+		lo[k] = std::min(value(0.0), value(1.0));
+		hi[k] = std::max(value(0.0), value(1.0));
+
+		// extremes inside at the roots of c1 + 2 c2 t + 3 c3 t^2
+		double a = 3.0*c[3], b = 2.0*c[2];
+		double roots[2];
+		unsigned int count = 0;
+		if (std::abs(a) < 1e-12) {
+			if (std::abs(b) > 1e-12)
+				roots[count++] = -c[1] / b;
+		} else {
+			double discriminant = b*b - 4.0*a*c[1];
+			if (discriminant >= 0.0) {
+				// avoids cancellation between b and the root
+				double q = -0.5 * (b + std::copysign(std::sqrt(discriminant), b));
+				roots[count++] = q / a;
+				if (q != 0.0)
+					roots[count++] = c[1] / q;
+			}
+		}
+
+		for (unsigned int i = 0; i < count; ++i)
+			if (roots[i] > 0.0 && roots[i] < 1.0) {
+				lo[k] = std::min(lo[k], value(roots[i]));
+				hi[k] = std::max(hi[k], value(roots[i]));
+			}
+	}
+
+	return QRectF(lo[0], lo[1], hi[0] - lo[0], hi[1] - lo[1]);
+}
+
+double CubicCurve::length(double tolerance) const
+{
+	// the speed of a cubic is smooth, a few levels are plenty
+	return adaptiveLength(*this, 0.0, 1.0, speedIntegral(*this, 0.0, 1.0), tolerance, 16);
+}
+
+double CubicCurve::areaIntegral() const
+{
+	std::array<double, 4> x = component(*this, 0), y = component(*this, 1);
+	return 0.5 * (integrateWithDerivative(x, y) - integrateWithDerivative(y, x));
+}
+
+QPointF CubicCurve::momentIntegrals() const
+{
+	std::array<double, 4> x = component(*this, 0), y = component(*this, 1);
+	return QPointF(integrateWithDerivative(square(x), y), integrateWithDerivative(square(y), x));
+}
+
+std::vector<QRectF> CubicCurve::bounds(const std::vector<CubicCurve> &curves)
+{
+	std::vector<QRectF> result(curves.size());
+	parallelFor(curves.size(), [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; ++i)
+			result[i] = curves[i].bounds();
+	}, 4096);
+	return result;
+}
+
+std::vector<double> CubicCurve::lengths(const std::vector<CubicCurve> &curves, double tolerance)
+{
+	std::vector<double> result(curves.size());
+	parallelFor(curves.size(), [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; ++i)
+			result[i] = curves[i].length(tolerance);
+	}, 1024);
+	return result;
+}
+
+// ------------------------------- FERGUSON GEOMETRY ---------------------------------------------------
+FergusonGeometry::FergusonGeometry(
+	QPointF p0, QPointF p1, QPointF p2, QPointF p3,
+	QPointF t01, QPointF t10, QPointF t13, QPointF t31,
+	QPointF t23, QPointF t32, QPointF t02, QPointF t20)
+{
+	QPointF zero(0.f, 0.f);
+	g_[0] = { p0,  t02,  t20,  p2  };
+	g_[1] = { t01, zero, zero, t23 };
+	g_[2] = { t10, zero, zero, t32 };
+	g_[3] = { p1,  t13,  t31,  p3  };
+}
+
+QPointF FergusonGeometry::s(float u, float v) const
+{
+	float bu[4], bv[4];
+	hermite(u, bu);
+	hermite(v, bv);
+
+	QPointF p(0.f, 0.f);
+	for (unsigned int i = 0; i < 4; ++i)
+		p += bv[i] * (bu[0]*g_[i][0] + bu[1]*g_[i][1] + bu[2]*g_[i][2] + bu[3]*g_[i][3]);
+	return p;
+}
+
+QPointF FergusonGeometry::su(float u, float v) const
+{
+	float du[4], bv[4];
+	hermiteDerivative(u, du);
+	hermite(v, bv);
+
+	QPointF p(0.f, 0.f);
+	for (unsigned int i = 0; i < 4; ++i)
+		p += bv[i] * (du[0]*g_[i][0] + du[1]*g_[i][1] + du[2]*g_[i][2] + du[3]*g_[i][3]);
+	return p;
+}
+
+QPointF FergusonGeometry::sv(float u, float v) const
+{
+	float bu[4], dv[4];
+	hermite(u, bu);
+	hermiteDerivative(v, dv);
+
+	QPointF p(0.f, 0.f);
+	for (unsigned int i = 0; i < 4; ++i)
+		p += dv[i] * (bu[0]*g_[i][0] + bu[1]*g_[i][1] + bu[2]*g_[i][2] + bu[3]*g_[i][3]);
+	return p;
+}
+
+CubicCurve FergusonGeometry::isoU(float u) const
+{
+	float bu[4];
+	hermite(u, bu);
+
+	QPointF q[4];
+	for (unsigned int i = 0; i < 4; ++i)
+		q[i] = bu[0]*g_[i][0] + bu[1]*g_[i][1] + bu[2]*g_[i][2] + bu[3]*g_[i][3];
+	return toPowerBasis(q);
+}
+
+CubicCurve FergusonGeometry::isoV(float v) const
+{
+	float bv[4];
+	hermite(v, bv);
+
+	QPointF q[4];
+	for (unsigned int j = 0; j < 4; ++j)
+		q[j] = bv[0]*g_[0][j] + bv[1]*g_[1][j] + bv[2]*g_[2][j] + bv[3]*g_[3][j];
+	return toPowerBasis(q);
+}
+
+FergusonGeometry::BezierNet FergusonGeometry::bezier() const
+{
+	// Hermite (p0, t0, t1, p1) to Bezier (p0, p0 + t0/3, p1 - t1/3, p1),
+	// applied along u and then along v
+	BezierNet half;
+	for (unsigned int i = 0; i < 4; ++i) {
+		half[i][0] = g_[i][0];
+		half[i][1] = g_[i][0] + g_[i][1] / 3.f;
+		half[i][2] = g_[i][3] - g_[i][2] / 3.f;
+		half[i][3] = g_[i][3];
+	}
+
+	BezierNet net;
+	for (unsigned int j = 0; j < 4; ++j) {
+		net[0][j] = half[0][j];
+		net[1][j] = half[0][j] + half[1][j] / 3.f;
+		net[2][j] = half[3][j] - half[2][j] / 3.f;
+		net[3][j] = half[3][j];
+	}
+	return net;
+}
+
+std::array<CubicCurve, 4> FergusonGeometry::boundary() const
+{
+	return { isoV(0.f), isoU(1.f), isoV(1.f), isoU(0.f) };
+}
+
+double FergusonGeometry::area() const
+{
+	// the last two curves run against the loop
+	std::array<CubicCurve, 4> b = boundary();
+	return b[0].areaIntegral() + b[1].areaIntegral() - b[2].areaIntegral() - b[3].areaIntegral();
+}
+
+QPointF FergusonGeometry::centroid() const
+{
+	// integral x det(J) = (1/2) loop x^2 dy, integral y det(J) = -(1/2) loop y^2 dx
+	std::array<CubicCurve, 4> b = boundary();
+	QPointF moments = b[0].momentIntegrals() + b[1].momentIntegrals() - b[2].momentIntegrals() - b[3].momentIntegrals();
+	double a = area();
+	if (std::abs(a) < 1e-300)
+		return s(0.5f, 0.5f);
+	return QPointF(0.5 * moments.x() / a, -0.5 * moments.y() / a);
+}
+
+QRectF FergusonGeometry::bounds() const
+{
+	double lo[2], hi[2];
+	bool first = true;
+	for (const CubicCurve &curve : boundary()) {
+		QRectF box = curve.bounds();
+		double l[2] = { box.left(), box.top() }, h[2] = { box.left() + box.width(), box.top() + box.height() };
+		for (unsigned int k = 0; k < 2; ++k) {
+			lo[k] = first ? l[k] : std::min(lo[k], l[k]);
+			hi[k] = first ? h[k] : std::max(hi[k], h[k]);
+		}
+		first = false;
+	}
+
+	// x or y can only peak inside where both its derivatives vanish, so
+	// where the Jacobian is singular; Newton from a few starts finds them
+	for (unsigned int k = 0; k < 2; ++k) {
+		for (double u0 : { 0.25, 0.5, 0.75 })
+			for (double v0 : { 0.25, 0.5, 0.75 }) {
+				double u = u0, v = v0;
+				bool converged = false;
+				// derivatives of the coordinate: d[order in u][order in v]
+				double d[3][3];
+
+				for (unsigned int iteration = 0; iteration < 20 && !converged; ++iteration) {
+					double bu[3][4], bv[3][4];
+					hermiteAll(u, bu);
+					hermiteAll(v, bv);
+
+					std::fill(&d[0][0], &d[0][0] + 9, 0.0);
+					for (unsigned int i = 0; i < 4; ++i)
+						for (unsigned int j = 0; j < 4; ++j) {
+							double g = k == 0 ? g_[i][j].x() : g_[i][j].y();
+							for (unsigned int a = 0; a < 3; ++a)
+								for (unsigned int c = 0; a + c < 3; ++c)
+									d[a][c] += bu[a][j] * bv[c][i] * g;
+						}
+
+					double det = d[2][0] * d[0][2] - d[1][1] * d[1][1];
+					if (std::abs(det) < 1e-18)
+						break;
+
+					double du = (d[0][2] * d[1][0] - d[1][1] * d[0][1]) / det;
+					double dv = (d[2][0] * d[0][1] - d[1][1] * d[1][0]) / det;
+					u -= du;
+					v -= dv;
+					if (u < 0.0 || u > 1.0 || v < 0.0 || v > 1.0)
+						break;
+					converged = std::abs(du) + std::abs(dv) < 1e-12;
+				}
+
+				if (converged) {
+					QPointF p = s(float(u), float(v));
+					double c = k == 0 ? p.x() : p.y();
+					lo[k] = std::min(lo[k], c);
+					hi[k] = std::max(hi[k], c);
+				}
+			}
+	}
+
+	return QRectF(lo[0], lo[1], hi[0] - lo[0], hi[1] - lo[1]);
+}
+
+double FergusonGeometry::perimeter(double tolerance) const
+{
+	double sum = 0.0;
+	for (const CubicCurve &curve : boundary())
+		sum += curve.length(0.25 * tolerance);
+	return sum;
+}
+
+PatchMeasures FergusonGeometry::measures() const
+{
+	PatchMeasures m;
+	m.area = area();
+	m.centroid = centroid();
+	m.bounds = bounds();
+	m.perimeter = perimeter();
+	return m;
+}
+
+std::vector<PatchMeasures> FergusonGeometry::measures(const std::vector<FergusonGeometry> &patches)
+{
+	std::vector<PatchMeasures> result(patches.size());
+	parallelFor(patches.size(), [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; ++i)
+			result[i] = patches[i].measures();
+	}, 256);
+	return result;
+}
\ No newline at end of file
@@ -1,10 +1,51 @@
 #include <ferguson_patch.hpp>
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <QDebug>
 #include <QMouseEvent>
+#include <QOpenGLContext>
 
 
 #include <iostream>
 
+namespace
+{
+	// tells apart the blocks FergusonPatch keeps in the TessellationCache
+	enum TessellationKind { CurveBlock, InteriorBlock, IsoGridBlock };
+
+	void addGeometry(TessellationCache::Key &key, const FergusonGeometry &g)
+	{
+		for (unsigned int i = 0; i < 4; ++i)
+			for (unsigned int j = 0; j < 4; ++j)
+				key.add(g.g(i, j));
+	}
+
+	bool sameControls(const HermiteCurveComputer &a, const HermiteCurveComputer &b)
+	{
+		return a.p0() == b.p0() && a.t0() == b.t0() && a.p1() == b.p1() && a.t1() == b.t1();
+	}
+
+	// moves range to arena when the vertex layout changed, then sizes it
+	void place(VertexArena *&current, VertexArena::Range &range, VertexArena &arena, GLsizei count)
+	{
+		if (current != &arena) {
+			if (current != nullptr)
+				current->free(range);
+			current = &arena;
+		}
+		arena.resize(range, count);
+	}
+
+	FergusonGeometry poseGeometry(const PatchPose &pose)
+	{
+		return FergusonGeometry(
+			pose[PatchPose::P0], pose[PatchPose::P1], pose[PatchPose::P2], pose[PatchPose::P3],
+			pose[PatchPose::T01], pose[PatchPose::T10], pose[PatchPose::T13], pose[PatchPose::T31],
+			pose[PatchPose::T23], pose[PatchPose::T32], pose[PatchPose::T02], pose[PatchPose::T20]);
+	}
+}
+
 // ------------------------ Circle ------------------------------------------------
 Circle::Circle(QPointF centre, float radius, unsigned int resolution)
 	:centre_{centre}, radius_{radius}, resolution_{resolution}, selected_{false}
@@ -47,7 +88,17 @@ HermiteCurveComputer::HermiteCurveComputer(QPointF p0, QPointF t0, QPointF p1, Q
 	 cp0_{p0_, 0.02, 10}, ct0_{p0_+t0_, 0.02, 10}, cp1_{p1_, 0.02, 10}, ct1_{p1_+t1_, 0.02, 10}
 { }
 
-std::vector<float> HermiteCurveComputer::computePoints() const
+TessellationCache::Block HermiteCurveComputer::computePoints() const
+{
+	TessellationCache::Key key(CurveBlock);
+	key.add(p0_).add(t0_).add(p1_).add(t1_).add(resolution_);
+	for (const Circle *circle : { &cp0_, &ct0_, &cp1_, &ct1_ })
+		key.add(circle->centre()).add(circle->radius()).add(circle->resolution());
+
+	return TessellationCache::get(key, [this]() { return tessellate(); });
+}
+
+std::vector<float> HermiteCurveComputer::tessellate() const
 {
 	std::vector<float> vertices(resolution_*2);
 	float stepSize = 1.f / float(resolution_-1);
@@ -150,11 +201,29 @@ void HermiteCurveComputer::mouseRelease(QPointF pos)
 	ct1_.unselect();
 }
 
+void HermiteCurveComputer::setControls(QPointF p0, QPointF t0, QPointF p1, QPointF t1)
+{
+	p0_ = p0;
+	t0_ = t0;
+	p1_ = p1;
+	t1_ = t1;
+	cp0_.centre(p0_);
+	ct0_.centre(p0_ + t0_);
+	cp1_.centre(p1_);
+	ct1_.centre(p1_ + t1_);
+}
+
 bool HermiteCurveComputer::hasControlPointSelected() const
 {
 	return cp0_.isSelected() || ct0_.isSelected() || cp1_.isSelected() || ct1_.isSelected();
 }
 
+unsigned int HermiteCurveComputer::selectedControls() const
+{
+	return (cp0_.isSelected() ? 1u : 0u) | (ct0_.isSelected() ? 2u : 0u) |
+	       (cp1_.isSelected() ? 4u : 0u) | (ct1_.isSelected() ? 8u : 0u);
+}
+
 
 // ------------------------------- FERGUSON PATCH ------------------------------------------------------
 FergusonPatch::FergusonPatch(
@@ -162,145 +231,373 @@ FergusonPatch::FergusonPatch(
 	HermiteCurveComputer h2, HermiteCurveComputer h3,
 	unsigned int resolution, std::shared_ptr<FergusonCanvas> canvas)
 	:h0_{h0}, h1_{h1}, h2_{h2}, h3_{h3}, resolution_{resolution}, canvas_{canvas},
-	 shouldShowInterpolateLines_{false}, lastu_{0.5f}, lastv_{0.5f}, shouldShowHandlers_{true}
+	 shouldShowInterpolateLines_{false}, lastu_{0.5f}, lastv_{0.5f}, shouldShowHandlers_{true},
+	 interiorResolution_{32}, shouldShowInterior_{false},
+	 colours_{QVector3D(0.90f, 0.30f, 0.25f), QVector3D(0.95f, 0.80f, 0.30f),
+	          QVector3D(0.25f, 0.45f, 0.90f), QVector3D(0.35f, 0.80f, 0.50f)},
+	 gl_{nullptr}, interiorArena_{nullptr},
+	 shouldShowFoldover_{true},
+	 isoGridULines_{32}, isoGridVLines_{32}, isoGridResolution_{64}, isoGridArena_{nullptr}, shouldShowIsoGrid_{false},
+	 interiorBytes_{0}, interiorFloatBytes_{0}, isoGridBytes_{0}, isoGridFloatBytes_{0}, 
+	 quantised_{false}, staticDirty_{true}, commandsDirty_{true}
 {}
 
+std::shared_ptr<FergusonPatch> FergusonPatch::create(
+	const PatchPose &pose, unsigned int resolution, std::shared_ptr<FergusonCanvas> canvas)
+{
+	// every curve takes its points, tangent handles and circles in the shared buffer
+	const unsigned int stride = resolution + 4 + 44;
+	HermiteCurveComputer
+		h0{pose[PatchPose::P0], pose[PatchPose::T01], pose[PatchPose::P1], pose[PatchPose::T10], resolution, 0*stride},
+		h1{pose[PatchPose::P1], pose[PatchPose::T13], pose[PatchPose::P3], pose[PatchPose::T31], resolution, 1*stride},
+		h2{pose[PatchPose::P2], pose[PatchPose::T23], pose[PatchPose::P3], pose[PatchPose::T32], resolution, 2*stride},
+		h3{pose[PatchPose::P0], pose[PatchPose::T02], pose[PatchPose::P2], pose[PatchPose::T20], resolution, 3*stride};
+
+	return std::make_shared<FergusonPatch>(h0, h1, h2, h3, resolution, canvas);
+}
+
+FergusonGeometry FergusonPatch::geometry() const
+{
+	return FergusonGeometry(
+		h0_.p0(), h0_.p1(), h2_.p0(), h2_.p1(),
+		h0_.t0(), h0_.t1(), h1_.t0(), h1_.t1(),
+		h2_.t0(), h2_.t1(), h3_.t0(), h3_.t1());
+}
+
+PatchPose FergusonPatch::pose() const
+{
+	PatchPose pose;
+	pose[PatchPose::P0]  = h0_.p0(); pose[PatchPose::P1]  = h0_.p1();
+	pose[PatchPose::P2]  = h2_.p0(); pose[PatchPose::P3]  = h2_.p1();
+	pose[PatchPose::T01] = h0_.t0(); pose[PatchPose::T10] = h0_.t1();
+	pose[PatchPose::T13] = h1_.t0(); pose[PatchPose::T31] = h1_.t1();
+	pose[PatchPose::T23] = h2_.t0(); pose[PatchPose::T32] = h2_.t1();
+	pose[PatchPose::T02] = h3_.t0(); pose[PatchPose::T20] = h3_.t1();
+	pose[PatchPose::InnerPoint] = QPointF(lastu_, lastv_);
+	return pose;
+}
+
+FergusonPatch::Curves FergusonPatch::curves(const PatchPose &pose) const
+{
+	Curves curves = { h0_, h1_, h2_, h3_ };
+	curves[0].setControls(pose[PatchPose::P0], pose[PatchPose::T01], pose[PatchPose::P1], pose[PatchPose::T10]);
+	curves[1].setControls(pose[PatchPose::P1], pose[PatchPose::T13], pose[PatchPose::P3], pose[PatchPose::T31]);
+	curves[2].setControls(pose[PatchPose::P2], pose[PatchPose::T23], pose[PatchPose::P3], pose[PatchPose::T32]);
+	curves[3].setControls(pose[PatchPose::P0], pose[PatchPose::T02], pose[PatchPose::P2], pose[PatchPose::T20]);
+	return curves;
+}
+
+void FergusonPatch::setPose(const PatchPose &pose)
+{
+	QRectF before = bounds();
+
+	// only the curves that moved are written, each into its own range of
+	// the buffer, and nothing else is when none did
+	Curves posed = curves(pose);
+	HermiteCurveComputer *live[4] = { &h0_, &h1_, &h2_, &h3_ };
+	bool moved = false;
+	for (unsigned int i = 0; i < 4; ++i) {
+		if (sameControls(*live[i], posed[i]))
+			continue;
+		*live[i] = posed[i];
+		updateGPUBuffers(*live[i]);
+		moved = true;
+	}
+
+	QPointF uv = pose[PatchPose::InnerPoint];
+	interpolateInnerPoint(qBound(0.f, float(uv.x()), 1.f), qBound(0.f, float(uv.y()), 1.f));
+
+	if (!moved)
+		return;
+	updateGPUBuffersInterior();
+	canvas_->touchFoldover(this);
+	updateGPUBuffersIsoGrid();
+	invalidateStatic(before.united(bounds()));
+}
+
+void FergusonPatch::prepare(const PatchPose &pose) const
+{
+	for (const HermiteCurveComputer &h : curves(pose))
+		h.computePoints();
+
+	FergusonGeometry g = poseGeometry(pose);
+	computeInteriorPoints(g);
+	computeIsoGridPoints(g);
+}
+
+std::vector<unsigned int> FergusonPatch::grabbedChannels() const
+{
+	// the controls of every curve as channels, in the order of its bits
+	const unsigned int controls[4][4] = {
+		{ PatchPose::P0, PatchPose::T01, PatchPose::P1, PatchPose::T10 },
+		{ PatchPose::P1, PatchPose::T13, PatchPose::P3, PatchPose::T31 },
+		{ PatchPose::P2, PatchPose::T23, PatchPose::P3, PatchPose::T32 },
+		{ PatchPose::P0, PatchPose::T02, PatchPose::P2, PatchPose::T20 } };
+	const HermiteCurveComputer *live[4] = { &h0_, &h1_, &h2_, &h3_ };
+
+	std::vector<unsigned int> channels;
+	for (unsigned int c = 0; c < 4; ++c) {
+		unsigned int bits = live[c]->selectedControls();
+		for (unsigned int i = 0; i < 4; ++i)
+			if (bits & (1u << i))
+				channels.push_back(controls[c][i]);
+	}
+
+	// corners are held by two curves
+	std::sort(channels.begin(), channels.end());
+	channels.erase(std::unique(channels.begin(), channels.end()), channels.end());
+	return channels;
+}
+
+void FergusonPatch::setCornerColours(const std::array<QVector3D, 4> &colours)
+{
+	if (colours == colours_)
+		return;
+
+	// only the filled interior carries the colours
+	colours_ = colours;
+	updateGPUBuffersInterior();
+	invalidateStatic(bounds());
+}
+
 std::vector<float> FergusonPatch::computePoints() const
 {
-	std::vector<float> vertices = h0_.computePoints();
-	
-	std::vector<float> vCurve = h1_.computePoints();
-	vertices.insert(vertices.end(), vCurve.begin(), vCurve.end());
-	
-	vCurve = h2_.computePoints();
-	vertices.insert(vertices.end(), vCurve.begin(), vCurve.end());
+	return computePoints({ h0_, h1_, h2_, h3_ });
+}
 
-	vCurve = h3_.computePoints();
-	vertices.insert(vertices.end(), vCurve.begin(), vCurve.end());
+std::vector<float> FergusonPatch::computePoints(const Curves &curves)
+{
+	std::vector<float> vertices;
+	for (const HermiteCurveComputer &h : curves) {
+		TessellationCache::Block vCurve = h.computePoints();
+		vertices.insert(vertices.end(), vCurve->begin(), vCurve->end());
+	}
 
 	return vertices;
 }
 
-void FergusonPatch::interpolateInnerPoint(float u, float v)
-{	
-	lastu_ = u;
-	lastv_ = v;
-	updateGPUBuffersInterpolatingLines(u, v);
+TessellationCache::Block FergusonPatch::computeInteriorPoints() const
+{
+	return computeInteriorPoints(geometry());
 }
 
-std::vector<float> FergusonPatch::computePointsForInterpolatingLines(float u, float v)
+TessellationCache::Block FergusonPatch::computeInteriorPoints(const FergusonGeometry &g) const
 {
-	std::vector<float> vertices(2*resolution_*2);
-	float step = 1.f / float(resolution_-1);
+	TessellationCache::Key key(InteriorBlock);
+	addGeometry(key, g);
+	for (const QVector3D &colour : colours_)
+		key.add(colour);
+	key.add(interiorResolution_);
 
-	for (unsigned i = 0; i < resolution_; i++) {
-		QPointF p = s(u , step * float(i));
-		
-		vertices[2*i] = p.x();
-		vertices[2*i+1] = p.y();
-	}
+	return TessellationCache::get(key, [this, &g]() { return tessellateInterior(g); });
+}
 
-	for (unsigned i = 0; i < resolution_; i++) {
-		QPointF p = s(step * float(i), v);
-		vertices[(2*resolution_)+(2*i)] = p.x();
-		vertices[(2*resolution_)+(2*i+1)] = p.y();
+std::vector<float> FergusonPatch::tessellateInterior(const FergusonGeometry &g) const
+{
+	unsigned int rowSize = interiorResolution_ + 1;
+	float step = 1.f / float(interiorResolution_);
+
+	// interleaved (x, y, r, g, b) per grid vertex, rows along u
+	std::vector<float> vertices(rowSize*rowSize*5);
+
+	for (unsigned int i = 0; i < rowSize; ++i) {
+		float u = step * float(i);
+		for (unsigned int j = 0; j < rowSize; ++j) {
+			float v = step * float(j);
+			QPointF p = g.s(u, v);
+			QVector3D colour = c(u, v);
+
+			float *vertex = &vertices[(i*rowSize + j)*5];
+			vertex[0] = p.x();
+			vertex[1] = p.y();
+			vertex[2] = colour.x();
+			vertex[3] = colour.y();
+			vertex[4] = colour.z();
+		}
 	}
 
-	QPointF p = s(u, v);
-	Circle circle(p, 0.02, 10);
-	std::vector<float> circleVertices = circle.computePoints();
-	vertices.insert(vertices.end(), circleVertices.begin(), circleVertices.end()); 
+	return vertices;
+}
+
+std::vector<float> FergusonPatch::computeFoldoverPoints() const
+{
+	return computeFoldoverPoints(geometry(), foldover());
+}
+
+std::vector<float> FergusonPatch::computeFoldoverPoints(const FergusonGeometry &g, const FoldoverChecker::Result &folds) const
+{
+	const std::vector<FoldoverChecker::Cell> &cells = folds.cells;
+	std::vector<float> vertices;
+	vertices.reserve(cells.size() * 12);
+
+	for (const FoldoverChecker::Cell &cell : cells) {
+		QPointF q[4] = { g.s(cell.u0, cell.v0), g.s(cell.u1, cell.v0), g.s(cell.u1, cell.v1), g.s(cell.u0, cell.v1) };
+		const unsigned int triangles[6] = { 0, 1, 2, 0, 2, 3 };
+		for (unsigned int k : triangles) {
+			vertices.push_back(q[k].x());
+			vertices.push_back(q[k].y());
+		}
+	}
 
 	return vertices;
 }
 
-float FergusonPatch::b0(float u3, float u2, float u1) const
+TessellationCache::Block FergusonPatch::computeIsoGridPoints() const
 {
-	return 2.f * u3 - 3.f * u2 + 1.f;
+	return computeIsoGridPoints(geometry());
 }
 
-float FergusonPatch::b1(float u3, float u2, float u1) const
+TessellationCache::Block FergusonPatch::computeIsoGridPoints(const FergusonGeometry &g) const
 {
-	return u3 - 2.f * u2 + u1;
+	TessellationCache::Key key(IsoGridBlock);
+	addGeometry(key, g);
+	key.add(isoGridULines_).add(isoGridVLines_).add(isoGridResolution_);
+
+	return TessellationCache::get(key, [this, &g]() { return tessellateIsoGrid(g); });
 }
 
-float FergusonPatch::b2(float u3, float u2, float u1) const
+std::vector<float> FergusonPatch::tessellateIsoGrid(const FergusonGeometry &g) const
 {
-	return u3 - u2;
+	unsigned int lines = isoGridULines_ + isoGridVLines_;
+	std::vector<float> vertices(lines * isoGridResolution_ * 2);
+
+	// each isoline is reduced once to a cubic and then tessellated on its own
+	float *out = vertices.data();
+	for (unsigned int i = 0; i < isoGridULines_; ++i) {
+		float u = float(i) / float(std::max(1u, isoGridULines_-1));
+		g.isoU(u).tessellate(isoGridResolution_, out);
+		out += 2*isoGridResolution_;
+	}
+
+	for (unsigned int j = 0; j < isoGridVLines_; ++j) {
+		float v = float(j) / float(std::max(1u, isoGridVLines_-1));
+		g.isoV(v).tessellate(isoGridResolution_, out);
+		out += 2*isoGridResolution_;
+	}
+
+	return vertices;
 }
 
-float FergusonPatch::b3(float u3, float u2, float u1) const
+void FergusonPatch::setIsoGridLines(unsigned int uLines, unsigned int vLines)
 {
-	return -2.f * u3 + 3.* u2;
+	isoGridULines_ = uLines;
+	isoGridVLines_ = vLines;
+	updateGPUBuffersIsoGrid();
+	invalidateStatic();
 }
 
-QPointF FergusonPatch::s(float u, float v) const
+void FergusonPatch::setQuantised(bool quantised)
 {
-	float u1 = u;
-	float u2 = u1*u1;
-	float u3 = u2*u1;
+	quantised_ = quantised;
+	updateGPUBuffersInterior();
+	updateGPUBuffersIsoGrid();
+	invalidateStatic();
+}
 
-	float v1 = v;
-	float v2 = v1*v1;
-	float v3 = v2*v1;
+void FergusonPatch::interpolateInnerPoint(float u, float v)
+{	
+	lastu_ = u;
+	lastv_ = v;
+	updateGPUBuffersInterpolatingLines(u, v);
+}
+
+std::vector<float> FergusonPatch::computePointsForInterpolatingLines(float u, float v) const
+{
+	return computePointsForInterpolatingLines(geometry(), u, v);
+}
+
+std::vector<float> FergusonPatch::computePointsForInterpolatingLines(const FergusonGeometry &g, float u, float v) const
+{
+	std::vector<float> vertices(2*resolution_*2);
+
+	g.isoU(u).tessellate(resolution_, &vertices[0]);
+	g.isoV(v).tessellate(resolution_, &vertices[2*resolution_]);
+
+	QPointF p = g.s(u, v);
+	Circle circle(p, 0.02, 10);
+	std::vector<float> circleVertices = circle.computePoints();
+	vertices.insert(vertices.end(), circleVertices.begin(), circleVertices.end()); 
+
+	return vertices;
+}
 
-	QPointF p0  = h0_.p0(), p1  = h0_.p1(), p2  = h2_.p0(), p3  = h2_.p1();
-	QPointF t01 = h0_.t0(), t10 = h0_.t1(), t13 = h1_.t0(), t31 = h1_.t1(),
-			t23 = h2_.t0(), t32 = h2_.t1(), t02 = h3_.t0(), t20 = h3_.t1(); 
+QPointF FergusonPatch::s(float u, float v) const
+{
+	// the one evaluation shared with the headless tools
+	return geometry().s(u, v);
+}
 
-	// return
-	// 	b0(u3, u2, u1) * (b0(v3, v2, v1)*p0  + b1(v3, v2, v1)*t02 + b2(v3, v2, v1)*t20 + b3(v3, v2, v1)*p2 ) + 
-	// 	b1(u3, u2, u1) * (b0(v3, v2, v1)*t01                                           + b3(v3, v2, v1)*t10) + 
-	// 	b2(u3, u2, u1) * (b0(v3, v2, v1)*t23                                           + b3(v3, v2, v1)*t32) +
-	// 	b3(u3, u2, u1) * (b0(v3, v2, v1)*p1  + b1(v3, v2, v1)*t13 + b2(v3, v2, v1)*t31 + b3(v3, v2, v1)*p3 );
-	return
-		b0(v3, v2, v1) * (b0(u3, u2, u1)*p0  + b1(u3, u2, u1)*t02 + b2(u3, u2, u1)*t20 + b3(u3, u2, u1)*p2 ) + 
-		b1(v3, v2, v1) * (b0(u3, u2, u1)*t01                                           + b3(u3, u2, u1)*t23) + 
-		b2(v3, v2, v1) * (b0(u3, u2, u1)*t10                                           + b3(u3, u2, u1)*t32) +
-		b3(v3, v2, v1) * (b0(u3, u2, u1)*p1  + b1(u3, u2, u1)*t13 + b2(u3, u2, u1)*t31 + b3(u3, u2, u1)*p3 );
+QVector3D FergusonPatch::c(float u, float v) const
+{
+	return 
+		(1.f-u) * ((1.f-v)*colours_[0] + v*colours_[1]) + 
+		      u * ((1.f-v)*colours_[2] + v*colours_[3]);
 }
 
 void FergusonPatch::init()
 {
 	initializeOpenGLFunctions();
-	setupShaders();
+	gl_ = QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_3_2_Core>();
+	gl_->initializeOpenGLFunctions();
+
+	// left uninitialised, it records and renders nothing
+	if (!setupShaders())
+		return;
 	setupGeometry();
+	setupInteriorGeometry();
+	updateGPUBuffersInterior();
+	canvas_->touchFoldover(this);
+	updateGPUBuffersIsoGrid();
 	interpolateInnerPoint(0.5f, 0.5f);
 }
 
-void FergusonPatch::setupShaders()
+bool FergusonPatch::setupShaders()
 {
-	shader_ = new QOpenGLShaderProgram();
-	shader_->addShaderFromSourceFile(QOpenGLShader::Vertex, "../shaders/ferguson.vs");
-	shader_->addShaderFromSourceFile(QOpenGLShader::Fragment, "../shaders/ferguson.fs");
-	shader_->bindAttributeLocation("pos", 0);
-	shader_->link();
-	shader_->bind();
+	// the registry has logged why a program did not build
+	shader_ = ShaderRegistry::acquire("ferguson");
+	lineShader_ = ShaderRegistry::acquire("ferguson_line");
+	fillShader_ = ShaderRegistry::acquire("ferguson_fill");
+	if (shader_ == nullptr || lineShader_ == nullptr || fillShader_ == nullptr) {
+		qWarning() << "FergusonPatch: missing shader programs, the patch is not drawn";
+		shader_.reset();
+		lineShader_.reset();
+		fillShader_.reset();
+		return false;
+	}
+	return true;
 }
 
 void FergusonPatch::setupGeometry()
 {
-	vao_.create();
-	QOpenGLVertexArrayObject::Binder vaoBinder(&vao_);
-
+	// the four curves with their handles, then the interpolating lines
 	std::vector<float> vertices = computePoints();
+	GLsizei count = GLsizei(vertices.size() / 2 + 2*resolution_ + 11);
 
-	vbo_.create();
-	vbo_.bind();
-	vbo_.allocate(vertices.data(), vertices.size() * sizeof(float) * resolution_*2*2);
+	VertexArena &arena = canvas_->arena(VertexArena::Position);
+	arena.resize(lines_, count);
+	arena.write(lines_, 0, vertices.data(), vertices.size() * sizeof(float));
+}
 
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+void FergusonPatch::setupInteriorGeometry()
+{
+	// bound into the arena's VAO by whoever draws the interior
+	gridIndices_ = GridIndexBuffer::acquire(interiorResolution_);
 }
 
 void FergusonPatch::updateGPUBuffers(const HermiteCurveComputer &h)
 {
+	// the render thread draws from snapshots, only ask for a new one; before
+	// init there is no range in the arenas to write to
+	if (canvas_->threaded() || shader_ == nullptr) {
+		canvas_->update();
+		return;
+	}
+
 	canvas_->makeCurrent();
-	std::vector<float> vertices = h.computePoints();
-	QOpenGLVertexArrayObject::Binder vaoBinder(&vao_);
-	
-	vbo_.bind();
-	vbo_.write(h.startIndex() * sizeof(float)*2, vertices.data(), vertices.size() * sizeof(float));
+	// uploaded straight from the cached block
+	TessellationCache::Block vertices = h.computePoints();
+	canvas_->arena(VertexArena::Position).write(
+		lines_, h.startIndex() * sizeof(float)*2, vertices->data(), vertices->size() * sizeof(float));
 	canvas_->update();
 	canvas_->doneCurrent();
 }
@@ -308,12 +605,15 @@ void FergusonPatch::updateGPUBuffers(const HermiteCurveComputer &h)
 
 void FergusonPatch::updateGPUBuffersInterpolatingLines(float u, float v)
 {
+	if (canvas_->threaded() || shader_ == nullptr) {
+		canvas_->update();
+		return;
+	}
+
 	canvas_->makeCurrent();
 	std::vector<float> vertices = computePointsForInterpolatingLines(u, v);
-	QOpenGLVertexArrayObject::Binder vaoBinder(&vao_);
-	 
-	vbo_.bind();
-	vbo_.write(
+	canvas_->arena(VertexArena::Position).write(
+		lines_,
 		(resolution_+4+44)*4 * sizeof(float)*2, 
 		vertices.data(),
 		vertices.size() * sizeof(float));
@@ -322,6 +622,125 @@ void FergusonPatch::updateGPUBuffersInterpolatingLines(float u, float v)
 	canvas_->doneCurrent();
 }
 
+void FergusonPatch::updateGPUBuffersInterior()
+{
+	if (canvas_->threaded() || shader_ == nullptr) {
+		canvas_->update();
+		return;
+	}
+
+	canvas_->makeCurrent();
+	TessellationCache::Block block = computeInteriorPoints();
+	const std::vector<float> &vertices = *block;
+	std::size_t count = vertices.size() / 5;
+	interiorFloatBytes_ = vertices.size() * sizeof(float);
+
+	if (quantised_) {
+		VertexQuantiser quantiser(vertices.data(), count, 5);
+
+		std::vector<PackedColourVertex> packed(count);
+		for (std::size_t i = 0; i < count; ++i) {
+			quantiser.position(&vertices[5*i], packed[i].position);
+			VertexQuantiser::colour(&vertices[5*i+2], packed[i].colour);
+		}
+
+		interiorBytes_ = packed.size() * sizeof(PackedColourVertex);
+		place(interiorArena_, interior_, canvas_->arena(VertexArena::PackedColouredPosition), GLsizei(count));
+		interiorArena_->write(interior_, 0, packed.data(), interiorBytes_);
+
+		interiorOffset_ = quantiser.offset();
+		interiorScale_ = quantiser.scale();
+	}
+	else {
+		interiorBytes_ = interiorFloatBytes_;
+		place(interiorArena_, interior_, canvas_->arena(VertexArena::ColouredPosition), GLsizei(count));
+		interiorArena_->write(interior_, 0, vertices.data(), interiorBytes_);
+
+		interiorOffset_ = QVector2D(0.f, 0.f);
+		interiorScale_ = QVector2D(1.f, 1.f);
+	}
+	commandsDirty_ = true;
+
+	pendingTraffic_.uploaded += interiorBytes_;
+	pendingTraffic_.saved += interiorFloatBytes_ - interiorBytes_;
+
+	canvas_->update();
+	canvas_->doneCurrent();
+}
+
+void FergusonPatch::setFoldover(const FoldoverChecker::Result &folds)
+{
+	foldover_ = folds;
+	updateGPUBuffersFoldover();
+}
+
+void FergusonPatch::updateGPUBuffersFoldover()
+{
+	// the canvas calls this while drawing and syncGPUBuffers while switching
+	// back from threaded rendering, both with the context current; snapshots
+	// read foldover_ directly
+	if (canvas_->threaded() || shader_ == nullptr)
+		return;
+
+	// the number of folded cells varies, the range moves once it outgrows its space
+	std::vector<float> vertices = computeFoldoverPoints();
+	VertexArena &arena = canvas_->arena(VertexArena::Position);
+	arena.resize(fold_, GLsizei(vertices.size() / 2));
+	if (!vertices.empty())
+		arena.write(fold_, 0, vertices.data(), vertices.size() * sizeof(float));
+	commandsDirty_ = true;
+}
+
+void FergusonPatch::updateGPUBuffersIsoGrid()
+{
+	if (canvas_->threaded() || shader_ == nullptr) {
+		canvas_->update();
+		return;
+	}
+
+	canvas_->makeCurrent();
+	TessellationCache::Block block = computeIsoGridPoints();
+	const std::vector<float> &vertices = *block;
+	std::size_t count = vertices.size() / 2;
+	isoGridFloatBytes_ = vertices.size() * sizeof(float);
+
+	if (quantised_) {
+		VertexQuantiser quantiser(vertices.data(), count, 2);
+
+		std::vector<GLshort> packed(2*count);
+		for (std::size_t i = 0; i < count; ++i)
+			quantiser.position(&vertices[2*i], &packed[2*i]);
+
+		isoGridBytes_ = packed.size() * sizeof(GLshort);
+		place(isoGridArena_, isoGrid_, canvas_->arena(VertexArena::PackedPosition), GLsizei(count));
+		isoGridArena_->write(isoGrid_, 0, packed.data(), isoGridBytes_);
+
+		isoGridOffset_ = quantiser.offset();
+		isoGridScale_ = quantiser.scale();
+	}
+	else {
+		isoGridBytes_ = isoGridFloatBytes_;
+		place(isoGridArena_, isoGrid_, canvas_->arena(VertexArena::Position), GLsizei(count));
+		isoGridArena_->write(isoGrid_, 0, vertices.data(), isoGridBytes_);
+
+		isoGridOffset_ = QVector2D(0.f, 0.f);
+		isoGridScale_ = QVector2D(1.f, 1.f);
+	}
+
+	pendingTraffic_.uploaded += isoGridBytes_;
+	pendingTraffic_.saved += isoGridFloatBytes_ - isoGridBytes_;
+
+	unsigned int lines = isoGridULines_ + isoGridVLines_;
+	isoGridFirsts_.resize(lines);
+	isoGridCounts_.assign(lines, GLsizei(isoGridResolution_));
+	for (unsigned int i = 0; i < lines; ++i)
+		isoGridFirsts_[i] = isoGrid_.first + GLint(i * isoGridResolution_);
+	commandsDirty_ = true;
+
+	canvas_->update();
+	canvas_->doneCurrent();
+}
+
 QPointF FergusonPatch::toViewportCoordSystem(const QPointF &screenCoords) const
 {
 	return QPointF(2.f * screenCoords.x() / canvas_->width() -1.f, 1.f - 2.f * screenCoords.y() / canvas_->height());
@@ -329,54 +748,338 @@ QPointF FergusonPatch::toViewportCoordSystem(const QPointF &screenCoords) const
 
 void FergusonPatch::render()
 {
-	QOpenGLVertexArrayObject::Binder vaoBinder(&vao_);
-	shader_->bind();
-	shader_->setUniformValue("colour", QVector3D(0.0f, 0.0f, 0.0f));
-	
-	glDrawArrays(GL_LINE_STRIP, h0_.startIndex(), h0_.resolution());
-	glDrawArrays(GL_LINE_STRIP, h1_.startIndex(), h1_.resolution());
-	glDrawArrays(GL_LINE_STRIP, h2_.startIndex(), h2_.resolution());
-	glDrawArrays(GL_LINE_STRIP, h3_.startIndex(), h3_.resolution());
+	renderStatic();
+	renderOverlay();
+}
+
+void FergusonPatch::renderStatic()
+{
+	if (shader_ == nullptr)
+		return;
+
+	if (shouldShowInterior_ && interiorArena_ != nullptr) {
+		QOpenGLVertexArrayObject::Binder fillVaoBinder(interiorArena_->vao());
+		gridIndices_->bind();
+		fillShader_->bind();
+		fillShader_->setUniformValue("offset", interiorOffset_);
+		fillShader_->setUniformValue("scale", interiorScale_);
+
+		pendingTraffic_.fetched += interiorBytes_;
+		pendingTraffic_.saved += interiorFloatBytes_ - interiorBytes_;
+
+		gl_->glEnable(GL_PRIMITIVE_RESTART);
+		gl_->glPrimitiveRestartIndex(GridIndexBuffer::RestartIndex);
+		gl_->glDrawElementsBaseVertex(GL_TRIANGLE_STRIP, gridIndices_->count(), GL_UNSIGNED_INT, nullptr, interior_.first);
+		gl_->glDisable(GL_PRIMITIVE_RESTART);
+	}
+
+	if (shouldShowIsoGrid_ && !isoGridFirsts_.empty()) {
+		QOpenGLVertexArrayObject::Binder isoGridVaoBinder(isoGridArena_->vao());
+		lineShader_->bind();
+		lineShader_->setUniformValue("colour", QVector3D(0.6f, 0.6f, 0.6f));
+		lineShader_->setUniformValue("offset", isoGridOffset_);
+		lineShader_->setUniformValue("scale", isoGridScale_);
+
+		pendingTraffic_.fetched += isoGridBytes_;
+		pendingTraffic_.saved += isoGridFloatBytes_ - isoGridBytes_;
+
+		gl_->glMultiDrawArrays(GL_LINE_STRIP, isoGridFirsts_.data(), isoGridCounts_.data(), 
+			GLsizei(isoGridFirsts_.size()));
+	}
+
+	// everything below is stored as floats in NDC
+	for (QOpenGLShaderProgram *program : { shader_.get(), lineShader_.get() }) {
+		program->bind();
+		program->setUniformValue("offset", QVector2D(0.f, 0.f));
+		program->setUniformValue("scale", QVector2D(1.f, 1.f));
+	}
+
+	QOpenGLVertexArrayObject::Binder vaoBinder(canvas_->arena(VertexArena::Position).vao());
 
+	if (shouldShowFoldover_ && fold_.count > 0) {
+		shader_->bind();
+		shader_->setUniformValue("colour", QVector3D(1.0f, 0.55f, 0.0f));
+		glDrawArrays(GL_TRIANGLES, fold_.first, fold_.count);
+	}
+
+	const HermiteCurveComputer *curves[4] = { &h0_, &h1_, &h2_, &h3_ };
+	lineShader_->bind();
+	lineShader_->setUniformValue("colour", QVector3D(0.0f, 0.0f, 0.0f));
+	for (const HermiteCurveComputer *h : curves)
+		glDrawArrays(GL_LINE_STRIP, lines_.first + h->startIndex(), h->resolution());
 
 	if (shouldShowHandlers_)
 	{
 		// Draw tangents
+		lineShader_->setUniformValue("colour", QVector3D(1.0f, 0.0f, 0.0f));
+		for (const HermiteCurveComputer *h : curves)
+			glDrawArrays(GL_LINES, lines_.first + h->startIndex() + h->resolution(), 4);
+
+		shader_->bind();
 		shader_->setUniformValue("colour", QVector3D(1.0f, 0.0f, 0.0f));
-		glDrawArrays(GL_LINES, h0_.startIndex()+h0_.resolution(), 4);
-		glDrawArrays(GL_LINES, h1_.startIndex()+h1_.resolution(), 4);
-		glDrawArrays(GL_LINES, h2_.startIndex()+h2_.resolution(), 4);
-		glDrawArrays(GL_LINES, h3_.startIndex()+h3_.resolution(), 4);
 
 		// draw circles
-		glDrawArrays(GL_TRIANGLE_FAN, h0_.startIndex()+h0_.resolution()+4+11*0, 11);
-		glDrawArrays(GL_TRIANGLE_FAN, h0_.startIndex()+h0_.resolution()+4+11*1, 11);
-		glDrawArrays(GL_TRIANGLE_FAN, h0_.startIndex()+h0_.resolution()+4+11*2, 11);
-		glDrawArrays(GL_TRIANGLE_FAN, h0_.startIndex()+h0_.resolution()+4+11*3, 11);
+		for (const HermiteCurveComputer *h : curves)
+			for (unsigned int k = 0; k < 4; ++k)
+				glDrawArrays(GL_TRIANGLE_FAN, lines_.first + h->startIndex() + h->resolution() + 4 + 11*k, 11);
+	}
+}
+
+void FergusonPatch::renderOverlay()
+{
+	if (shader_ == nullptr)
+		return;
+
+	// Draw interpolate lines
+	if (shouldShowInterpolateLines_) {
+		QOpenGLVertexArrayObject::Binder vaoBinder(canvas_->arena(VertexArena::Position).vao());
+		for (QOpenGLShaderProgram *program : { lineShader_.get(), shader_.get() }) {
+			program->bind();
+			program->setUniformValue("offset", QVector2D(0.f, 0.f));
+			program->setUniformValue("scale", QVector2D(1.f, 1.f));
+			program->setUniformValue("colour", QVector3D(0.0, 0.0, 1.0));
+		}
+
+		GLint first = lines_.first + h3_.startIndex() + h3_.resolution() + 4 + 11*4;
+		lineShader_->bind();
+		glDrawArrays(GL_LINE_STRIP, first, resolution_);
+		glDrawArrays(GL_LINE_STRIP, first + resolution_, resolution_);
+		shader_->bind();
+		glDrawArrays(GL_TRIANGLE_FAN, first + 2*resolution_, 11);
+	}
 
-		glDrawArrays(GL_TRIANGLE_FAN, h1_.startIndex()+h1_.resolution()+4+11*0, 11);
-		glDrawArrays(GL_TRIANGLE_FAN, h1_.startIndex()+h1_.resolution()+4+11*1, 11);
-		glDrawArrays(GL_TRIANGLE_FAN, h1_.startIndex()+h1_.resolution()+4+11*2, 11);
-		glDrawArrays(GL_TRIANGLE_FAN, h1_.startIndex()+h1_.resolution()+4+11*3, 11);
+	lastFrameTraffic_ = pendingTraffic_;
+	pendingTraffic_ = VertexTraffic();
+}
 
-		glDrawArrays(GL_TRIANGLE_FAN, h2_.startIndex()+h2_.resolution()+4+11*0, 11);
-		glDrawArrays(GL_TRIANGLE_FAN, h2_.startIndex()+h2_.resolution()+4+11*1, 11);
-		glDrawArrays(GL_TRIANGLE_FAN, h2_.startIndex()+h2_.resolution()+4+11*2, 11);
-		glDrawArrays(GL_TRIANGLE_FAN, h2_.startIndex()+h2_.resolution()+4+11*3, 11);
+bool FergusonPatch::record(CommandList &list)
+{
+	// same layers and colours as renderStatic and renderOverlay; every
+	// patch draws from the canvas' arenas, so equal packets of different
+	// patches end up in one batch
+	auto packet = [](unsigned int layer, QOpenGLShaderProgram *shader, QOpenGLVertexArrayObject *vao, 
+		QVector3D colour, GLenum mode, GLint first, GLsizei count) {
+		DrawPacket p;
+		p.layer = layer;
+		p.shader = shader;
+		p.vao = vao;
+		p.colour = colour;
+		p.mode = mode;
+		p.first = first;
+		p.count = count;
+		return p;
+	};
+
+	// nothing to draw with, but nothing to fall back on either
+	if (shader_ == nullptr) {
+		commandsDirty_ = false;
+		return true;
+	}
 
-		glDrawArrays(GL_TRIANGLE_FAN, h3_.startIndex()+h3_.resolution()+4+11*0, 11);
-		glDrawArrays(GL_TRIANGLE_FAN, h3_.startIndex()+h3_.resolution()+4+11*1, 11);
-		glDrawArrays(GL_TRIANGLE_FAN, h3_.startIndex()+h3_.resolution()+4+11*2, 11);
-		glDrawArrays(GL_TRIANGLE_FAN, h3_.startIndex()+h3_.resolution()+4+11*3, 11);
+	if (shouldShowInterior_ && interiorArena_ != nullptr) {
+		DrawPacket p = packet(DrawPacket::Fill, fillShader_.get(), interiorArena_->vao(), QVector3D(), 
+			GL_TRIANGLE_STRIP, 0, gridIndices_->count());
+		p.indices = gridIndices_.get();
+		p.baseVertex = interior_.first;
+		p.offset = interiorOffset_;
+		p.scale = interiorScale_;
+		list.add(p);
+	}
+
+	if (shouldShowIsoGrid_) {
+		for (std::size_t i = 0; i < isoGridFirsts_.size(); ++i) {
+			DrawPacket p = packet(DrawPacket::Grid, lineShader_.get(), isoGridArena_->vao(), QVector3D(0.6f, 0.6f, 0.6f), 
+				GL_LINE_STRIP, isoGridFirsts_[i], isoGridCounts_[i]);
+			p.offset = isoGridOffset_;
+			p.scale = isoGridScale_;
+			list.add(p);
+		}
+	}
+
+	QOpenGLVertexArrayObject *vao = canvas_->arena(VertexArena::Position).vao();
+
+	if (shouldShowFoldover_)
+		list.add(packet(DrawPacket::Highlight, shader_.get(), vao, QVector3D(1.0f, 0.55f, 0.0f), 
+			GL_TRIANGLES, fold_.first, fold_.count));
+
+	const HermiteCurveComputer *curves[4] = { &h0_, &h1_, &h2_, &h3_ };
+	for (const HermiteCurveComputer *h : curves)
+		list.add(packet(DrawPacket::Curves, lineShader_.get(), vao, QVector3D(0.0f, 0.0f, 0.0f), 
+			GL_LINE_STRIP, lines_.first + h->startIndex(), h->resolution()));
+
+	if (shouldShowHandlers_) {
+		QVector3D red(1.0f, 0.0f, 0.0f);
+		for (const HermiteCurveComputer *h : curves) {
+			GLint tangents = lines_.first + h->startIndex() + h->resolution();
+			list.add(packet(DrawPacket::Handles, lineShader_.get(), vao, red, GL_LINES, tangents, 4));
+			for (unsigned int k = 0; k < 4; ++k)
+				list.add(packet(DrawPacket::Handles, shader_.get(), vao, red, GL_TRIANGLE_FAN, tangents + 4 + 11*k, 11));
+		}
 	}
 
-	// Draw interpolate lines
 	if (shouldShowInterpolateLines_) {
-		shader_->setUniformValue("colour", QVector3D(0.0, 0.0, 1.0));
-		glDrawArrays(GL_LINE_STRIP, h3_.startIndex()+h3_.resolution()+4+11*4, resolution_);
-		glDrawArrays(GL_LINE_STRIP, (h3_.startIndex()+h3_.resolution()+4+11*4)+resolution_, resolution_);
-		glDrawArrays(GL_TRIANGLE_FAN, (h3_.startIndex()+h3_.resolution()+4+11*4)+2*resolution_, 11);
+		QVector3D blue(0.0f, 0.0f, 1.0f);
+		GLint first = lines_.first + h3_.startIndex() + h3_.resolution() + 4 + 11*4;
+		list.add(packet(DrawPacket::Overlay, lineShader_.get(), vao, blue, GL_LINE_STRIP, first, resolution_));
+		list.add(packet(DrawPacket::Overlay, lineShader_.get(), vao, blue, GL_LINE_STRIP, first + resolution_, resolution_));
+		list.add(packet(DrawPacket::Overlay, shader_.get(), vao, blue, GL_TRIANGLE_FAN, first + 2*resolution_, 11));
 	}
+
+	commandsDirty_ = false;
+	return true;
+}
+
+void FergusonPatch::frameRendered()
+{
+	if (shouldShowInterior_) {
+		pendingTraffic_.fetched += interiorBytes_;
+		pendingTraffic_.saved += interiorFloatBytes_ - interiorBytes_;
+	}
+
+	if (shouldShowIsoGrid_) {
+		pendingTraffic_.fetched += isoGridBytes_;
+		pendingTraffic_.saved += isoGridFloatBytes_ - isoGridBytes_;
+	}
+
+	lastFrameTraffic_ = pendingTraffic_;
+	pendingTraffic_ = VertexTraffic();
+}
+
+void FergusonPatch::snapshot(SceneSnapshot &scene) const
+{
+	snapshot(scene, { h0_, h1_, h2_, h3_ }, geometry(), QPointF(lastu_, lastv_), foldover());
+}
+
+void FergusonPatch::snapshot(SceneSnapshot &scene, const PatchPose &pose) const
+{
+	FergusonGeometry g = poseGeometry(pose);
+
+	// check() only reads the checker's settings
+	FoldoverChecker::Result folds;
+	if (shouldShowFoldover_)
+		folds = canvas_->foldoverChecker().check(g);
+
+	QPointF uv = pose[PatchPose::InnerPoint];
+	snapshot(scene, curves(pose), g, QPointF(qBound(0.f, float(uv.x()), 1.f), qBound(0.f, float(uv.y()), 1.f)), folds);
+}
+
+void FergusonPatch::snapshot(SceneSnapshot &scene, const Curves &curves, const FergusonGeometry &g, 
+	QPointF uv, const FoldoverChecker::Result &folds) const
+{
+	// mirrors renderStatic and renderOverlay, in NDC floats throughout
+	if (shouldShowInterior_) {
+		TessellationCache::Block block = computeInteriorPoints(g);
+		const std::vector<float> &interior = *block;
+		unsigned int rowSize = interiorResolution_ + 1;
+
+		for (unsigned int i = 0; i < interiorResolution_; ++i) {
+			GLint first = scene.colouredVertexCount();
+			for (unsigned int j = 0; j < rowSize; ++j) {
+				const float *a = &interior[(i*rowSize + j)*5];
+				const float *b = &interior[((i+1)*rowSize + j)*5];
+				scene.colouredVertices.insert(scene.colouredVertices.end(), a, a + 5);
+				scene.colouredVertices.insert(scene.colouredVertices.end(), b, b + 5);
+			}
+			scene.colouredDraws.push_back({ GL_TRIANGLE_STRIP, first, GLsizei(2*rowSize), QVector3D() });
+		}
+	}
+
+	auto append = [&scene](const std::vector<float> &vertices) {
+		GLint first = scene.vertexCount();
+		scene.vertices.insert(scene.vertices.end(), vertices.begin(), vertices.end());
+		return first;
+	};
+
+	if (shouldShowIsoGrid_) {
+		GLint first = append(*computeIsoGridPoints(g));
+		for (unsigned int i = 0; i < isoGridULines_ + isoGridVLines_; ++i)
+			scene.draws.push_back({ GL_LINE_STRIP, GLint(first + i*isoGridResolution_), 
+				GLsizei(isoGridResolution_), QVector3D(0.6f, 0.6f, 0.6f) });
+	}
+
+	if (shouldShowFoldover_) {
+		std::vector<float> foldVertices = computeFoldoverPoints(g, folds);
+		if (!foldVertices.empty()) {
+			GLint first = append(foldVertices);
+			scene.draws.push_back({ GL_TRIANGLES, first, GLsizei(foldVertices.size() / 2), QVector3D(1.0f, 0.55f, 0.0f) });
+		}
+	}
+
+	GLint base = append(computePoints(curves));
+
+	for (const HermiteCurveComputer &h : curves)
+		scene.draws.push_back({ GL_LINE_STRIP, GLint(base + h.startIndex()), 
+			GLsizei(h.resolution()), QVector3D(0.0f, 0.0f, 0.0f) });
+
+	if (shouldShowHandlers_) {
+		for (const HermiteCurveComputer &h : curves)
+			scene.draws.push_back({ GL_LINES, GLint(base + h.startIndex() + h.resolution()), 
+				4, QVector3D(1.0f, 0.0f, 0.0f) });
+
+		for (const HermiteCurveComputer &h : curves)
+			for (unsigned int k = 0; k < 4; ++k)
+				scene.draws.push_back({ GL_TRIANGLE_FAN, GLint(base + h.startIndex() + h.resolution() + 4 + 11*k), 
+					11, QVector3D(1.0f, 0.0f, 0.0f) });
+	}
+
+	if (shouldShowInterpolateLines_) {
+		GLint first = append(computePointsForInterpolatingLines(g, float(uv.x()), float(uv.y())));
+		QVector3D blue(0.0f, 0.0f, 1.0f);
+		scene.draws.push_back({ GL_LINE_STRIP, first, GLsizei(resolution_), blue });
+		scene.draws.push_back({ GL_LINE_STRIP, GLint(first + resolution_), GLsizei(resolution_), blue });
+		scene.draws.push_back({ GL_TRIANGLE_FAN, GLint(first + 2*resolution_), 11, blue });
+	}
+}
+
+void FergusonPatch::syncGPUBuffers()
+{
+	updateGPUBuffers(h0_);
+	updateGPUBuffers(h1_);
+	updateGPUBuffers(h2_);
+	updateGPUBuffers(h3_);
+	updateGPUBuffersInterpolatingLines(lastu_, lastv_);
+	updateGPUBuffersInterior();
+	updateGPUBuffersFoldover();
+	updateGPUBuffersIsoGrid();
+	invalidateStatic();
+}
+
+QRectF FergusonPatch::bounds() const
+{
+	// the Bezier net contains the patch, the handles stick out of it
+	FergusonGeometry::BezierNet net = geometry().bezier();
+	float left = net[0][0].x(), right = left, bottom = net[0][0].y(), top = bottom;
+
+	auto include = [&](const QPointF &p) {
+		left = std::min(left, float(p.x()));   right = std::max(right, float(p.x()));
+		bottom = std::min(bottom, float(p.y())); top = std::max(top, float(p.y()));
+	};
+
+	for (const std::array<QPointF, 4> &row : net)
+		for (const QPointF &p : row)
+			include(p);
+
+	for (const HermiteCurveComputer *h : { &h0_, &h1_, &h2_, &h3_ }) {
+		include(h->p0() + h->t0());
+		include(h->p1() + h->t1());
+	}
+
+	// handle circles and line width
+	const float margin = 0.03f;
+	return QRectF(left - margin, bottom - margin, right - left + 2.f*margin, top - bottom + 2.f*margin);
+}
+
+void FergusonPatch::invalidateStatic(const QRectF &region)
+{
+	commandsDirty_ = true;
+	staticDirty_ = true;
+	staticDirtyRegion_ = staticDirtyRegion_.united(region);
+}
+
+void FergusonPatch::markStaticClean()
+{
+	staticDirty_ = false;
+	staticDirtyRegion_ = QRectF();
 }
 
 void FergusonPatch::keyPress(QKeyEvent *e)
@@ -399,6 +1102,9 @@ void FergusonPatch::mousePress(QMouseEvent *e)
 void FergusonPatch::mouseMove(QMouseEvent *e)
 { 
 	QPointF p = toViewportCoordSystem(e->localPos());
+	bool moved = h0_.hasControlPointSelected() || h1_.hasControlPointSelected() || 
+	             h2_.hasControlPointSelected() || h3_.hasControlPointSelected();
+	QRectF before = moved ? bounds() : QRectF();
 
 	if (h0_.hasControlPointSelected()) {
 		h0_.mouseMove(p);
@@ -420,6 +1126,13 @@ void FergusonPatch::mouseMove(QMouseEvent *e)
 		updateGPUBuffers(h3_);
 		interpolateInnerPoint(lastu_, lastv_);
 	}
+
+	if (moved) {
+		updateGPUBuffersInterior();
+		canvas_->touchFoldover(this);
+		updateGPUBuffersIsoGrid();
+		invalidateStatic(before.united(bounds()));
+	}
 }
 
 void FergusonPatch::mouseRelease(QMouseEvent *e)
@@ -434,11 +1147,25 @@ void FergusonPatch::mouseRelease(QMouseEvent *e)
 void FergusonPatch::cleanUp()
 {
 	if (shader_ != nullptr) {
-		vao_.destroy();
-		vbo_.destroy();
-
-		delete shader_;
-		shader_ = nullptr;
+		// only bookkeeping, the arenas belong to the canvas
+		VertexArena &arena = canvas_->arena(VertexArena::Position);
+		arena.free(lines_);
+		arena.free(fold_);
+
+		if (interiorArena_ != nullptr)
+			interiorArena_->free(interior_);
+		interiorArena_ = nullptr;
+		gridIndices_.reset();
+
+		if (isoGridArena_ != nullptr)
+			isoGridArena_->free(isoGrid_);
+		isoGridArena_ = nullptr;
+		isoGridFirsts_.clear();
+		isoGridCounts_.clear();
+
+		shader_.reset();
+		lineShader_.reset();
+		fillShader_.reset();
 	}
 }
 
@@ -0,0 +1,261 @@
+#include <foldover_checker.hpp>
+#include <parallel_for.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace
+{
+	const float Binomial[6][6] = {
+		{ 1.f },
+		{ 1.f, 1.f },
+		{ 1.f, 2.f,  1.f },
+		{ 1.f, 3.f,  3.f,  1.f },
+		{ 1.f, 4.f,  6.f,  4.f, 1.f },
+		{ 1.f, 5.f, 10.f, 10.f, 5.f, 1.f }
+	};
+
+	// Bernstein coefficients c[0], c[stride], ... of a quintic on [0,1],
+	// replaced in place by those of the same polynomial on [a,b]
+	void restrict1D(float *c, unsigned int stride, float a, float b)
+	{
+		float w[6];
+		for (unsigned int i = 0; i < 6; ++i)
+			w[i] = c[i*stride];
+
+		// left part of the split at b covers [0,b]
+		float left[6];
+		for (unsigned int level = 0; level < 6; ++level) {
+			left[level] = w[0];
+			for (unsigned int i = 0; i < 5 - level; ++i)
+				w[i] = (1.f - b)*w[i] + b*w[i+1];
+		}
+
+		// right part of the split at a/b covers [a,b]
+		float t = a / b;
+		for (unsigned int level = 0; level < 6; ++level) {
+			c[(5 - level)*stride] = left[5 - level];
+			for (unsigned int i = 0; i < 5 - level; ++i)
+				left[i] = (1.f - t)*left[i] + t*left[i+1];
+		}
+	}
+
+	float cross(const QPointF &a, const QPointF &b)
+	{
+		return a.x()*b.y() - a.y()*b.x();
+	}
+
+	// corners this close are shared, as in ContinuityConstraints::detect
+	const double CornerTolerance = 1e-6;
+
+	// the cell of a grid the size of the tolerance a corner falls in, or the
+	// one dx, dy cells away; -0.0 and 0.0 share a cell
+	std::uint64_t cornerKey(const QPointF &p, std::int64_t dx = 0, std::int64_t dy = 0)
+	{
+		std::int64_t cx = std::int64_t(std::floor(p.x() / CornerTolerance)) + dx;
+		std::int64_t cy = std::int64_t(std::floor(p.y() / CornerTolerance)) + dy;
+		return (std::uint64_t(cx) << 32) | (std::uint64_t(cy) & 0xffffffffu);
+	}
+
+	// p0, p1, p2 and p3 in the geometry matrix
+	const unsigned int Corners[4][2] = { { 0, 0 }, { 3, 0 }, { 0, 3 }, { 3, 3 } };
+}
+
+FoldoverChecker::FoldoverChecker(unsigned int cells, unsigned int depth)
+	:cells_{cells}, depth_{depth}
+{}
+
+FoldoverChecker::Jacobian FoldoverChecker::jacobian(const FergusonGeometry &geometry)
+{
+	FergusonGeometry::BezierNet net = geometry.bezier();
+
+	// Bezier nets of s_u, degree (3,2), and s_v, degree (2,3), as [v][u]
+	QPointF du[4][3], dv[3][4];
+	for (unsigned int a = 0; a < 4; ++a)
+		for (unsigned int b = 0; b < 3; ++b)
+			du[a][b] = 3.f * (net[a][b+1] - net[a][b]);
+
+	for (unsigned int a = 0; a < 3; ++a)
+		for (unsigned int b = 0; b < 4; ++b)
+			dv[a][b] = 3.f * (net[a+1][b] - net[a][b]);
+
+	Jacobian j{};
+	for (unsigned int a = 0; a < 4; ++a)
+	for (unsigned int b = 0; b < 3; ++b)
+	for (unsigned int c = 0; c < 3; ++c)
+	for (unsigned int d = 0; d < 4; ++d) {
+		float weight = Binomial[3][a] * Binomial[2][c] * Binomial[2][b] * Binomial[3][d];
+		j[a+c][b+d] += weight * cross(du[a][b], dv[c][d]);
+	}
+
+	for (unsigned int p = 0; p < 6; ++p)
+		for (unsigned int q = 0; q < 6; ++q)
+			j[p][q] /= Binomial[5][p] * Binomial[5][q];
+
+	return j;
+}
+
+FoldoverChecker::Jacobian FoldoverChecker::restrict(const Jacobian &j, const Cell &cell)
+{
+	Jacobian r = j;
+	for (unsigned int p = 0; p < 6; ++p)
+		restrict1D(&r[p][0], 1, cell.u0, cell.u1);
+	for (unsigned int q = 0; q < 6; ++q)
+		restrict1D(&r[0][q], 6, cell.v0, cell.v1);
+	return r;
+}
+
+void FoldoverChecker::classify(const Jacobian &j, float orientation, const Cell &cell,
+	unsigned int depth, Result &result) const
+{
+	Jacobian r = restrict(j, cell);
+
+	float lower = orientation * r[0][0];
+	float upper = lower;
+	for (const std::array<float, 6> &row : r) {
+		for (float coefficient : row) {
+			lower = std::min(lower, orientation * coefficient);
+			upper = std::max(upper, orientation * coefficient);
+		}
+	}
+
+	if (lower > 0.f)
+		return;
+
+	if (upper >= 0.f && depth > 0) {
+		float um = 0.5f * (cell.u0 + cell.u1);
+		float vm = 0.5f * (cell.v0 + cell.v1);
+		classify(j, orientation, Cell{cell.u0, cell.v0, um, vm}, depth-1, result);
+		classify(j, orientation, Cell{um, cell.v0, cell.u1, vm}, depth-1, result);
+		classify(j, orientation, Cell{cell.u0, vm, um, cell.v1}, depth-1, result);
+		classify(j, orientation, Cell{um, vm, cell.u1, cell.v1}, depth-1, result);
+		return;
+	}
+
+	// corner coefficients are exact values, so a negative one proves the fold
+	float corners[4] = { r[0][0], r[0][5], r[5][0], r[5][5] };
+	for (float corner : corners)
+		if (orientation * corner < 0.f)
+			result.folded = true;
+
+	if (upper < 0.f)
+		result.folded = true;
+
+	result.cells.push_back(cell);
+}
+
+FoldoverChecker::Result FoldoverChecker::check(const FergusonGeometry &geometry) const
+{
+	Jacobian j = jacobian(geometry);
+
+	// every Bernstein basis function integrates to the same value, so the
+	// mean coefficient has the sign of the patch's signed area
+	float area = 0.f;
+	for (const std::array<float, 6> &row : j)
+		for (float coefficient : row)
+			area += coefficient;
+	float orientation = area < 0.f ? -1.f : 1.f;
+
+	Result result;
+	float step = 1.f / float(cells_);
+	for (unsigned int i = 0; i < cells_; ++i) {
+		for (unsigned int k = 0; k < cells_; ++k) {
+			Cell cell{step * float(k), step * float(i), step * float(k+1), step * float(i+1)};
+			classify(j, orientation, cell, depth_, result);
+		}
+	}
+
+	return result;
+}
+
+const std::vector<FoldoverChecker::Result> &FoldoverChecker::update(
+	const std::vector<FergusonGeometry> &patches)
+{
+	std::vector<std::size_t> all(patches.size());
+	std::iota(all.begin(), all.end(), std::size_t(0));
+	return update(patches, all);
+}
+
+const std::vector<FoldoverChecker::Result> &FoldoverChecker::update(
+	const std::vector<FergusonGeometry> &patches, const std::vector<std::size_t> &edited)
+{
+	// patches dropped from the end leave the index
+	for (std::size_t i = patches.size(); i < geometries_.size(); ++i)
+		index(i, false);
+	std::size_t known = std::min(geometries_.size(), patches.size());
+
+	std::vector<char> candidate(patches.size(), 0);
+	std::fill(candidate.begin() + known, candidate.end(), 1);
+	for (std::size_t e : edited) {
+		if (e >= known)
+			continue;
+		candidate[e] = 1;
+
+		// a control shared with neighbours moves them too, wherever the
+		// corner was or went; corners within the tolerance may lie in the
+		// next cell
+		const FergusonGeometry *before = &geometries_[e], *after = &patches[e];
+		for (const FergusonGeometry *g : { before, after })
+			for (const unsigned int *corner : Corners)
+				for (std::int64_t dx = -1; dx <= 1; ++dx)
+					for (std::int64_t dy = -1; dy <= 1; ++dy) {
+						auto found = corners_.find(cornerKey(g->g(corner[0], corner[1]), dx, dy));
+						if (found == corners_.end())
+							continue;
+						for (std::size_t n : found->second)
+							if (n < patches.size())
+								candidate[n] = 1;
+					}
+	}
+
+	checked_.clear();
+	for (std::size_t i = 0; i < patches.size(); ++i)
+		if (candidate[i] && (i >= known || geometries_[i] != patches[i]))
+			checked_.push_back(i);
+
+	geometries_.resize(patches.size());
+	results_.resize(patches.size());
+	for (std::size_t i : checked_) {
+		if (i < known)
+			index(i, false);
+		geometries_[i] = patches[i];
+		index(i, true);
+	}
+
+	// a check costs far more than starting a thread
+	parallelFor(checked_.size(), [this](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; ++i)
+			results_[checked_[i]] = check(geometries_[checked_[i]]);
+	}, 2);
+
+	return results_;
+}
+
+void FoldoverChecker::clear()
+{
+	geometries_.clear();
+	results_.clear();
+	checked_.clear();
+	corners_.clear();
+}
+
+void FoldoverChecker::index(std::size_t i, bool add)
+{
+	const FergusonGeometry &g = geometries_[i];
+	for (const unsigned int *corner : Corners) {
+		std::uint64_t key = cornerKey(g.g(corner[0], corner[1]));
+		if (add) {
+			corners_[key].push_back(i);
+			continue;
+		}
+
+		auto found = corners_.find(key);
+		if (found == corners_.end())
+			continue;
+		std::vector<std::size_t> &at = found->second;
+		at.erase(std::remove(at.begin(), at.end(), i), at.end());
+		if (at.empty())
+			corners_.erase(found);
+	}
+}
\ No newline at end of file
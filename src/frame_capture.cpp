@@ -0,0 +1,216 @@
+#include <frame_capture.hpp>
+
+#include <QDebug>
+#include <QOpenGLContext>
+#include <algorithm>
+#include <cstring>
+
+// ------------------------------- ImageEncoder -------------------------------------------------------
+ImageEncoder::ImageEncoder(unsigned int threads)
+	:stopping_{false}
+{
+	for (unsigned int i = 0; i < std::max(1u, threads); ++i)
+		workers_.emplace_back([this]() { run(); });
+}
+
+ImageEncoder::~ImageEncoder()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	wake_.notify_all();
+	for (std::thread &worker : workers_)
+		worker.join();
+}
+
+void ImageEncoder::encode(QImage image, const QString &filename, bool flipped)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		jobs_.push_back({ image, filename, flipped });
+	}
+	wake_.notify_one();
+}
+
+void ImageEncoder::fail(const QString &filename)
+{
+	if (done_)
+		done_(filename, false);
+}
+
+std::size_t ImageEncoder::backlog() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return jobs_.size();
+}
+
+void ImageEncoder::waitForBacklog(std::size_t images)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	taken_.wait(lock, [&]() { return jobs_.size() <= images; });
+}
+
+void ImageEncoder::run()
+{
+	for (;;) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			wake_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+			if (jobs_.empty())
+				return;
+
+			job = jobs_.front();
+			jobs_.pop_front();
+		}
+		taken_.notify_all();
+
+		QImage image = job.flipped ? job.image.mirrored() : job.image;
+		bool ok = image.convertToFormat(QImage::Format_RGB32).save(job.filename);
+		if (done_)
+			done_(job.filename, ok);
+	}
+}
+
+// ------------------------------- FrameCapture -------------------------------------------------------
+FrameCapture::FrameCapture(unsigned int slots, unsigned int encoders)
+	:gl_{nullptr}, slots_(slots), oldest_{0}, inFlight_{0}, dropped_{0}, backlogLimit_{0},
+	 resolveFbo_{0}, resolveColour_{0}, encoder_{encoders}
+{ }
+
+void FrameCapture::init()
+{
+	gl_ = QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_3_2_Core>();
+	gl_->initializeOpenGLFunctions();
+
+	for (Slot &slot : slots_) {
+		slot.pbo.create();
+		slot.pbo.setUsagePattern(QOpenGLBuffer::StreamRead);
+	}
+}
+
+bool FrameCapture::capture(GLuint framebuffer, QSize size, int samples, const QString &filename)
+{
+	// every read queues an image, an encoder falling behind would pile them up
+	if (inFlight_ == slots_.size() || (backlogLimit_ > 0 && encoder_.backlog() > backlogLimit_)) {
+		++dropped_;
+		return false;
+	}
+
+	GLint previous = 0;
+	gl_->glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+
+	// multisampled buffers cannot be read, they are resolved into a plain one
+	GLuint source = framebuffer;
+	if (samples > 0) {
+		if (resolveFbo_ == 0 || resolveSize_ != size) {
+			if (resolveFbo_ == 0) {
+				gl_->glGenFramebuffers(1, &resolveFbo_);
+				gl_->glGenRenderbuffers(1, &resolveColour_);
+			}
+			gl_->glBindRenderbuffer(GL_RENDERBUFFER, resolveColour_);
+			gl_->glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size.width(), size.height());
+			gl_->glBindFramebuffer(GL_FRAMEBUFFER, resolveFbo_);
+			gl_->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, resolveColour_);
+			resolveSize_ = size;
+		}
+
+		gl_->glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+		gl_->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveFbo_);
+		gl_->glBlitFramebuffer(0, 0, size.width(), size.height(), 0, 0, size.width(), size.height(),
+			GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		source = resolveFbo_;
+	}
+
+	Slot &slot = slots_[(oldest_ + inFlight_) % slots_.size()];
+	slot.size = size;
+	slot.filename = filename;
+
+	slot.pbo.bind();
+	int bytes = size.width() * size.height() * 4;
+	if (slot.pbo.size() != bytes)
+		slot.pbo.allocate(bytes);
+
+	// with a pack buffer bound the read only queues a copy on the GPU
+	gl_->glBindFramebuffer(GL_READ_FRAMEBUFFER, source);
+	gl_->glReadBuffer(GL_COLOR_ATTACHMENT0);
+	gl_->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	gl_->glReadPixels(0, 0, size.width(), size.height(), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	slot.pbo.release();
+
+	slot.fence = gl_->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	gl_->glFlush();
+	++inFlight_;
+
+	gl_->glBindFramebuffer(GL_FRAMEBUFFER, GLuint(previous));
+	return true;
+}
+
+bool FrameCapture::poll()
+{
+	while (inFlight_ > 0) {
+		Slot &slot = slots_[oldest_];
+
+		// frames are handed over in order, so stop at the first unfinished one
+		GLenum status = gl_->glClientWaitSync(slot.fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			return true;
+
+		gl_->glDeleteSync(slot.fence);
+		slot.fence = nullptr;
+
+		slot.pbo.bind();
+		int bytes = slot.size.width() * slot.size.height() * 4;
+		void *pixels = slot.pbo.mapRange(0, bytes, QOpenGLBuffer::RangeRead);
+		if (pixels != nullptr) {
+			// one copy out of the mapping, everything else is done by the worker
+			QImage image(slot.size, QImage::Format_RGBA8888);
+			std::memcpy(image.bits(), pixels, bytes);
+			slot.pbo.unmap();
+			encoder_.encode(image, slot.filename, true);
+		} else {
+			qWarning() << "FrameCapture: cannot map the read back of" << slot.filename;
+			++dropped_;
+			encoder_.fail(slot.filename);
+		}
+		slot.pbo.release();
+
+		oldest_ = (oldest_ + 1) % slots_.size();
+		--inFlight_;
+	}
+
+	return false;
+}
+
+void FrameCapture::waitForSlot()
+{
+	if (inFlight_ < slots_.size())
+		return;
+
+	gl_->glClientWaitSync(slots_[oldest_].fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+	poll();
+}
+
+void FrameCapture::cleanUp()
+{
+	if (gl_ == nullptr)
+		return;
+
+	// reads still in flight are finished rather than lost
+	for (unsigned int i = 0; i < inFlight_; ++i)
+		gl_->glClientWaitSync(slots_[(oldest_ + i) % slots_.size()].fence,
+			GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+	poll();
+
+	for (Slot &slot : slots_)
+		slot.pbo.destroy();
+
+	if (resolveFbo_ != 0) {
+		gl_->glDeleteFramebuffers(1, &resolveFbo_);
+		gl_->glDeleteRenderbuffers(1, &resolveColour_);
+		resolveFbo_ = resolveColour_ = 0;
+	}
+
+	gl_ = nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include <gpu_evaluator.hpp>
+#include <parallel_for.hpp>
+#include <shader_registry.hpp>
+
+#include <QElapsedTimer>
+#include <QOpenGLContext>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <random>
+
+namespace
+{
+	void evaluateOnCpu(const std::vector<FergusonGeometry> &patches, const GpuEvaluator::Sample &sample,
+		bool derivatives, float *out)
+	{
+		const FergusonGeometry &g = patches[sample.patch];
+		QPointF p = g.s(sample.u, sample.v);
+		out[0] = float(p.x());
+		out[1] = float(p.y());
+		if (derivatives) {
+			QPointF su = g.su(sample.u, sample.v), sv = g.sv(sample.u, sample.v);
+			out[2] = float(su.x()); out[3] = float(su.y());
+			out[4] = float(sv.x()); out[5] = float(sv.y());
+		}
+	}
+}
+
+QString GpuEvaluator::Benchmark::toString() const
+{
+	auto rate = [this](double seconds) { return seconds > 0.0 ? double(samples) / seconds / 1e6 : 0.0; };
+	return QString("%1 samples: CPU %2 ms (%3 M/s), GPU %4 ms (%5 M/s), max difference %6, %7 is faster")
+		.arg(samples)
+		.arg(cpuSeconds * 1e3, 0, 'f', 1).arg(rate(cpuSeconds), 0, 'f', 1)
+		.arg(gpuSeconds * 1e3, 0, 'f', 1).arg(rate(gpuSeconds), 0, 'f', 1)
+		.arg(maxDifference, 0, 'g', 3)
+		.arg(gpuFaster() ? "GPU" : "CPU");
+}
+
+GpuEvaluator::GpuEvaluator(std::size_t batchSize)
+	:gl_{nullptr}, geometryTexture_{0}, patchCount_{0}, batchSize_{std::max<std::size_t>(1, batchSize)}, derivatives_{false}
+{ }
+
+bool GpuEvaluator::init()
+{
+	gl_ = QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_3_2_Core>();
+	gl_->initializeOpenGLFunctions();
+
+	program_ = ShaderRegistry::acquire("ferguson_eval");
+	derivativesProgram_ = ShaderRegistry::acquire("ferguson_eval_derivatives");
+	if (program_ == nullptr || derivativesProgram_ == nullptr)
+		return false;
+
+	geometry_.create();
+	geometry_.setUsagePattern(QOpenGLBuffer::StaticDraw);
+	gl_->glGenTextures(1, &geometryTexture_);
+
+	for (Slot &slot : slots_) {
+		slot.vao.create();
+		QOpenGLVertexArrayObject::Binder vaoBinder(&slot.vao);
+
+		slot.samples.create();
+		slot.samples.setUsagePattern(QOpenGLBuffer::StreamDraw);
+		slot.samples.bind();
+
+		gl_->glEnableVertexAttribArray(0);
+		gl_->glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(Sample), 0);
+		gl_->glEnableVertexAttribArray(1);
+		gl_->glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Sample),
+			reinterpret_cast<void*>(offsetof(Sample, u)));
+
+		slot.results.create();
+		slot.results.setUsagePattern(QOpenGLBuffer::StreamRead);
+	}
+
+	return true;
+}
+
+void GpuEvaluator::cleanUp()
+{
+	for (Slot &slot : slots_) {
+		slot.vao.destroy();
+		slot.samples.destroy();
+		slot.results.destroy();
+	}
+
+	if (geometryTexture_ != 0) {
+		gl_->glDeleteTextures(1, &geometryTexture_);
+		geometryTexture_ = 0;
+	}
+	geometry_.destroy();
+	program_.reset();
+	derivativesProgram_.reset();
+}
+
+void GpuEvaluator::setPatches(const std::vector<FergusonGeometry> &patches)
+{
+	std::vector<float> texels;
+	texels.reserve(patches.size() * 32);
+	for (const FergusonGeometry &g : patches)
+		for (unsigned int i = 0; i < 4; ++i)
+			for (unsigned int j = 0; j < 4; ++j) {
+				texels.push_back(float(g.g(i, j).x()));
+				texels.push_back(float(g.g(i, j).y()));
+			}
+
+	geometry_.bind();
+	geometry_.allocate(texels.data(), int(texels.size() * sizeof(float)));
+	geometry_.release();
+
+	gl_->glBindTexture(GL_TEXTURE_BUFFER, geometryTexture_);
+	gl_->glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32F, geometry_.bufferId());
+	gl_->glBindTexture(GL_TEXTURE_BUFFER, 0);
+	patchCount_ = patches.size();
+}
+
+void GpuEvaluator::evaluate(const Sample *samples, std::size_t count, float *out)
+{
+	std::size_t values = valuesPerSample();
+	std::size_t batches = (count + batchSize_ - 1) / batchSize_;
+
+	// batch b is queued before batch b-1 is read, the GPU works during the read
+	for (std::size_t b = 0; b <= batches; ++b) {
+		if (b < batches)
+			submit(slots_[b % 2], samples + b * batchSize_, std::min(batchSize_, count - b * batchSize_));
+		if (b > 0)
+			readBack(slots_[(b - 1) % 2], out + (b - 1) * batchSize_ * values);
+	}
+}
+
+QOpenGLBuffer &GpuEvaluator::evaluateToBuffer(const Sample *samples, std::size_t count)
+{
+	submit(slots_[0], samples, count);
+	return slots_[0].results;
+}
+
+void GpuEvaluator::submit(Slot &slot, const Sample *samples, std::size_t count)
+{
+	QOpenGLShaderProgram *program = derivatives_ ? derivativesProgram_.get() : program_.get();
+	slot.count = count;
+
+	QOpenGLVertexArrayObject::Binder vaoBinder(&slot.vao);
+
+	// fresh storage every batch, the driver need not wait for the last draw
+	slot.samples.bind();
+	slot.samples.allocate(samples, int(count * sizeof(Sample)));
+	slot.results.bind();
+	slot.results.allocate(int(count * valuesPerSample() * sizeof(float)));
+	gl_->glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, slot.results.bufferId());
+
+	program->bind();
+	gl_->glActiveTexture(GL_TEXTURE0);
+	gl_->glBindTexture(GL_TEXTURE_BUFFER, geometryTexture_);
+	program->setUniformValue("geometry", 0);
+
+	gl_->glEnable(GL_RASTERIZER_DISCARD);
+	gl_->glBeginTransformFeedback(GL_POINTS);
+	gl_->glDrawArrays(GL_POINTS, 0, GLsizei(count));
+	gl_->glEndTransformFeedback();
+	gl_->glDisable(GL_RASTERIZER_DISCARD);
+
+	gl_->glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	gl_->glBindTexture(GL_TEXTURE_BUFFER, 0);
+	program->release();
+}
+
+void GpuEvaluator::readBack(Slot &slot, float *out)
+{
+	slot.results.bind();
+	slot.results.read(0, out, int(slot.count * valuesPerSample() * sizeof(float)));
+	slot.results.release();
+}
+
+GpuEvaluator::Benchmark GpuEvaluator::benchmark(const std::vector<FergusonGeometry> &patches, std::size_t samples,
+	bool derivatives)
+{
+	Benchmark result;
+	if (patches.empty() || samples == 0)
+		return result;
+
+	std::mt19937 random(1);
+	std::uniform_int_distribution<std::uint32_t> patch(0, std::uint32_t(patches.size() - 1));
+	std::uniform_real_distribution<float> parameter(0.f, 1.f);
+	std::vector<Sample> input(samples);
+	for (Sample &s : input)
+		s = { patch(random), parameter(random), parameter(random) };
+
+	GpuEvaluator gpu;
+	gpu.derivatives(derivatives);
+	if (!gpu.init())
+		return result;
+	unsigned int values = gpu.valuesPerSample();
+
+	std::vector<float> cpuOut(samples * values), gpuOut(samples * values);
+	QElapsedTimer timer;
+
+	timer.start();
+	parallelFor(samples, [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; ++i)
+			evaluateOnCpu(patches, input[i], derivatives, &cpuOut[i * values]);
+	}, 4096);
+	result.cpuSeconds = double(timer.nsecsElapsed()) * 1e-9;
+
+	// the first draw compiles and sets up more than later ones
+	gpu.setPatches(patches);
+	gpu.evaluate(input.data(), std::min<std::size_t>(samples, 1024), gpuOut.data());
+
+	timer.restart();
+	gpu.setPatches(patches);
+	gpu.evaluate(input.data(), samples, gpuOut.data());
+	result.gpuSeconds = double(timer.nsecsElapsed()) * 1e-9;
+	gpu.cleanUp();
+
+	result.samples = samples;
+	for (std::size_t i = 0; i < cpuOut.size(); ++i)
+		result.maxDifference = std::max(result.maxDifference, double(std::abs(cpuOut[i] - gpuOut[i])));
+	return result;
+}
\ No newline at end of file
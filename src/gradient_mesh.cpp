@@ -0,0 +1,47 @@
+#include <gradient_mesh.hpp>
+
+GradientMesh::GradientMesh(unsigned int rows, unsigned int columns)
+	:rows_{rows}, columns_{columns}, vertices_((rows+1) * (columns+1))
+{ }
+
+GradientMesh GradientMesh::grid(unsigned int rows, unsigned int columns, const QRectF &region)
+{
+	GradientMesh mesh(rows, columns);
+
+	// rows run down from the top of region, NDC has y up
+	QPointF du(0.f, -region.height() / rows);
+	QPointF dv(region.width() / columns, 0.f);
+	QPointF origin(region.left(), region.top() + region.height());
+
+	for (unsigned int r = 0; r <= rows; ++r)
+		for (unsigned int c = 0; c <= columns; ++c) {
+			Vertex &v = mesh.vertex(r, c);
+			v.position = origin + float(r) * du + float(c) * dv;
+			v.tu = du;
+			v.tv = dv;
+			v.colour = QVector3D(1.f, 1.f, 1.f);
+		}
+
+	return mesh;
+}
+
+PatchPose GradientMesh::pose(unsigned int r, unsigned int c) const
+{
+	const Vertex &a = vertex(r, c), &b = vertex(r, c+1), &d = vertex(r+1, c), &e = vertex(r+1, c+1);
+
+	// tab follows the boundary curve from corner a towards corner b
+	PatchPose pose;
+	pose[PatchPose::P0]  = a.position; pose[PatchPose::P1]  = b.position;
+	pose[PatchPose::P2]  = d.position; pose[PatchPose::P3]  = e.position;
+	pose[PatchPose::T01] = a.tv;       pose[PatchPose::T10] = b.tv;
+	pose[PatchPose::T13] = b.tu;       pose[PatchPose::T31] = e.tu;
+	pose[PatchPose::T23] = d.tv;       pose[PatchPose::T32] = e.tv;
+	pose[PatchPose::T02] = a.tu;       pose[PatchPose::T20] = d.tu;
+	pose[PatchPose::InnerPoint] = QPointF(0.5f, 0.5f);
+	return pose;
+}
+
+std::array<QVector3D, 4> GradientMesh::colours(unsigned int r, unsigned int c) const
+{
+	return { vertex(r, c).colour, vertex(r, c+1).colour, vertex(r+1, c).colour, vertex(r+1, c+1).colour };
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#include <grid_index_buffer.hpp>
+
+#include <QOpenGLContext>
+
+std::map<GridIndexBuffer::Key, std::weak_ptr<GridIndexBuffer>> GridIndexBuffer::registry_;
+
+std::shared_ptr<GridIndexBuffer> GridIndexBuffer::acquire(unsigned int resolution)
+{
+	QOpenGLContext *context = QOpenGLContext::currentContext();
+	Key key{context, resolution};
+
+	std::shared_ptr<GridIndexBuffer> buffer = registry_[key].lock();
+	if (buffer == nullptr) {
+		buffer = std::shared_ptr<GridIndexBuffer>(new GridIndexBuffer(context, resolution));
+		registry_[key] = buffer;
+	}
+
+	return buffer;
+}
+
+GridIndexBuffer::GridIndexBuffer(QOpenGLContext *context, unsigned int resolution)
+	:context_{context}, resolution_{resolution}, ebo_{QOpenGLBuffer::IndexBuffer}
+{
+	std::vector<GLuint> indices = computeIndices(resolution_);
+	count_ = GLsizei(indices.size());
+
+	ebo_.create();
+	ebo_.setUsagePattern(QOpenGLBuffer::StaticDraw);
+	ebo_.bind();
+	ebo_.allocate(indices.data(), indices.size() * sizeof(GLuint));
+}
+
+std::vector<GLuint> GridIndexBuffer::computeIndices(unsigned int resolution)
+{
+	unsigned int rowSize = resolution + 1;
+
+	std::vector<GLuint> indices;
+	indices.reserve(resolution * (2*rowSize + 1));
+
+	for (unsigned int i = 0; i < resolution; ++i) {
+		if (i > 0)
+			indices.push_back(RestartIndex);
+
+		for (unsigned int j = 0; j < rowSize; ++j) {
+			indices.push_back(i * rowSize + j);
+			indices.push_back((i+1) * rowSize + j);
+		}
+	}
+
+	return indices;
+}
+
+GridIndexBuffer::~GridIndexBuffer()
+{
+	registry_.erase(Key{context_, resolution_});
+	ebo_.destroy();
+}
\ No newline at end of file
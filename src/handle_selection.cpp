@@ -0,0 +1,151 @@
+#include <handle_selection.hpp>
+#include <parallel_for.hpp>
+
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+	// the corner each handle hangs from, by channel
+	const unsigned int Anchor[HandleSelection::Handles] = {
+		PatchPose::P0, PatchPose::P1, PatchPose::P2, PatchPose::P3,
+		PatchPose::P0, PatchPose::P1, PatchPose::P1, PatchPose::P3,
+		PatchPose::P2, PatchPose::P3, PatchPose::P0, PatchPose::P2 };
+}
+
+QPointF HandleSelection::position(const PatchPose &pose, unsigned int channel)
+{
+	return channel <= PatchPose::P3 ? pose[channel] : pose[Anchor[channel]] + pose[channel];
+}
+
+void HandleSelection::select(const Patches &patches, const QRectF &rect, bool extend)
+{
+	if (!extend || patches != patches_) {
+		indices_.clear();
+		patches_ = patches;
+	}
+
+	std::vector<std::uint32_t> found;
+	QRectF area = rect.normalized();
+	for (std::size_t p = 0; p < patches.size(); ++p) {
+		PatchPose pose = patches[p]->pose();
+		unsigned int handles = patches[p]->handlersShown() ? Handles : PatchPose::P3 + 1;
+		for (unsigned int channel = 0; channel < handles; ++channel)
+			if (area.contains(position(pose, channel)))
+				found.push_back(std::uint32_t(p * Handles + channel));
+	}
+
+	// both are sorted
+	std::vector<std::uint32_t> merged;
+	merged.reserve(indices_.size() + found.size());
+	std::set_union(indices_.begin(), indices_.end(), found.begin(), found.end(), std::back_inserter(merged));
+	indices_.swap(merged);
+}
+
+void HandleSelection::clear()
+{
+	end();
+	indices_.clear();
+	patches_.clear();
+}
+
+std::vector<QPointF> HandleSelection::positions() const
+{
+	std::vector<QPointF> result;
+	result.reserve(indices_.size());
+
+	std::size_t last = patches_.size();
+	PatchPose pose;
+	for (std::uint32_t index : indices_) {
+		std::size_t p = index / Handles;
+		if (p != last) {
+			pose = patches_[p]->pose();
+			last = p;
+		}
+		result.push_back(position(pose, index % Handles));
+	}
+	return result;
+}
+
+QPointF HandleSelection::centre() const
+{
+	std::vector<QPointF> points = positions();
+	QPointF sum(0.0, 0.0);
+	for (const QPointF &p : points)
+		sum += p;
+	return points.empty() ? sum : sum / double(points.size());
+}
+
+void HandleSelection::begin()
+{
+	std::size_t count = indices_.size();
+	x0_.resize(count);
+	y0_.resize(count);
+	x_.resize(count);
+	y_.resize(count);
+	groups_.clear();
+
+	for (std::size_t i = 0; i < count; ++i) {
+		std::size_t p = indices_[i] / Handles;
+		if (groups_.empty() || groups_.back().patch != p)
+			groups_.push_back({ p, patches_[p]->pose(), i, i });
+		groups_.back().last = i + 1;
+
+		QPointF at = position(groups_.back().pose, indices_[i] % Handles);
+		x0_[i] = at.x();
+		y0_[i] = at.y();
+	}
+	poses_.resize(groups_.size());
+}
+
+void HandleSelection::transform(const QTransform &m)
+{
+	// one pass over contiguous arrays without branches, which compilers
+	// turn into SIMD code
+	const double m11 = m.m11(), m12 = m.m12(), m21 = m.m21(), m22 = m.m22(), dx = m.dx(), dy = m.dy();
+	const double *x0 = x0_.data(), *y0 = y0_.data();
+	double *x = x_.data(), *y = y_.data();
+	const std::size_t count = x_.size();
+	for (std::size_t i = 0; i < count; ++i) {
+		x[i] = m11 * x0[i] + m21 * y0[i] + dx;
+		y[i] = m12 * x0[i] + m22 * y0[i] + dy;
+	}
+
+	// the new poses, tessellated into the cache on all cores so that
+	// setPose below only uploads
+	parallelFor(groups_.size(), [this](std::size_t begin, std::size_t end) {
+		for (std::size_t g = begin; g < end; ++g) {
+			const Group &group = groups_[g];
+			PatchPose pose = group.pose;
+
+			// corners first, the tangents of moved handles are taken from them
+			for (std::size_t i = group.first; i < group.last; ++i) {
+				unsigned int channel = indices_[i] % Handles;
+				if (channel <= PatchPose::P3)
+					pose[channel] = QPointF(x_[i], y_[i]);
+			}
+			for (std::size_t i = group.first; i < group.last; ++i) {
+				unsigned int channel = indices_[i] % Handles;
+				if (channel > PatchPose::P3)
+					pose[channel] = QPointF(x_[i], y_[i]) - pose[Anchor[channel]];
+			}
+
+			patches_[group.patch]->prepare(pose);
+			poses_[g] = pose;
+		}
+	}, 16);
+
+	// uploads need the GUI context, one patch after the other
+	for (std::size_t g = 0; g < groups_.size(); ++g)
+		patches_[groups_[g].patch]->setPose(poses_[g]);
+}
+
+void HandleSelection::end()
+{
+	groups_.clear();
+	poses_.clear();
+	x0_.clear();
+	y0_.clear();
+	x_.clear();
+	y_.clear();
+}
\ No newline at end of file
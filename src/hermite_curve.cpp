@@ -1,6 +1,7 @@
 #include <hermite_curve.hpp>
 #include <cmath>
 #include <QMouseEvent>
+#include <QDebug>
 
 HermiteCurve::HermiteCurve(std::shared_ptr<FergusonCanvas> canvas)
 	:p0_{QPointF(-0.5,0.0)},    d0_{QPointF( 0.5,  0.5)}, 
@@ -71,18 +72,21 @@ float HermiteCurve::b3(float u3, float u2, float u1) const
 void HermiteCurve::init()
 {
 	initializeOpenGLFunctions();
-	setupShaders();
+	if (!setupShaders())
+		return;
 	setupGeometry();
 }
 
-void HermiteCurve::setupShaders()
+bool HermiteCurve::setupShaders()
 {
-	shader_ = new QOpenGLShaderProgram();
-	shader_->addShaderFromSourceFile(QOpenGLShader::Vertex, "../shaders/ferguson.vs");
-	shader_->addShaderFromSourceFile(QOpenGLShader::Fragment, "../shaders/ferguson.fs");
-	shader_->bindAttributeLocation("pos", 0);
-	shader_->link();
+	// the registry has logged why the program did not build
+	shader_ = ShaderRegistry::acquire("ferguson");
+	if (shader_ == nullptr) {
+		qWarning() << "HermiteCurve: no shader program, the curve is not drawn";
+		return false;
+	}
 	shader_->bind();
+	return true;
 }
 
 void HermiteCurve::setupGeometry()
@@ -108,6 +112,10 @@ QPointF HermiteCurve::toViewportCoordSystem(const QPointF& screenCoords) const
 
 void HermiteCurve::updateGPUBuffers()
 {
+	// nothing was set up without a program
+	if (shader_ == nullptr)
+		return;
+
 	canvas_->makeCurrent();
 	std::vector<float> vertices = computePoints(resolution_);
 	QOpenGLVertexArrayObject::Binder vaoBinder(&vao_);
@@ -120,6 +128,9 @@ void HermiteCurve::updateGPUBuffers()
 
 void HermiteCurve::render()
 {
+	if (shader_ == nullptr)
+		return;
+
 	unsigned int offset = 0;
 	QOpenGLVertexArrayObject::Binder vaoBinder(&vao_);
 	shader_->bind();
@@ -153,8 +164,7 @@ void HermiteCurve::cleanUp()
 		vao_.destroy();		
 		vbo_.destroy();
 
-		delete shader_;
-		shader_ = nullptr;
+		shader_.reset();
 	}
 }
 
@@ -0,0 +1,205 @@
+#include <hermite_spline.hpp>
+#include <parallel_for.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// (2 - sqrt(3))^24 < 1e-13: a C2 tangent this many knots away from an
+	// edit does not move in double precision
+	const std::size_t C2Window = 24;
+}
+
+HermiteSpline::HermiteSpline(Tangents tangents)
+	:tangentMode_{tangents}, changed_{0, 0}
+{ }
+
+HermiteSpline::HermiteSpline(std::vector<QPointF> points, Tangents tangents)
+	:tangentMode_{tangents}, changed_{0, 0}
+{
+	setPoints(std::move(points));
+}
+
+void HermiteSpline::tangentMode(Tangents val)
+{
+	tangentMode_ = val;
+	if (!points_.empty())
+		knotsChanged(0, points_.size() - 1);
+}
+
+void HermiteSpline::setPoints(std::vector<QPointF> points)
+{
+	points_ = std::move(points);
+	tangents_.assign(points_.size(), QPointF(0.f, 0.f));
+	if (!points_.empty())
+		knotsChanged(0, points_.size() - 1);
+}
+
+void HermiteSpline::point(std::size_t i, QPointF val)
+{
+	points_[i] = val;
+	knotsChanged(i, i);
+}
+
+void HermiteSpline::tangent(std::size_t i, QPointF val)
+{
+	tangentMode_ = Tangents::Manual;
+	tangents_[i] = val;
+	segmentsChanged(i > 0 ? i - 1 : 0, std::min(i + 1, segments()));
+}
+
+void HermiteSpline::insertKnot(std::size_t i, QPointF p)
+{
+	points_.insert(points_.begin() + i, p);
+	// a hand set tangent for the new knot follows its neighbours
+	QPointF t = tangentMode_ != Tangents::Manual || points_.size() < 2 ? QPointF(0.f, 0.f) :
+		0.5f * (points_[std::min(i + 1, points_.size() - 1)] - points_[i > 0 ? i - 1 : 0]);
+	tangents_.insert(tangents_.begin() + i, t);
+
+	knotsChanged(i, i);
+	// everything after the knot moves along in a tessellated buffer
+	segmentsChanged(i > 0 ? i - 1 : 0, segments());
+}
+
+void HermiteSpline::removeKnot(std::size_t i)
+{
+	points_.erase(points_.begin() + i);
+	tangents_.erase(tangents_.begin() + i);
+	if (points_.empty()) {
+		markClean();
+		return;
+	}
+
+	std::size_t neighbour = std::min(i, points_.size() - 1);
+	knotsChanged(neighbour > 0 ? neighbour - 1 : 0, neighbour);
+	segmentsChanged(i > 0 ? i - 1 : 0, segments());
+}
+
+CubicCurve HermiteSpline::segment(std::size_t i) const
+{
+	return CubicCurve::fromHermite(points_[i], tangents_[i], points_[i+1], tangents_[i+1]);
+}
+
+QPointF HermiteSpline::evaluate(double t) const
+{
+	if (points_.size() < 2)
+		return points_.empty() ? QPointF(0.f, 0.f) : points_[0];
+
+	t = std::min(std::max(t, 0.0), double(segments()));
+	std::size_t i = std::min(std::size_t(t), segments() - 1);
+	return segment(i).point(float(t - double(i)));
+}
+
+void HermiteSpline::tessellate(unsigned int perSegment, float *out) const
+{
+	tessellate(0, segments(), perSegment, out);
+}
+
+void HermiteSpline::tessellate(std::size_t first, std::size_t last, unsigned int perSegment, float *out) const
+{
+	if (points_.empty())
+		return;
+
+	parallelFor(last - first, [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = first + begin; i < first + end; ++i)
+			segment(i).tessellate(perSegment, out + 2 * i * perSegment, false);
+	}, 1024);
+
+	if (last == segments()) {
+		out[2 * segments() * perSegment]     = float(points_.back().x());
+		out[2 * segments() * perSegment + 1] = float(points_.back().y());
+	}
+}
+
+void HermiteSpline::knotsChanged(std::size_t first, std::size_t last)
+{
+	// tangents within reach of the knots depend on them
+	std::size_t reach = tangentMode_ == Tangents::C2 ? C2Window : tangentMode_ == Tangents::CatmullRom ? 1 : 0;
+	first = first > reach ? first - reach : 0;
+	last = std::min(last + reach, points_.size() - 1);
+
+	updateTangents(first, last);
+	segmentsChanged(first > 0 ? first - 1 : 0, std::min(last + 1, segments()));
+}
+
+void HermiteSpline::segmentsChanged(std::size_t first, std::size_t last)
+{
+	if (first >= last)
+		return;
+
+	if (changed_.first == changed_.second)
+		changed_ = { first, last };
+	else
+		changed_ = { std::min(changed_.first, first), std::max(changed_.second, last) };
+
+	changed_.second = std::min(changed_.second, segments());
+}
+
+void HermiteSpline::updateTangents(std::size_t first, std::size_t last)
+{
+	if (tangentMode_ == Tangents::CatmullRom)
+		catmullRom(first, last);
+	else if (tangentMode_ == Tangents::C2)
+		solveC2(first, last);
+}
+
+void HermiteSpline::catmullRom(std::size_t first, std::size_t last)
+{
+	const std::size_t n = points_.size();
+	for (std::size_t i = first; i <= last; ++i) {
+		const QPointF &previous = points_[i > 0 ? i - 1 : 0];
+		const QPointF &next = points_[std::min(i + 1, n - 1)];
+		// one sided at the ends
+		tangents_[i] = i == 0 || i == n - 1 ? next - previous : 0.5f * (next - previous);
+	}
+}
+
+void HermiteSpline::solveC2(std::size_t first, std::size_t last)
+{
+	const std::size_t n = points_.size();
+	if (n < 2) {
+		tangents_.assign(n, QPointF(0.f, 0.f));
+		return;
+	}
+
+	const std::size_t m = last - first + 1;
+	upper_.resize(m);
+	rhs_.resize(m);
+
+	// forward sweep of the Thomas algorithm; the system is strictly
+	// diagonally dominant, so no pivoting is needed
+	for (std::size_t k = 0; k < m; ++k) {
+		std::size_t i = first + k;
+		double lower, diagonal, upper;
+		QPointF r;
+		if (i == 0) {
+			lower = 0.0; diagonal = 2.0; upper = 1.0;
+			r = 3.f * (points_[1] - points_[0]);
+		} else if (i == n - 1) {
+			lower = 1.0; diagonal = 2.0; upper = 0.0;
+			r = 3.f * (points_[n-1] - points_[n-2]);
+		} else {
+			lower = 1.0; diagonal = 4.0; upper = 1.0;
+			r = 3.f * (points_[i+1] - points_[i-1]);
+		}
+
+		// tangents just outside the window are known
+		if (k == 0 && lower != 0.0) {
+			r -= lower * tangents_[i-1];
+			lower = 0.0;
+		}
+		if (k == m - 1 && upper != 0.0) {
+			r -= upper * tangents_[i+1];
+			upper = 0.0;
+		}
+
+		double pivot = k == 0 ? diagonal : diagonal - lower * upper_[k-1];
+		upper_[k] = upper / pivot;
+		rhs_[k] = k == 0 ? r / pivot : (r - lower * rhs_[k-1]) / pivot;
+	}
+
+	tangents_[last] = rhs_[m-1];
+	for (std::size_t k = m - 1; k-- > 0; )
+		tangents_[first + k] = rhs_[k] - upper_[k] * tangents_[first + k + 1];
+}
\ No newline at end of file
@@ -0,0 +1,206 @@
+#include <image_warper.hpp>
+#include <parallel_for.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+	// interpolates the four 8-bit channels of two pixels at once, two per
+	// 16-bit lane, with weight f/256 on b
+	inline quint32 lerp(quint32 a, quint32 b, quint32 f)
+	{
+		quint32 rb = (((a & 0x00ff00ff) * (256 - f) + (b & 0x00ff00ff) * f) >> 8) & 0x00ff00ff;
+		quint32 ag = (((a >> 8) & 0x00ff00ff) * (256 - f) + ((b >> 8) & 0x00ff00ff) * f) & 0xff00ff00;
+		return rb | ag;
+	}
+
+	const int BandRows = 32;
+}
+
+ImageWarper::ImageWarper(const FergusonGeometry &geometry)
+	:geometry_{geometry}, tolerance_{0.25f}, gridCells_{0}
+{ }
+
+void ImageWarper::buildGrid(QSize source, QSize size, const QRectF &region)
+{
+	// NDC has y up, image rows go down
+	const float sx = float(size.width()) / float(region.width());
+	const float sy = float(size.height()) / float(region.height());
+	const float left = float(region.left());
+	const float top = float(region.top() + region.height());
+
+	auto pixel = [&](float u, float v) {
+		QPointF p = geometry_.s(u, v);
+		return QPointF((float(p.x()) - left) * sx, (top - float(p.y())) * sy);
+	};
+
+	// source column v and row u, pixel centres at the ends
+	const double columns = double(std::max(0, source.width() - 1)) * 65536.0;
+	const double rows = double(std::max(0, source.height() - 1)) * 65536.0;
+
+	for (unsigned int n = 8; ; n *= 2) {
+		const unsigned int side = n + 1;
+		grid_.resize(side * side);
+
+		parallelFor(side, [&](std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i) {
+				float u = float(i) / float(n);
+				for (unsigned int j = 0; j < side; ++j) {
+					float v = float(j) / float(n);
+					QPointF p = pixel(u, v);
+					grid_[i*side + j] = { float(p.x()), float(p.y()),
+						std::int64_t(double(v) * columns), std::int64_t(double(u) * rows) };
+				}
+			}
+		}, 16);
+
+		gridCells_ = n;
+		if (n >= 1024)
+			break;
+
+		// the cell centre against the diagonal the triangles share
+		std::vector<float> rowError(n, 0.f);
+		parallelFor(n, [&](std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i) {
+				for (unsigned int j = 0; j < n; ++j) {
+					const Vertex &a = grid_[i*side + j];
+					const Vertex &c = grid_[(i+1)*side + j + 1];
+					QPointF centre = pixel((float(i) + 0.5f) / float(n), (float(j) + 0.5f) / float(n));
+					float dx = float(centre.x()) - 0.5f * (a.x + c.x);
+					float dy = float(centre.y()) - 0.5f * (a.y + c.y);
+					rowError[i] = std::max(rowError[i], dx*dx + dy*dy);
+				}
+			}
+		}, 16);
+
+		if (*std::max_element(rowError.begin(), rowError.end()) <= tolerance_ * tolerance_)
+			break;
+	}
+}
+
+void ImageWarper::rasterise(const Vertex &a, const Vertex &b, const Vertex &c,
+	const Source &source, const Target &target, int rowBegin, int rowEnd)
+{
+	// source position is affine over the triangle
+	double det = double(b.x - a.x) * (c.y - a.y) - double(c.x - a.x) * (b.y - a.y);
+	if (std::abs(det) < 1e-9)
+		return;
+
+	double sxdx = (double(b.sx - a.sx) * (c.y - a.y) - double(c.sx - a.sx) * (b.y - a.y)) / det;
+	double sxdy = (double(c.sx - a.sx) * (b.x - a.x) - double(b.sx - a.sx) * (c.x - a.x)) / det;
+	double sydx = (double(b.sy - a.sy) * (c.y - a.y) - double(c.sy - a.sy) * (b.y - a.y)) / det;
+	double sydy = (double(c.sy - a.sy) * (b.x - a.x) - double(b.sy - a.sy) * (c.x - a.x)) / det;
+
+	const Vertex *v[3] = { &a, &b, &c };
+	std::sort(v, v + 3, [](const Vertex *p, const Vertex *q) { return p->y < q->y; });
+
+	// rows whose centres lie within the triangle
+	int y0 = std::max(rowBegin, int(std::ceil(v[0]->y - 0.5f)));
+	int y1 = std::min(rowEnd, int(std::ceil(v[2]->y - 0.5f)));
+
+	const int maxX = source.width - 1;
+	const int maxY = source.height - 1;
+	const std::int64_t fixedMaxX = std::int64_t(maxX) << 16;
+	const std::int64_t fixedMaxY = std::int64_t(maxY) << 16;
+	const std::int64_t dsx = std::llround(sxdx);
+	const std::int64_t dsy = std::llround(sydx);
+
+	for (int py = y0; py < y1; ++py) {
+		float yc = float(py) + 0.5f;
+
+		auto cross = [yc](const Vertex *p, const Vertex *q) {
+			float t = q->y > p->y ? (yc - p->y) / (q->y - p->y) : 0.f;
+			return p->x + t * (q->x - p->x);
+		};
+
+		float xa = cross(v[0], v[2]);
+		float xb = yc < v[1]->y ? cross(v[0], v[1]) : cross(v[1], v[2]);
+		int x0 = std::max(0, int(std::ceil(std::min(xa, xb) - 0.5f)));
+		int x1 = std::min(target.width, int(std::ceil(std::max(xa, xb) - 0.5f)));
+		if (x0 >= x1)
+			continue;
+
+		double xc = double(x0) + 0.5;
+		std::int64_t sx = std::llround(double(a.sx) + sxdx * (xc - a.x) + sxdy * (yc - a.y));
+		std::int64_t sy = std::llround(double(a.sy) + sydx * (xc - a.x) + sydy * (yc - a.y));
+
+		// fixed point steps and branchless clamps keep the loop free of calls
+		quint32 *out = target.bits + std::size_t(py) * target.stride;
+		for (int px = x0; px < x1; ++px, sx += dsx, sy += dsy) {
+			std::int64_t cx = std::min(std::max(sx, std::int64_t(0)), fixedMaxX);
+			std::int64_t cy = std::min(std::max(sy, std::int64_t(0)), fixedMaxY);
+			int ix = int(cx >> 16), iy = int(cy >> 16);
+			int jx = std::min(ix + 1, maxX), jy = std::min(iy + 1, maxY);
+			quint32 fx = quint32(cx >> 8) & 0xff, fy = quint32(cy >> 8) & 0xff;
+
+			const quint32 *row0 = source.bits + std::size_t(iy) * source.stride;
+			const quint32 *row1 = source.bits + std::size_t(jy) * source.stride;
+			out[px] = lerp(lerp(row0[ix], row0[jx], fx), lerp(row1[ix], row1[jx], fx), fy);
+		}
+	}
+}
+
+QImage ImageWarper::warp(const QImage &source, QSize size, const QRectF &region)
+{
+	if (source.isNull() || size.isEmpty() || region.isEmpty())
+		return QImage();
+
+	// premultiplied so that transparent pixels do not bleed into the filter
+	const QImage input = source.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+	QImage output(size, QImage::Format_ARGB32_Premultiplied);
+	if (output.isNull())
+		return QImage();
+	output.fill(Qt::transparent);
+
+	buildGrid(input.size(), size, region);
+
+	// detach once here, the bands only write through these pointers
+	Source in = { reinterpret_cast<const quint32*>(input.constBits()),
+		int(input.bytesPerLine() / 4), input.width(), input.height() };
+	Target out = { reinterpret_cast<quint32*>(output.bits()),
+		int(output.bytesPerLine() / 4), output.width(), output.height() };
+
+	// each cell goes to every band its rows overlap
+	const unsigned int n = gridCells_, side = n + 1;
+	const int bands = (size.height() + BandRows - 1) / BandRows;
+	std::vector<std::vector<unsigned int>> cells(bands);
+
+	for (unsigned int i = 0; i < n; ++i) {
+		for (unsigned int j = 0; j < n; ++j) {
+			const Vertex *q[4] = { &grid_[i*side + j], &grid_[i*side + j + 1],
+				&grid_[(i+1)*side + j], &grid_[(i+1)*side + j + 1] };
+			float top = q[0]->y, bottom = q[0]->y;
+			for (const Vertex *p : q) {
+				top = std::min(top, p->y);
+				bottom = std::max(bottom, p->y);
+			}
+
+			int first = std::max(0, int(std::floor(top)) / BandRows);
+			int last = std::min(bands - 1, int(std::ceil(bottom)) / BandRows);
+			for (int band = first; band <= last; ++band)
+				cells[band].push_back(i*side + j);
+		}
+	}
+
+	// bands are dealt out in turn, the patch is rarely spread evenly over the rows
+	const std::size_t lanes = std::max(1u, std::thread::hardware_concurrency());
+	parallelFor(lanes, [&](std::size_t begin, std::size_t end) {
+		for (std::size_t lane = begin; lane < end; ++lane) {
+			for (std::size_t band = lane; band < std::size_t(bands); band += lanes) {
+				int rowBegin = int(band) * BandRows;
+				int rowEnd = std::min(size.height(), rowBegin + BandRows);
+
+				for (unsigned int k : cells[band]) {
+					const Vertex &p00 = grid_[k], &p01 = grid_[k + 1];
+					const Vertex &p10 = grid_[k + side], &p11 = grid_[k + side + 1];
+					rasterise(p00, p01, p11, in, out, rowBegin, rowEnd);
+					rasterise(p00, p11, p10, in, out, rowBegin, rowEnd);
+				}
+			}
+		}
+	});
+
+	return output;
+}
\ No newline at end of file
@@ -0,0 +1,244 @@
+#include <input_recording.hpp>
+#include <renderer.hpp>
+
+#include <QCoreApplication>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <algorithm>
+
+QDataStream &operator<<(QDataStream &out, const RecordedEvent &e)
+{
+	out << e.time << qint32(e.type) << e.pos << qint32(e.button) << qint32(e.buttons)
+	    << qint32(e.key) << e.autoRepeat << e.text << qint32(e.modifiers);
+	return out;
+}
+
+QDataStream &operator>>(QDataStream &in, RecordedEvent &e)
+{
+	qint32 type, button, buttons, key, modifiers;
+	in >> e.time >> type >> e.pos >> button >> buttons >> key >> e.autoRepeat >> e.text >> modifiers;
+	e.type = type;
+	e.button = button;
+	e.buttons = buttons;
+	e.key = key;
+	e.modifiers = modifiers;
+	return in;
+}
+
+// ------------------------------- InputRecorder ------------------------------------------------------
+bool InputRecorder::start(const QString &filename)
+{
+	stop();
+
+	file_.setFileName(filename);
+	if (!file_.open(QIODevice::WriteOnly))
+		return false;
+
+	stream_.setDevice(&file_);
+	stream_.setVersion(QDataStream::Qt_5_0);
+	stream_ << Magic << Version;
+	clock_.start();
+	return true;
+}
+
+void InputRecorder::stop()
+{
+	if (!file_.isOpen())
+		return;
+
+	stream_.setDevice(nullptr);
+	file_.close();
+}
+
+void InputRecorder::record(const QMouseEvent *e)
+{
+	if (!recording())
+		return;
+
+	RecordedEvent r;
+	r.type = e->type();
+	r.pos = e->localPos();
+	r.button = e->button();
+	r.buttons = int(e->buttons());
+	r.modifiers = int(e->modifiers());
+	write(r);
+}
+
+void InputRecorder::record(const QKeyEvent *e)
+{
+	if (!recording())
+		return;
+
+	RecordedEvent r;
+	r.type = e->type();
+	r.key = e->key();
+	r.autoRepeat = e->isAutoRepeat();
+	r.text = e->text();
+	r.modifiers = int(e->modifiers());
+	write(r);
+}
+
+void InputRecorder::write(RecordedEvent &e)
+{
+	e.time = clock_.nsecsElapsed();
+	stream_ << e;
+}
+
+// ------------------------------- InputReplayer ------------------------------------------------------
+QString InputReplayer::Report::toString() const
+{
+	return QString(
+		"events: %1 (%2 repainting), frames: %3, time: %4 s\n"
+		"throughput: %5 events/s, %6 frames/s\n"
+		"event to frame latency: p50 %7 ms, p90 %8 ms, p99 %9 ms, max %10 ms")
+		.arg(events).arg(updates).arg(frames).arg(seconds, 0, 'f', 3)
+		.arg(seconds > 0.0 ? events / seconds : 0.0, 0, 'f', 1)
+		.arg(seconds > 0.0 ? frames / seconds : 0.0, 0, 'f', 1)
+		.arg(p50, 0, 'f', 3).arg(p90, 0, 'f', 3).arg(p99, 0, 'f', 3).arg(max, 0, 'f', 3);
+}
+
+InputReplayer::InputReplayer(Renderer *renderer)
+	:renderer_{renderer}, next_{0}, pace_{Pace::Original}, started_{false}, start_{0}, lastEvent_{0}, frames_{0}
+{
+	timer_.setSingleShot(true);
+	QObject::connect(&timer_, &QTimer::timeout, [this]() { dispatchDue(); });
+	QObject::connect(renderer_, &QOpenGLWidget::frameSwapped, [this]() { frameSwapped(); });
+}
+
+bool InputReplayer::load(const QString &filename)
+{
+	QFile file(filename);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	QDataStream in(&file);
+	in.setVersion(QDataStream::Qt_5_0);
+
+	quint32 magic, version;
+	in >> magic >> version;
+	if (magic != InputRecorder::Magic || version != InputRecorder::Version)
+		return false;
+
+	events_.clear();
+	while (!in.atEnd()) {
+		RecordedEvent e;
+		in >> e;
+		if (in.status() != QDataStream::Ok)
+			return false;
+		events_.push_back(e);
+	}
+
+	return true;
+}
+
+void InputReplayer::start(Pace pace, std::function<void(const Report &)> finished)
+{
+	pace_ = pace;
+	finished_ = finished;
+	next_ = 0;
+	frames_ = 0;
+	pending_.clear();
+	latencies_.clear();
+	started_ = false;
+	timer_.start(0);
+}
+
+void InputReplayer::dispatchDue()
+{
+	if (!started_) {
+		// the canvas has to be initialised before it can take events
+		if (!renderer_->isValid()) {
+			timer_.start(10);
+			return;
+		}
+
+		clock_.start();
+		start_ = clock_.nsecsElapsed();
+		lastEvent_ = start_;
+		started_ = true;
+	}
+
+	qint64 now = clock_.nsecsElapsed();
+
+	if (next_ == events_.size()) {
+		// give the last events a second to reach the screen
+		if (pending_.empty() || now - lastEvent_ > 1000000000)
+			finish();
+		else
+			timer_.start(10);
+		return;
+	}
+
+	if (pace_ == Pace::MaximumRate) {
+		// one event per pass through the event loop, so repaints can interleave
+		dispatch(events_[next_++]);
+		timer_.start(0);
+		return;
+	}
+
+	while (next_ < events_.size() && start_ + events_[next_].time <= now)
+		dispatch(events_[next_++]);
+
+	qint64 wait = next_ < events_.size() ? start_ + events_[next_].time - clock_.nsecsElapsed() : 0;
+	timer_.start(int(std::max<qint64>(0, wait / 1000000)));
+}
+
+void InputReplayer::dispatch(const RecordedEvent &e)
+{
+	unsigned long long updates = renderer_->updateRequests();
+	Qt::KeyboardModifiers modifiers(e.modifiers);
+
+	if (e.type == QEvent::KeyPress || e.type == QEvent::KeyRelease) {
+		QKeyEvent event(QEvent::Type(e.type), e.key, modifiers, e.text, e.autoRepeat);
+		QCoreApplication::sendEvent(renderer_, &event);
+	}
+	else {
+		QMouseEvent event(QEvent::Type(e.type), e.pos, e.pos, renderer_->mapToGlobal(e.pos.toPoint()),
+			Qt::MouseButton(e.button), Qt::MouseButtons(e.buttons), modifiers);
+		QCoreApplication::sendEvent(renderer_, &event);
+	}
+
+	lastEvent_ = clock_.nsecsElapsed();
+
+	// events that change nothing on screen have no latency to measure
+	if (renderer_->updateRequests() != updates)
+		pending_.push_back(lastEvent_);
+}
+
+void InputReplayer::frameSwapped()
+{
+	if (!finished_ || !started_)
+		return;
+
+	++frames_;
+	qint64 now = clock_.nsecsElapsed();
+	for (qint64 t : pending_)
+		latencies_.push_back(now - t);
+	pending_.clear();
+}
+
+void InputReplayer::finish()
+{
+	Report report;
+	report.events = events_.size();
+	report.updates = latencies_.size() + pending_.size();
+	report.frames = frames_;
+	report.seconds = double(lastEvent_ - start_) * 1e-9;
+
+	std::sort(latencies_.begin(), latencies_.end());
+	auto percentile = [this](double p) {
+		if (latencies_.empty())
+			return 0.0;
+		std::size_t rank = std::size_t(p * double(latencies_.size() - 1) + 0.5);
+		return double(latencies_[rank]) * 1e-6;
+	};
+
+	report.p50 = percentile(0.50);
+	report.p90 = percentile(0.90);
+	report.p99 = percentile(0.99);
+	report.max = percentile(1.00);
+
+	std::function<void(const Report &)> finished = finished_;
+	finished_ = nullptr;
+	finished(report);
+}
\ No newline at end of file
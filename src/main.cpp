@@ -1,14 +1,62 @@
 #include <window.hpp>
+#include <input_recording.hpp>
 
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QSurfaceFormat>
+#include <QTextStream>
+#include <algorithm>
+#include <memory>
 
 int main(int argc, char *argv[])
 {
 	QApplication app(argc, argv);
 
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Ferguson patch visualiser");
+	parser.addHelpOption();
+
+	QCommandLineOption recordOption("record", "Record the canvas input into <file>.", "file");
+	QCommandLineOption replayOption("replay", "Replay the input recorded in <file> and report latencies.", "file");
+	QCommandLineOption maxRateOption("max-rate", "Replay as fast as possible instead of at the recorded pace.");
+	QCommandLineOption offscreenOption("offscreen", "Do not show the window while replaying, exporting or benchmarking.");
+	QCommandLineOption samplesOption("samples",
+		"Multisample the window with <n> samples, curves are anti-aliased without it (default 0).", "n", "0");
+	QCommandLineOption exportOption("export", "Render the canvas into the PNG <file> and quit.", "file");
+	QCommandLineOption exportWidthOption("export-width", "Width of the exported image (default 4096).", "pixels", "4096");
+	QCommandLineOption supersampleOption("supersample", "Samples per pixel side when exporting (default 2).", "n", "2");
+	QCommandLineOption warpOption("warp", "Map the image <file> through the patch and quit.", "file");
+	QCommandLineOption warpOutputOption("warp-output", "Where to write the warped image (default warped.png).",
+		"file", "warped.png");
+	QCommandLineOption fitOption("fit", "Show a patch mesh fitted to the image <file>.", "file");
+	QCommandLineOption fitPatchesOption("fit-patches", "Patches per side of the fitted mesh (default 64).", "n", "64");
+	QCommandLineOption fitIterationsOption("fit-iterations", "Iterations of the fit (default 20).", "n", "20");
+	QCommandLineOption svgOption("svg", "Show the mesh gradients of the SVG <file>.", "file");
+	QCommandLineOption watchOption("watch", "Reload the --svg file whenever it changes, updating only what differs.");
+	QCommandLineOption evalBenchmarkOption("eval-benchmark",
+		"Evaluate the patches at <n> random samples on the CPU and the GPU, report the timings and quit.", "n");
+	QCommandLineOption evalDerivativesOption("eval-derivatives", "Also evaluate su and sv in the benchmark.");
+	parser.addOption(recordOption);
+	parser.addOption(replayOption);
+	parser.addOption(maxRateOption);
+	parser.addOption(offscreenOption);
+	parser.addOption(samplesOption);
+	parser.addOption(exportOption);
+	parser.addOption(exportWidthOption);
+	parser.addOption(supersampleOption);
+	parser.addOption(warpOption);
+	parser.addOption(warpOutputOption);
+	parser.addOption(fitOption);
+	parser.addOption(fitPatchesOption);
+	parser.addOption(fitIterationsOption);
+	parser.addOption(svgOption);
+	parser.addOption(watchOption);
+	parser.addOption(evalBenchmarkOption);
+	parser.addOption(evalDerivativesOption);
+	parser.process(app);
+
 	QSurfaceFormat fmt;
-	fmt.setSamples(4);
+	fmt.setSamples(parser.value(samplesOption).toInt());
 	fmt.setDepthBufferSize(24);
 	fmt.setStencilBufferSize(8);
 	fmt.setVersion(3, 2);
@@ -16,6 +64,120 @@ int main(int argc, char *argv[])
 	QSurfaceFormat::setDefaultFormat(fmt);
 
 	Window window;
+
+	// the warp runs on the CPU, the window need not be shown
+	if (parser.isSet(warpOption)) {
+		QString output = parser.value(warpOutputOption);
+		if (!window.renderer()->warpImage(parser.value(warpOption), output)) {
+			QTextStream(stderr) << "cannot warp " << parser.value(warpOption) << " into " << output << Qt::endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	// fitted before the window shows, so --export can write the mesh out
+	if (parser.isSet(fitOption)) {
+		unsigned int patches = unsigned(std::max(1, parser.value(fitPatchesOption).toInt()));
+		unsigned int iterations = unsigned(std::max(0, parser.value(fitIterationsOption).toInt()));
+
+		bool ok = window.renderer()->fitImage(parser.value(fitOption), patches, iterations,
+			[](const MeshFitter::Progress &progress) {
+				QTextStream(stdout) << "iteration " << progress.iteration << ": error " << progress.error
+					<< ", " << progress.solverIterations << " solver iterations" << Qt::endl;
+				return true;
+			});
+		if (!ok) {
+			QTextStream(stderr) << "cannot fit " << parser.value(fitOption) << Qt::endl;
+			return 1;
+		}
+	}
+
+	if (parser.isSet(svgOption)) {
+		QString svg = parser.value(svgOption);
+		bool watch = parser.isSet(watchOption);
+		if (!(watch ? window.renderer()->watchSvg(svg) : window.renderer()->importSvg(svg))) {
+			QTextStream(stderr) << "cannot import " << svg << Qt::endl;
+			return 1;
+		}
+		window.setWatchingSvg(watch);
+	}
+
+	InputRecorder recorder;
+	if (parser.isSet(recordOption)) {
+		if (!recorder.start(parser.value(recordOption))) {
+			QTextStream(stderr) << "cannot record into " << parser.value(recordOption) << Qt::endl;
+			return 1;
+		}
+		window.renderer()->setInputRecorder(&recorder);
+	}
+
+	InputReplayer replayer(window.renderer());
+	if (parser.isSet(replayOption)) {
+		if (!replayer.load(parser.value(replayOption))) {
+			QTextStream(stderr) << "cannot replay " << parser.value(replayOption) << Qt::endl;
+			return 1;
+		}
+
+		// the widget still needs a window and a GL context, just not on screen
+		if (parser.isSet(offscreenOption))
+			window.setAttribute(Qt::WA_DontShowOnScreen);
+
+		InputReplayer::Pace pace = parser.isSet(maxRateOption) ?
+			InputReplayer::Pace::MaximumRate : InputReplayer::Pace::Original;
+
+		replayer.start(pace, [](const InputReplayer::Report &report) {
+			QTextStream(stdout) << report.toString() << Qt::endl;
+			QCoreApplication::quit();
+		});
+	}
+
+	if (parser.isSet(exportOption)) {
+		Renderer *renderer = window.renderer();
+		int width = std::max(1, parser.value(exportWidthOption).toInt());
+		QSize size(width, std::max(1, int(qint64(width) * renderer->height() / renderer->width())));
+		int supersampling = parser.value(supersampleOption).toInt();
+		QString filename = parser.value(exportOption);
+
+		if (parser.isSet(offscreenOption))
+			window.setAttribute(Qt::WA_DontShowOnScreen);
+
+		// export once the canvas has been initialised and drawn
+		auto connection = std::make_shared<QMetaObject::Connection>();
+		*connection = QObject::connect(renderer, &QOpenGLWidget::frameSwapped, [=]() {
+			QObject::disconnect(*connection);
+			bool ok = renderer->exportImage(filename, size, supersampling);
+			if (!ok)
+				QTextStream(stderr) << "cannot export " << filename << Qt::endl;
+			QCoreApplication::exit(ok ? 0 : 1);
+		});
+	}
+
+	if (parser.isSet(evalBenchmarkOption)) {
+		Renderer *renderer = window.renderer();
+		std::size_t samples = std::size_t(std::max(1LL, parser.value(evalBenchmarkOption).toLongLong()));
+		bool derivatives = parser.isSet(evalDerivativesOption);
+
+		if (parser.isSet(offscreenOption))
+			window.setAttribute(Qt::WA_DontShowOnScreen);
+
+		// benchmark once the context has been created
+		auto connection = std::make_shared<QMetaObject::Connection>();
+		*connection = QObject::connect(renderer, &QOpenGLWidget::frameSwapped, [=]() {
+			QObject::disconnect(*connection);
+			GpuEvaluator::Benchmark benchmark = renderer->benchmarkEvaluation(samples, derivatives);
+			if (benchmark.samples == 0) {
+				QTextStream(stderr) << "cannot evaluate on the GPU" << Qt::endl;
+				QCoreApplication::exit(1);
+				return;
+			}
+			QTextStream(stdout) << benchmark.toString() << Qt::endl;
+			QCoreApplication::exit(0);
+		});
+	}
+
 	window.show();
-	return app.exec();
+	int result = app.exec();
+
+	window.renderer()->setInputRecorder(nullptr);
+	return result;
 }
\ No newline at end of file
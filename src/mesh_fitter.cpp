@@ -0,0 +1,492 @@
+#include <mesh_fitter.hpp>
+#include <parallel_for.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	const unsigned int Unknowns = 9;
+	const unsigned int PatchUnknowns = 4 * Unknowns;
+
+	// offsets within the unknowns of a vertex
+	enum { Position = 0, TangentU = 2, TangentV = 4, Colour = 6 };
+
+	void hermite(double t, double b[4])
+	{
+		double t2 = t*t;
+		double t3 = t2*t;
+		b[0] = 2.0*t3 - 3.0*t2 + 1.0;
+		b[1] = t3 - 2.0*t2 + t;
+		b[2] = t3 - t2;
+		b[3] = -2.0*t3 + 3.0*t2;
+	}
+}
+
+MeshFitter::MeshFitter(const QImage &image)
+	:image_{image.convertToFormat(QImage::Format_RGB32)}, samples_{8}, smoothness_{0.002},
+	scale_{0}, width_{0}, height_{0}, rows_{0}, columns_{0}
+{ }
+
+void MeshFitter::prepare(unsigned int rows, unsigned int columns)
+{
+	const int spacingX = image_.width() / int(std::max(1u, columns * samples_));
+	const int spacingY = image_.height() / int(std::max(1u, rows * samples_));
+	const int scale = std::max(1, std::min(spacingX, spacingY));
+	if (scale == scale_)
+		return;
+
+	scale_ = scale;
+	width_ = std::max(1, image_.width() / scale);
+	height_ = std::max(1, image_.height() / scale);
+	for (std::vector<float> &plane : planes_)
+		plane.assign(std::size_t(width_) * height_, 0.f);
+
+	const float norm = 1.f / (255.f * float(scale * scale));
+	parallelFor(height_, [&](std::size_t begin, std::size_t end) {
+		for (std::size_t y = begin; y < end; ++y) {
+			for (int sy = 0; sy < scale; ++sy) {
+				const QRgb *line = reinterpret_cast<const QRgb *>(image_.constScanLine(int(y) * scale + sy));
+				for (int x = 0; x < width_; ++x) {
+					for (int sx = 0; sx < scale; ++sx) {
+						QRgb pixel = line[x * scale + sx];
+						planes_[0][y*width_ + x] += float(qRed(pixel));
+						planes_[1][y*width_ + x] += float(qGreen(pixel));
+						planes_[2][y*width_ + x] += float(qBlue(pixel));
+					}
+				}
+			}
+			for (std::vector<float> &plane : planes_)
+				for (int x = 0; x < width_; ++x)
+					plane[y*width_ + x] *= norm;
+		}
+	}, 16);
+}
+
+MeshFitter::Sample MeshFitter::sample(double x, double y) const
+{
+	// filtered pixel centres sit at (i + 0.5) * scale_
+	double fx = std::min(std::max(x / scale_ - 0.5, 0.0), double(width_ - 1));
+	double fy = std::min(std::max(y / scale_ - 0.5, 0.0), double(height_ - 1));
+	int x0 = std::min(int(fx), std::max(0, width_ - 2));
+	int y0 = std::min(int(fy), std::max(0, height_ - 2));
+	int x1 = std::min(x0 + 1, width_ - 1);
+	int y1 = std::min(y0 + 1, height_ - 1);
+	double ax = fx - x0;
+	double ay = fy - y0;
+
+	// the derivative is zero where the position was clamped
+	bool insideX = x / scale_ - 0.5 == fx;
+	bool insideY = y / scale_ - 0.5 == fy;
+
+	Sample s;
+	for (unsigned int k = 0; k < 3; ++k) {
+		const std::vector<float> &plane = planes_[k];
+		double i00 = plane[y0*width_ + x0], i01 = plane[y0*width_ + x1];
+		double i10 = plane[y1*width_ + x0], i11 = plane[y1*width_ + x1];
+
+		double top = i00 + ax * (i01 - i00);
+		double bottom = i10 + ax * (i11 - i10);
+		s.value[k] = top + ay * (bottom - top);
+		s.dx[k] = insideX ? ((1.0 - ay) * (i01 - i00) + ay * (i11 - i10)) / scale_ : 0.0;
+		s.dy[k] = insideY ? (bottom - top) / scale_ : 0.0;
+	}
+	return s;
+}
+
+double MeshFitter::patchEnergy(const std::vector<double> &x, unsigned int r, unsigned int c,
+	double *hessian, double *gradient) const
+{
+	// corners p0, p1, p2, p3 at (u,v) = (0,0), (0,1), (1,0), (1,1)
+	const double *corner[4] = {
+		&x[(r*(columns_+1) + c) * Unknowns],
+		&x[(r*(columns_+1) + c + 1) * Unknowns],
+		&x[((r+1)*(columns_+1) + c) * Unknowns],
+		&x[((r+1)*(columns_+1) + c + 1) * Unknowns]
+	};
+
+	if (hessian) {
+		std::fill(hessian, hessian + PatchUnknowns * PatchUnknowns, 0.0);
+		std::fill(gradient, gradient + PatchUnknowns, 0.0);
+	}
+
+	const double weight = 1.0 / double(samples_ * samples_);
+	double energy = 0.0;
+
+	for (unsigned int i = 0; i < samples_; ++i) {
+		double u = (double(i) + 0.5) / samples_;
+		double bu[4];
+		hermite(u, bu);
+
+		for (unsigned int j = 0; j < samples_; ++j) {
+			double v = (double(j) + 0.5) / samples_;
+			double bv[4];
+			hermite(v, bv);
+
+			// weights of the position and tangents of each corner in s(u,v),
+			// and of its colour in c(u,v)
+			double w[4][3], wc[4];
+			for (unsigned int q = 0; q < 4; ++q) {
+				unsigned int cu = q >> 1, cv = q & 1;
+				double hu = cu ? bu[3] : bu[0], du = cu ? bu[2] : bu[1];
+				double hv = cv ? bv[3] : bv[0], dv = cv ? bv[2] : bv[1];
+				w[q][0] = hu * hv;
+				w[q][1] = du * hv;
+				w[q][2] = hu * dv;
+				wc[q] = (cu ? u : 1.0 - u) * (cv ? v : 1.0 - v);
+			}
+
+			double px = 0.0, py = 0.0, colour[3] = { 0.0, 0.0, 0.0 };
+			for (unsigned int q = 0; q < 4; ++q) {
+				for (unsigned int t = 0; t < 3; ++t) {
+					px += w[q][t] * corner[q][2*t];
+					py += w[q][t] * corner[q][2*t + 1];
+				}
+				for (unsigned int k = 0; k < 3; ++k)
+					colour[k] += wc[q] * corner[q][Colour + k];
+			}
+
+			Sample s = sample(px, py);
+			double residual[3];
+			for (unsigned int k = 0; k < 3; ++k) {
+				residual[k] = colour[k] - s.value[k];
+				energy += weight * residual[k] * residual[k];
+			}
+
+			if (!hessian)
+				continue;
+
+			// residual k has derivative -dI_k/dx w along x for every
+			// geometric weight w, and wc along colour k of each corner
+			double mxx = 0.0, mxy = 0.0, myy = 0.0, gx = 0.0, gy = 0.0;
+			for (unsigned int k = 0; k < 3; ++k) {
+				mxx += s.dx[k] * s.dx[k];
+				mxy += s.dx[k] * s.dy[k];
+				myy += s.dy[k] * s.dy[k];
+				gx += s.dx[k] * residual[k];
+				gy += s.dy[k] * residual[k];
+			}
+
+			for (unsigned int a = 0; a < 12; ++a) {
+				unsigned int ia = (a / 3) * Unknowns + 2 * (a % 3);
+				double wa = weight * w[a / 3][a % 3];
+
+				gradient[ia]     -= wa * gx;
+				gradient[ia + 1] -= wa * gy;
+
+				for (unsigned int b = 0; b < 12; ++b) {
+					unsigned int ib = (b / 3) * Unknowns + 2 * (b % 3);
+					double wab = wa * w[b / 3][b % 3];
+					hessian[ia*PatchUnknowns + ib]           += wab * mxx;
+					hessian[ia*PatchUnknowns + ib + 1]       += wab * mxy;
+					hessian[(ia+1)*PatchUnknowns + ib]       += wab * mxy;
+					hessian[(ia+1)*PatchUnknowns + ib + 1]   += wab * myy;
+				}
+
+				for (unsigned int q = 0; q < 4; ++q)
+					for (unsigned int k = 0; k < 3; ++k) {
+						unsigned int ic = q * Unknowns + Colour + k;
+						double h = wa * wc[q];
+						hessian[ia*PatchUnknowns + ic]     -= h * s.dx[k];
+						hessian[(ia+1)*PatchUnknowns + ic] -= h * s.dy[k];
+						hessian[ic*PatchUnknowns + ia]     -= h * s.dx[k];
+						hessian[ic*PatchUnknowns + ia + 1] -= h * s.dy[k];
+					}
+			}
+
+			for (unsigned int q = 0; q < 4; ++q)
+				for (unsigned int k = 0; k < 3; ++k) {
+					unsigned int iq = q * Unknowns + Colour + k;
+					gradient[iq] += weight * wc[q] * residual[k];
+					for (unsigned int p = 0; p < 4; ++p)
+						hessian[iq*PatchUnknowns + p * Unknowns + Colour + k] += weight * wc[q] * wc[p];
+				}
+		}
+	}
+
+	return energy;
+}
+
+double MeshFitter::smoothingEnergy(const std::vector<double> &x, bool assembling)
+{
+	// Along every edge pq, with tangents tp and tq in its direction and h
+	// its length in the straight grid:
+	//
+	//     smoothness / h^2 (|q - p|^2 + |tp - (q - p)|^2 + |tq - (q - p)|^2)
+	//
+	// The first term spreads the vertices out evenly between the fixed
+	// boundary, the others keep the edges from bulging or looping.
+	const double hu = double(image_.height()) / rows_;
+	const double hv = double(image_.width()) / columns_;
+
+	double energy = 0.0;
+
+	auto edge = [&](unsigned int p, unsigned int q, unsigned int tangent, double h) {
+		const double weight = smoothness_ / (h * h);
+		const double *xp = &x[p * Unknowns], *xq = &x[q * Unknowns];
+
+		for (unsigned int d = 0; d < 2; ++d) {
+			double chord = xq[Position + d] - xp[Position + d];
+			double rp = xp[tangent + d] - chord;
+			double rq = xq[tangent + d] - chord;
+			energy += weight * (chord * chord + rp * rp + rq * rq);
+
+			if (!assembling)
+				continue;
+
+			// each residual is linear in (p, tp, q, tq) along d
+			const unsigned int vertex[4] = { p, p, q, q };
+			const unsigned int component[4] = { Position + d, tangent + d, Position + d, tangent + d };
+			const double terms[3][5] = {
+				{ -1.0, 0.0, 1.0, 0.0, chord },
+				{ 1.0, 1.0, -1.0, 0.0, rp },
+				{ 1.0, 0.0, -1.0, 1.0, rq }
+			};
+
+			for (const double *term : terms)
+				for (unsigned int a = 0; a < 4; ++a) {
+					if (term[a] == 0.0)
+						continue;
+					gradient_[vertex[a] * Unknowns + component[a]] += weight * term[a] * term[4];
+					for (unsigned int b = 0; b < 4; ++b)
+						if (term[b] != 0.0)
+							normal_.block(vertex[a], vertex[b])[component[a] * Unknowns + component[b]] += weight * term[a] * term[b];
+				}
+		}
+	};
+
+	for (unsigned int r = 0; r <= rows_; ++r)
+		for (unsigned int c = 0; c <= columns_; ++c) {
+			unsigned int p = r * (columns_+1) + c;
+			if (c < columns_)
+				edge(p, p + 1, TangentV, hv);
+			if (r < rows_)
+				edge(p, p + columns_ + 1, TangentU, hu);
+		}
+
+	return energy;
+}
+
+double MeshFitter::energy(const std::vector<double> &x, double &error)
+{
+	std::vector<double> energies(rows_ * columns_);
+	parallelFor(energies.size(), [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; ++i)
+			energies[i] = patchEnergy(x, i / columns_, i % columns_, nullptr, nullptr);
+	}, 4);
+
+	double colour = 0.0;
+	for (double e : energies)
+		colour += e;
+
+	error = std::sqrt(colour / (3.0 * energies.size()));
+	return colour + smoothingEnergy(x, false);
+}
+
+double MeshFitter::assemble(const std::vector<double> &x, double &error)
+{
+	normal_.setZero();
+	gradient_.assign(x.size(), 0.0);
+
+	std::vector<double> energies(rows_ * columns_);
+
+	// patches with the same row and column parity share no vertex, so
+	// each of the four classes can be added to normal_ in parallel
+	for (unsigned int parity = 0; parity < 4; ++parity) {
+		const unsigned int r0 = parity >> 1, c0 = parity & 1;
+		const unsigned int rows = (rows_ - r0 + 1) / 2, columns = (columns_ - c0 + 1) / 2;
+
+		parallelFor(rows * columns, [&](std::size_t begin, std::size_t end) {
+			std::vector<double> hessian(PatchUnknowns * PatchUnknowns), gradient(PatchUnknowns);
+
+			for (std::size_t i = begin; i < end; ++i) {
+				unsigned int r = r0 + 2 * unsigned(i / columns), c = c0 + 2 * unsigned(i % columns);
+				energies[r * columns_ + c] = patchEnergy(x, r, c, hessian.data(), gradient.data());
+
+				const unsigned int vertex[4] = {
+					r*(columns_+1) + c, r*(columns_+1) + c + 1,
+					(r+1)*(columns_+1) + c, (r+1)*(columns_+1) + c + 1
+				};
+
+				for (unsigned int a = 0; a < 4; ++a) {
+					for (unsigned int k = 0; k < Unknowns; ++k)
+						gradient_[vertex[a] * Unknowns + k] += gradient[a * Unknowns + k];
+
+					for (unsigned int b = 0; b < 4; ++b) {
+						auto &block = normal_.block(vertex[a], vertex[b]);
+						for (unsigned int k = 0; k < Unknowns; ++k)
+							for (unsigned int l = 0; l < Unknowns; ++l)
+								block[k * Unknowns + l] += hessian[(a * Unknowns + k) * PatchUnknowns + b * Unknowns + l];
+					}
+				}
+			}
+		}, 4);
+	}
+
+	double colour = 0.0;
+	for (double e : energies)
+		colour += e;
+
+	error = std::sqrt(colour / (3.0 * energies.size()));
+	return colour + smoothingEnergy(x, true);
+}
+
+void MeshFitter::toUnknowns(const GradientMesh &mesh, std::vector<double> &x) const
+{
+	// NDC has y up, image rows go down
+	const double sx = 0.5 * image_.width(), sy = -0.5 * image_.height();
+
+	x.resize(mesh.vertices().size() * Unknowns);
+	for (std::size_t i = 0; i < mesh.vertices().size(); ++i) {
+		const GradientMesh::Vertex &vertex = mesh.vertices()[i];
+		double *xi = &x[i * Unknowns];
+		xi[Position]     = (vertex.position.x() + 1.0) * sx;
+		xi[Position + 1] = (vertex.position.y() - 1.0) * sy;
+		xi[TangentU]     = vertex.tu.x() * sx;
+		xi[TangentU + 1] = vertex.tu.y() * sy;
+		xi[TangentV]     = vertex.tv.x() * sx;
+		xi[TangentV + 1] = vertex.tv.y() * sy;
+		for (unsigned int k = 0; k < 3; ++k)
+			xi[Colour + k] = vertex.colour[k];
+	}
+}
+
+void MeshFitter::fromUnknowns(const std::vector<double> &x, GradientMesh &mesh) const
+{
+	const double sx = 0.5 * image_.width(), sy = -0.5 * image_.height();
+
+	for (std::size_t i = 0; i < mesh.vertices().size(); ++i) {
+		GradientMesh::Vertex &vertex = mesh.vertices()[i];
+		const double *xi = &x[i * Unknowns];
+		vertex.position = QPointF(xi[Position] / sx - 1.0, xi[Position + 1] / sy + 1.0);
+		vertex.tu = QPointF(xi[TangentU] / sx, xi[TangentU + 1] / sy);
+		vertex.tv = QPointF(xi[TangentV] / sx, xi[TangentV + 1] / sy);
+		vertex.colour = QVector3D(
+			float(std::min(std::max(xi[Colour], 0.0), 1.0)),
+			float(std::min(std::max(xi[Colour + 1], 0.0), 1.0)),
+			float(std::min(std::max(xi[Colour + 2], 0.0), 1.0)));
+	}
+}
+
+GradientMesh MeshFitter::initialMesh(unsigned int rows, unsigned int columns)
+{
+	prepare(rows, columns);
+
+	GradientMesh mesh = GradientMesh::grid(rows, columns, QRectF(-1.f, -1.f, 2.f, 2.f));
+	const double sx = 0.5 * image_.width(), sy = -0.5 * image_.height();
+
+	for (GradientMesh::Vertex &vertex : mesh.vertices()) {
+		Sample s = sample((vertex.position.x() + 1.0) * sx, (vertex.position.y() - 1.0) * sy);
+		vertex.colour = QVector3D(float(s.value[0]), float(s.value[1]), float(s.value[2]));
+	}
+
+	return mesh;
+}
+
+double MeshFitter::fit(GradientMesh &mesh, unsigned int iterations)
+{
+	rows_ = mesh.rows();
+	columns_ = mesh.columns();
+	prepare(rows_, columns_);
+
+	// every vertex is coupled to those it shares a patch with
+	const unsigned int vertices = (rows_+1) * (columns_+1);
+	std::vector<std::vector<std::size_t>> pattern(vertices);
+	for (unsigned int r = 0; r <= rows_; ++r)
+		for (unsigned int c = 0; c <= columns_; ++c)
+			for (unsigned int nr = r > 0 ? r-1 : 0; nr <= std::min(r+1, rows_); ++nr)
+				for (unsigned int nc = c > 0 ? c-1 : 0; nc <= std::min(c+1, columns_); ++nc)
+					pattern[r*(columns_+1) + c].push_back(nr*(columns_+1) + nc);
+	normal_.setPattern(pattern);
+
+	// Corners stay put, other boundary vertices slide along their side
+	// with the tangent along it parallel to it, so that the boundary
+	// curves stay on the image border. Components are offsets into the
+	// unknowns of a vertex.
+	std::vector<std::pair<unsigned int, unsigned int>> fixed;
+	for (unsigned int r = 0; r <= rows_; ++r)
+		for (unsigned int c = 0; c <= columns_; ++c) {
+			unsigned int i = r*(columns_+1) + c;
+			if (r == 0 || r == rows_) {
+				fixed.emplace_back(i, Position + 1);
+				fixed.emplace_back(i, TangentV + 1);
+			}
+			if (c == 0 || c == columns_) {
+				fixed.emplace_back(i, Position);
+				fixed.emplace_back(i, TangentU);
+			}
+		}
+
+	std::vector<double> x, step, trial;
+	toUnknowns(mesh, x);
+
+	// no step moves a vertex or tangent by more than this many pixels
+	const double reach = 0.25 * std::min(double(image_.width()) / columns_, double(image_.height()) / rows_);
+
+	double damping = 1e-3;
+	double error = 0.0;
+	double current = energy(x, error);
+
+	for (unsigned int iteration = 0; iteration < iterations; ++iteration) {
+		current = assemble(x, error);
+
+		std::vector<BlockSparseMatrix<9>::Block> diagonals(vertices);
+		for (unsigned int i = 0; i < vertices; ++i)
+			diagonals[i] = normal_.diagonal(i);
+		for (const auto &f : fixed)
+			gradient_[f.first * Unknowns + f.second] = 0.0;
+
+		std::vector<double> rhs(gradient_.size());
+		for (std::size_t i = 0; i < rhs.size(); ++i)
+			rhs[i] = -gradient_[i];
+
+		bool accepted = false;
+		unsigned int solverIterations = 0;
+		double trialError = error;
+
+		for (unsigned int attempt = 0; attempt < 10 && !accepted; ++attempt) {
+			// Levenberg-Marquardt: scale the diagonal by 1 + damping
+			for (unsigned int i = 0; i < vertices; ++i) {
+				auto &block = normal_.diagonal(i);
+				block = diagonals[i];
+				for (unsigned int k = 0; k < Unknowns; ++k)
+					block[k * Unknowns + k] += damping * block[k * Unknowns + k] + 1e-9;
+			}
+			for (const auto &f : fixed)
+				normal_.constrain(f.first, f.second);
+
+			step.assign(x.size(), 0.0);
+			solverIterations = normal_.solve(rhs, step, 200, 1e-4);
+
+			double longest = 0.0;
+			for (std::size_t i = 0; i < step.size(); i += Unknowns)
+				for (unsigned int k = 0; k < Colour; ++k)
+					longest = std::max(longest, std::abs(step[i + k]));
+			double limit = longest > reach ? reach / longest : 1.0;
+
+			trial.resize(x.size());
+			for (std::size_t i = 0; i < x.size(); ++i)
+				trial[i] = x[i] + limit * step[i];
+
+			double next = energy(trial, trialError);
+			if (next < current) {
+				x.swap(trial);
+				current = next;
+				damping = std::max(damping / 3.0, 1e-7);
+				accepted = true;
+			}
+			else
+				damping *= 4.0;
+		}
+
+		if (!accepted)
+			break;
+
+		error = trialError;
+		if (progress_ && !progress_({ iteration + 1, error, solverIterations }))
+			break;
+	}
+
+	fromUnknowns(x, mesh);
+	return error;
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include <patch_animation.hpp>
+#include <ferguson_geometry.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// ------------------------------- Track --------------------------------------------------------------
+void Track::setKey(float time, QPointF value)
+{
+	auto it = std::lower_bound(keys_.begin(), keys_.end(), time,
+		[](const Key &key, float t) { return key.time < t; });
+
+	if (it != keys_.end() && it->time == time)
+		it->value = value;
+	else
+		keys_.insert(it, { time, value });
+}
+
+bool Track::removeKey(float time)
+{
+	auto it = std::find_if(keys_.begin(), keys_.end(),
+		[time](const Key &key) { return key.time == time; });
+	if (it == keys_.end())
+		return false;
+
+	keys_.erase(it);
+	return true;
+}
+
+QPointF Track::tangent(std::size_t k) const
+{
+	// one sided differences at the ends
+	std::size_t a = k > 0 ? k - 1 : k;
+	std::size_t b = k + 1 < keys_.size() ? k + 1 : k;
+	float dt = keys_[b].time - keys_[a].time;
+	return dt > 0.f ? (keys_[b].value - keys_[a].value) / dt : QPointF();
+}
+
+QPointF Track::value(float time) const
+{
+	if (keys_.empty())
+		return QPointF();
+	if (time <= keys_.front().time)
+		return keys_.front().value;
+	if (time >= keys_.back().time)
+		return keys_.back().value;
+
+	auto it = std::upper_bound(keys_.begin(), keys_.end(), time,
+		[](float t, const Key &key) { return t < key.time; });
+	std::size_t k = std::size_t(it - keys_.begin()) - 1;
+
+	// tangents are per second, the segment is parameterised over [0, 1]
+	const Key &a = keys_[k], &b = keys_[k+1];
+	float span = b.time - a.time;
+	CubicCurve segment = CubicCurve::fromHermite(a.value, span * tangent(k), b.value, span * tangent(k+1));
+	return segment.point((time - a.time) / span);
+}
+
+// ------------------------------- PatchAnimation -----------------------------------------------------
+void PatchAnimation::setKeys(float time, const PatchPose &pose)
+{
+	for (unsigned int c = 0; c < PatchPose::Channels; ++c)
+		tracks_[c].setKey(time, pose[c]);
+}
+
+void PatchAnimation::removeKeys(float time)
+{
+	for (Track &track : tracks_)
+		track.removeKey(time);
+}
+
+void PatchAnimation::clear()
+{
+	for (Track &track : tracks_)
+		track.clear();
+}
+
+bool PatchAnimation::empty() const
+{
+	return std::all_of(tracks_.begin(), tracks_.end(), [](const Track &track) { return track.empty(); });
+}
+
+float PatchAnimation::duration() const
+{
+	float duration = 0.f;
+	for (const Track &track : tracks_)
+		if (!track.empty())
+			duration = std::max(duration, track.keys().back().time);
+	return duration;
+}
+
+PatchPose PatchAnimation::evaluate(float time, const PatchPose &rest) const
+{
+	PatchPose pose = rest;
+	for (unsigned int c = 0; c < PatchPose::Channels; ++c)
+		if (!tracks_[c].empty())
+			pose[c] = tracks_[c].value(time);
+	return pose;
+}
+
+// ------------------------------- PlaybackClock ------------------------------------------------------
+PlaybackClock::PlaybackClock()
+	:origin_{0.f}, duration_{0.f}, looping_{true}, playing_{false}
+{ }
+
+void PlaybackClock::play()
+{
+	if (playing_)
+		return;
+
+	// playing from the end starts over
+	if (duration_ > 0.f && origin_ >= duration_)
+		origin_ = 0.f;
+
+	timer_.start();
+	playing_ = true;
+}
+
+void PlaybackClock::pause()
+{
+	origin_ = time();
+	playing_ = false;
+}
+
+void PlaybackClock::seek(float time)
+{
+	origin_ = std::max(0.f, time);
+	if (playing_)
+		timer_.start();
+}
+
+float PlaybackClock::time() const
+{
+	if (!playing_)
+		return origin_;
+
+	float t = origin_ + float(timer_.nsecsElapsed()) * 1e-9f;
+	if (duration_ <= 0.f)
+		return t;
+
+	return looping_ ? std::fmod(t, duration_) : std::min(t, duration_);
+}
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include <png_stream_writer.hpp>
+
+#include <cstring>
+
+namespace {
+
+void putBigEndian(unsigned char *out, quint32 value)
+{
+	out[0] = (value >> 24) & 0xFF;
+	out[1] = (value >> 16) & 0xFF;
+	out[2] = (value >> 8) & 0xFF;
+	out[3] = value & 0xFF;
+}
+
+}
+
+PngStreamWriter::PngStreamWriter()
+	:deflating_{false}, width_{0}, height_{0}, rowsWritten_{0}
+{
+	std::memset(&stream_, 0, sizeof(stream_));
+}
+
+PngStreamWriter::~PngStreamWriter()
+{
+	if (deflating_)
+		deflateEnd(&stream_);
+}
+
+bool PngStreamWriter::open(const QString &filename, int width, int height)
+{
+	if (width <= 0 || height <= 0)
+		return false;
+
+	file_.setFileName(filename);
+	if (!file_.open(QIODevice::WriteOnly))
+		return false;
+
+	width_ = width;
+	height_ = height;
+	rowsWritten_ = 0;
+
+	const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	if (file_.write(reinterpret_cast<const char*>(signature), 8) != 8)
+		return false;
+
+	// 8 bit truecolour, default compression and filter, no interlacing
+	unsigned char header[13] = {};
+	putBigEndian(header, quint32(width_));
+	putBigEndian(header + 4, quint32(height_));
+	header[8] = 8;
+	header[9] = 2;
+	if (!writeChunk("IHDR", header, 13))
+		return false;
+
+	if (deflateInit(&stream_, Z_DEFAULT_COMPRESSION) != Z_OK)
+		return false;
+	deflating_ = true;
+
+	row_.resize(1 + 3 * std::size_t(width_));
+	out_.resize(1 << 16);
+	return true;
+}
+
+bool PngStreamWriter::writeRows(const unsigned char *rgb, int rows)
+{
+	if (!deflating_ || rowsWritten_ + rows > height_)
+		return false;
+
+	std::size_t rowBytes = 3 * std::size_t(width_);
+	for (int i = 0; i < rows; ++i) {
+		// every scanline starts with its filter type, none here
+		row_[0] = 0;
+		std::memcpy(&row_[1], rgb + i * rowBytes, rowBytes);
+
+		stream_.next_in = row_.data();
+		stream_.avail_in = uInt(row_.size());
+		if (!deflate(Z_NO_FLUSH))
+			return false;
+	}
+
+	rowsWritten_ += rows;
+	return true;
+}
+
+bool PngStreamWriter::close()
+{
+	if (!deflating_)
+		return false;
+
+	bool ok = rowsWritten_ == height_ && deflate(Z_FINISH);
+	deflateEnd(&stream_);
+	deflating_ = false;
+
+	ok = ok && writeChunk("IEND", nullptr, 0);
+	file_.close();
+	return ok;
+}
+
+bool PngStreamWriter::deflate(int flush)
+{
+	// every time the output buffer fills up it becomes one IDAT chunk
+	for (;;) {
+		stream_.next_out = out_.data();
+		stream_.avail_out = uInt(out_.size());
+
+		int result = ::deflate(&stream_, flush);
+		if (result == Z_STREAM_ERROR)
+			return false;
+
+		quint32 produced = quint32(out_.size() - stream_.avail_out);
+		if (produced > 0 && !writeChunk("IDAT", out_.data(), produced))
+			return false;
+
+		if (flush == Z_FINISH ? result == Z_STREAM_END : stream_.avail_out != 0)
+			return true;
+	}
+}
+
+bool PngStreamWriter::writeChunk(const char *type, const unsigned char *data, quint32 size)
+{
+	unsigned char length[4];
+	putBigEndian(length, size);
+
+	uLong crc = crc32(0L, reinterpret_cast<const Bytef*>(type), 4);
+	if (size > 0)
+		crc = crc32(crc, data, size);
+
+	unsigned char checksum[4];
+	putBigEndian(checksum, quint32(crc));
+
+	return file_.write(reinterpret_cast<const char*>(length), 4) == 4
+		&& file_.write(type, 4) == 4
+		&& (size == 0 || file_.write(reinterpret_cast<const char*>(data), size) == qint64(size))
+		&& file_.write(reinterpret_cast<const char*>(checksum), 4) == 4;
+}
\ No newline at end of file
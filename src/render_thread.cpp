@@ -0,0 +1,137 @@
+#include <render_thread.hpp>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+
+RenderThread::RenderThread(QOpenGLContext *shareContext, QSize size, int samples, int interval)
+	:size_{size}, samples_{samples}, interval_{interval},
+	 gl_{nullptr}, multisampled_{nullptr}, hasFrame_{false}, running_{true}
+{
+	// surfaces can only be created on the GUI thread
+	surface_ = new QOffscreenSurface();
+	surface_->setFormat(shareContext->format());
+	surface_->create();
+
+	context_ = new QOpenGLContext();
+	context_->setFormat(shareContext->format());
+	context_->setShareContext(shareContext);
+	context_->create();
+	context_->moveToThread(this);
+}
+
+RenderThread::~RenderThread()
+{
+	stop();
+	delete context_;
+	delete surface_;
+}
+
+RenderedFrame *RenderThread::acquireFrame()
+{
+	if (frames_.update())
+		hasFrame_ = true;
+
+	return hasFrame_ ? &frames_.front() : nullptr;
+}
+
+void RenderThread::stop()
+{
+	running_ = false;
+	wait();
+}
+
+void RenderThread::run()
+{
+	context_->makeCurrent(surface_);
+	setup();
+
+	// one frame per interval at most, however many snapshots arrive meanwhile
+	QElapsedTimer clock;
+	clock.start();
+	qint64 next = 0;
+
+	while (running_) {
+		if (snapshots_.update()) {
+			renderSnapshot(snapshots_.front(), frames_.back());
+			frames_.publish();
+			if (frameReady_)
+				frameReady_();
+		}
+
+		next += interval_;
+		qint64 remaining = next - clock.elapsed();
+		if (remaining > 0)
+			msleep(static_cast<unsigned long>(remaining));
+		else
+			next = clock.elapsed();
+	}
+
+	cleanUp();
+	context_->doneCurrent();
+	context_->moveToThread(QCoreApplication::instance()->thread());
+}
+
+void RenderThread::setup()
+{
+	gl_ = context_->versionFunctions<QOpenGLFunctions_3_2_Core>();
+	gl_->initializeOpenGLFunctions();
+
+	painter_.init();
+
+	if (samples_ > 0) {
+		QOpenGLFramebufferObjectFormat format;
+		format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+		format.setSamples(samples_);
+		multisampled_ = new QOpenGLFramebufferObject(size_, format);
+	}
+}
+
+void RenderThread::renderSnapshot(const SceneSnapshot &scene, RenderedFrame &frame)
+{
+	// the GUI thread may still be sampling this slot's texture
+	if (frame.consumed != nullptr) {
+		gl_->glWaitSync(frame.consumed, 0, GL_TIMEOUT_IGNORED);
+		gl_->glDeleteSync(frame.consumed);
+		frame.consumed = nullptr;
+	}
+
+	if (frame.ready != nullptr) {
+		gl_->glDeleteSync(frame.ready);
+		frame.ready = nullptr;
+	}
+
+	if (frame.target == nullptr)
+		frame.target = new QOpenGLFramebufferObject(size_);
+
+	QOpenGLFramebufferObject *target = multisampled_ != nullptr ? multisampled_ : frame.target;
+	target->bind();
+	painter_.paint(scene, size_);
+
+	if (multisampled_ != nullptr)
+		QOpenGLFramebufferObject::blitFramebuffer(frame.target, multisampled_);
+
+	frame.ready = gl_->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	frame.serial = scene.serial;
+	gl_->glFlush();
+}
+
+void RenderThread::cleanUp()
+{
+	for (RenderedFrame &frame : frames_.buffers()) {
+		if (frame.ready != nullptr)
+			gl_->glDeleteSync(frame.ready);
+		if (frame.consumed != nullptr)
+			gl_->glDeleteSync(frame.consumed);
+		delete frame.target;
+		frame = RenderedFrame();
+	}
+	hasFrame_ = false;
+
+	delete multisampled_;
+	multisampled_ = nullptr;
+
+	painter_.cleanUp();
+}
\ No newline at end of file
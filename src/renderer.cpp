@@ -1,13 +1,84 @@
 #include <renderer.hpp>
 // #include "hermite_curve.hpp"
 #include <QOpenGLShaderProgram>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QMouseEvent>
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#include <animation_renderer.hpp>
 #include <ferguson_patch.hpp>
+#include <image_warper.hpp>
+#include <mesh_fitter.hpp>
+#include <tiled_exporter.hpp>
+
+namespace
+{
+	// of the corners, tangents and colours, not the inner point
+	std::size_t hashPatch(const PatchPose &pose, const std::array<QVector3D, 4> &colours)
+	{
+		std::size_t hash = 0;
+		auto add = [&hash](double value) {
+			hash ^= std::hash<double>()(value) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+		};
+		for (unsigned int i = PatchPose::P0; i <= PatchPose::T20; ++i) {
+			add(pose[i].x());
+			add(pose[i].y());
+		}
+		for (const QVector3D &c : colours) {
+			add(c.x());
+			add(c.y());
+			add(c.z());
+		}
+		return hash;
+	}
+
+	bool samePatch(const FergusonPatch &patch, const SvgMeshReader::Patch &other)
+	{
+		PatchPose pose = patch.pose();
+		pose[PatchPose::InnerPoint] = other.pose[PatchPose::InnerPoint];
+		return pose == other.pose && patch.cornerColours() == other.colours;
+	}
+}
 
 Renderer::Renderer(QWidget *parent)
-	:QOpenGLWidget(parent)
+	:QOpenGLWidget(parent), capture_{std::make_unique<FrameCapture>()}, sequenceFrame_{0}, sequenceDropped_{0}, sketching_{false},
+	 drag_{Drag::None}, dragMoved_{false}, recorder_{nullptr}
 {
 	setFixedSize(800, 600);
+
+	// a sequence outrunning the encoder drops frames rather than queuing them
+	capture_->setBacklogLimit(capture_->slots());
+
+	// the encoder reports from its worker thread
+	capture_->encoder().onDone([this](const QString &filename, bool ok) {
+		QMetaObject::invokeMethod(this, [=]() {
+			if (captureDone_)
+				captureDone_(filename, ok);
+		}, Qt::QueuedConnection);
+	});
+
+	connect(&sequenceTimer_, &QTimer::timeout, [this]() { update(); });
+
+	// a save usually comes as several changes in a row, reload once after them
+	reloadTimer_.setSingleShot(true);
+	reloadTimer_.setInterval(50);
+	connect(&watcher_, &QFileSystemWatcher::fileChanged, [this]() { reloadTimer_.start(); });
+	connect(&reloadTimer_, &QTimer::timeout, [this]() { reloadSvg(); });
+
+	pollTimer_.setInterval(2);
+	connect(&pollTimer_, &QTimer::timeout, [this]() {
+		makeCurrent();
+		bool busy = capture_->poll();
+		doneCurrent();
+		if (!busy)
+			pollTimer_.stop();
+	});
+
 	canvas_ = std::make_shared<FergusonCanvas>(this, width(), height());
 	// canvas_->insertDrawing(std::make_shared<HermiteCurve>(canvas_));
 
@@ -22,92 +93,869 @@ Renderer::Renderer(QWidget *parent)
 						 h2{p2, t23, p3, t32, res, 2*(res+4+44)}, h3{p0, t02, p2, t20, res, (res+4+44)*3};
 
 	canvas_->insertDrawing(std::make_shared<FergusonPatch>(h0, h1, h2, h3, res, canvas_));
+
+	sketch_ = std::make_shared<StrokeSketch>(canvas_);
+	canvas_->insertDrawing(sketch_);
+	selectionOverlay_ = std::make_shared<SelectionOverlay>(canvas_);
+	canvas_->insertDrawing(selectionOverlay_);
+
+	connect(&playbackTimer_, &QTimer::timeout, [this]() {
+		float time = clock_.time();
+		applyAnimation(time);
+		if (playbackTick_)
+			playbackTick_(time);
+	});
 }
 
 
-bool Renderer::save(const QString &filename)
+void Renderer::save(const QString &filename)
 {
-	QImage image = grabFramebuffer();
-	return image.save(filename, "PNG");
+	pendingCapture_ = filename;
+	update();
 }
 
-void Renderer::interpolateInnerPoint(float u, float v)
+void Renderer::startImageSequence(const QString &directory, int fps)
+{
+	sequenceDirectory_ = directory;
+	sequenceFrame_ = 0;
+	sequenceDropped_ = capture_->dropped();
+	sequenceTimer_.start(1000 / std::max(1, fps));
+}
+
+void Renderer::stopImageSequence()
+{
+	if (!recordingSequence())
+		return;
+
+	std::size_t dropped = capture_->dropped() - sequenceDropped_;
+	if (dropped > 0)
+		qWarning() << "image sequence:" << dropped << "frames dropped,"
+			<< sequenceFrame_ << "written to" << sequenceDirectory_;
+
+	sequenceTimer_.stop();
+	sequenceDirectory_.clear();
+}
+
+bool Renderer::exportImage(const QString &filename, QSize size, int supersampling)
 {
+	// the drawings' own buffers are only up to date on the GUI context
+	bool threaded = canvas_->threaded();
+	if (threaded)
+		canvas_->setThreaded(false);
+
 	makeCurrent();
+	TiledExporter exporter(canvas_.get(), size, supersampling);
+	bool ok = exporter.write(filename);
+	doneCurrent();
+
+	if (threaded)
+		canvas_->setThreaded(true);
+	return ok;
+}
+
+bool Renderer::warpImage(const QString &input, const QString &output, int width)
+{
+	QImage source(input);
+	if (source.isNull())
+		return false;
+
+	if (width <= 0)
+		width = source.width();
+	QSize size(width, std::max(1, int(qint64(width) * height() / this->width())));
+
 	std::shared_ptr<FergusonPatch> patch = 
 		std::dynamic_pointer_cast<FergusonPatch>(canvas_->getDrawing(0));
-	patch->interpolateInnerPoint(u, v);
-	patch->showInterpolateLines();
-	update();
-	doneCurrent();
+	ImageWarper warper(patch->geometry());
+	QImage image = warper.warp(source, size);
+	return !image.isNull() && image.save(output);
 }
 
-void Renderer::hideInnerPointInterpolation()
+void Renderer::loadMesh(const GradientMesh &mesh)
+{
+	stopWatchingSvg();
+	clearSelection();
+	clearKeys();
+
+	std::vector<std::shared_ptr<Drawing>> drawings;
+	drawings.reserve(mesh.rows() * mesh.columns());
+
+	for (unsigned int r = 0; r < mesh.rows(); ++r)
+		for (unsigned int c = 0; c < mesh.columns(); ++c)
+			drawings.push_back(meshPatch(mesh.pose(r, c), mesh.colours(r, c)));
+	drawings.push_back(sketch_);
+	drawings.push_back(selectionOverlay_);
+
+	canvas_->setDrawings(std::move(drawings));
+	setContinuity(continuity());
+}
+
+bool Renderer::importSvg(const QString &filename)
+{
+	std::vector<SvgMeshReader::Patch> patches;
+	if (!readSvg(filename, patches))
+		return false;
+	stopWatchingSvg();
+	clearSelection();
+	fitSvg(patches);
+	mapSvg(patches);
+
+	clearKeys();
+
+	std::vector<std::shared_ptr<Drawing>> drawings;
+	drawings.reserve(patches.size() + 1);
+	for (const SvgMeshReader::Patch &patch : patches)
+		drawings.push_back(meshPatch(patch.pose, patch.colours));
+	drawings.push_back(sketch_);
+	drawings.push_back(selectionOverlay_);
+
+	canvas_->setDrawings(std::move(drawings));
+	setContinuity(continuity());
+	return true;
+}
+
+bool Renderer::watchSvg(const QString &filename)
+{
+	if (!importSvg(filename))
+		return false;
+
+	watchedSvg_ = filename;
+	watcher_.addPath(filename);
+	return true;
+}
+
+void Renderer::stopWatchingSvg()
+{
+	reloadTimer_.stop();
+	if (!watcher_.files().isEmpty())
+		watcher_.removePaths(watcher_.files());
+	watchedSvg_.clear();
+}
+
+bool Renderer::reloadSvg()
+{
+	// editors that save by renaming replace the file the watcher was on
+	if (!watcher_.files().contains(watchedSvg_))
+		watcher_.addPath(watchedSvg_);
+
+	// a file still being written reads as broken, its next change reloads it
+	std::vector<SvgMeshReader::Patch> patches;
+	if (!readSvg(watchedSvg_, patches))
+		return false;
+	// kept from the import, so what did not change in the file stays put
+	mapSvg(patches);
+	clearSelection();
+
+	std::vector<std::shared_ptr<FergusonPatch>> live = this->patches();
+	std::vector<bool> kept(live.size(), false);
+	std::vector<std::shared_ptr<FergusonPatch>> matched(patches.size());
+	SceneDiff diff;
+
+	// patches found unchanged anywhere in the scene are kept as they are,
+	// so inserting or removing some does not touch the others
+	std::unordered_multimap<std::size_t, std::size_t> index;
+	for (std::size_t i = 0; i < live.size(); ++i)
+		index.emplace(hashPatch(live[i]->pose(), live[i]->cornerColours()), i);
+
+	for (std::size_t i = 0; i < patches.size(); ++i) {
+		auto range = index.equal_range(hashPatch(patches[i].pose, patches[i].colours));
+		for (auto found = range.first; found != range.second; ++found) {
+			std::size_t j = found->second;
+			if (kept[j] || !samePatch(*live[j], patches[i]))
+				continue;
+			kept[j] = true;
+			matched[i] = live[j];
+			++diff.unchanged;
+			break;
+		}
+	}
+
+	// the others are changed in place, in order, and only what differs is
+	// re-tessellated and uploaded
+	std::size_t next = 0;
+	for (std::size_t i = 0; i < patches.size(); ++i) {
+		if (matched[i])
+			continue;
+		while (next < live.size() && kept[next])
+			++next;
+
+		if (next == live.size()) {
+			matched[i] = meshPatch(patches[i].pose, patches[i].colours);
+			++diff.added;
+			continue;
+		}
+
+		FergusonPatch &patch = *live[next];
+		kept[next] = true;
+		matched[i] = live[next];
+
+		PatchPose pose = patches[i].pose;
+		pose[PatchPose::InnerPoint] = patch.pose()[PatchPose::InnerPoint];
+		bool moved = pose != patch.pose(), recoloured = patches[i].colours != patch.cornerColours();
+		if (moved) {
+			patch.setPose(pose);
+			++diff.moved;
+		}
+		if (recoloured) {
+			patch.setCornerColours(patches[i].colours);
+			++diff.recoloured;
+		}
+		if (!moved && !recoloured)
+			++diff.unchanged;
+	}
+	diff.removed = std::size_t(std::count(kept.begin(), kept.end(), false));
+
+	std::vector<std::shared_ptr<Drawing>> drawings(matched.begin(), matched.end());
+	drawings.push_back(sketch_);
+	drawings.push_back(selectionOverlay_);
+	canvas_->updateDrawings(std::move(drawings));
+	setContinuity(continuity());
+
+	if (sceneReloaded_)
+		sceneReloaded_(diff);
+	return true;
+}
+
+bool Renderer::readSvg(const QString &filename, std::vector<SvgMeshReader::Patch> &patches)
+{
+	SvgMeshReader reader;
+	bool ok = reader.read(filename, [&patches](const SvgMeshReader::Patch &patch) {
+		patches.push_back(patch);
+	});
+	return ok && !patches.empty();
+}
+
+void Renderer::fitSvg(const std::vector<SvgMeshReader::Patch> &patches)
+{
+	// the corners and Bezier control points of the edges bound the meshes
+	double left = patches[0].pose[PatchPose::P0].x(), right = left;
+	double top = patches[0].pose[PatchPose::P0].y(), bottom = top;
+	auto include = [&](const QPointF &p) {
+		left = std::min(left, p.x()); right = std::max(right, p.x());
+		top = std::min(top, p.y()); bottom = std::max(bottom, p.y());
+	};
+	const unsigned int ends[8][2] = {
+		{ PatchPose::P0, PatchPose::T01 }, { PatchPose::P1, PatchPose::T10 },
+		{ PatchPose::P1, PatchPose::T13 }, { PatchPose::P3, PatchPose::T31 },
+		{ PatchPose::P2, PatchPose::T23 }, { PatchPose::P3, PatchPose::T32 },
+		{ PatchPose::P0, PatchPose::T02 }, { PatchPose::P2, PatchPose::T20 } };
+	for (const SvgMeshReader::Patch &patch : patches)
+		for (unsigned int e = 0; e < 8; ++e) {
+			const QPointF &p = patch.pose[ends[e][0]], &t = patch.pose[ends[e][1]];
+			include(p);
+			include(e % 2 == 0 ? p + t / 3.0 : p - t / 3.0);
+		}
+
+	// fills 90% of the canvas keeping the aspect ratio, SVG has y down
+	double w = std::max(1, width()), h = std::max(1, height());
+	double pixels = 0.9 * std::min(w / std::max(right - left, 1e-9), h / std::max(bottom - top, 1e-9));
+	svgCentre_ = QPointF(0.5 * (left + right), 0.5 * (top + bottom));
+	svgScale_ = QPointF(2.0 * pixels / w, -2.0 * pixels / h);
+}
+
+void Renderer::mapSvg(std::vector<SvgMeshReader::Patch> &patches) const
+{
+	auto map = [this](const QPointF &p) { return QPointF(p.x() * svgScale_.x(), p.y() * svgScale_.y()); };
+	for (SvgMeshReader::Patch &patch : patches) {
+		for (unsigned int i = PatchPose::P0; i <= PatchPose::P3; ++i)
+			patch.pose[i] = map(patch.pose[i] - svgCentre_);
+		for (unsigned int i = PatchPose::T01; i <= PatchPose::T20; ++i)
+			patch.pose[i] = map(patch.pose[i]);
+	}
+}
+
+std::shared_ptr<FergusonPatch> Renderer::meshPatch(const PatchPose &pose, const std::array<QVector3D, 4> &colours)
+{
+	std::shared_ptr<FergusonPatch> patch = FergusonPatch::create(pose, 10, canvas_);
+	for (unsigned int i = 0; i < 4; ++i)
+		patch->cornerColour(i, colours[i]);
+
+	// a mesh is looked at, not edited handle by handle
+	patch->interiorResolution(8);
+	patch->showInterior();
+	patch->hideHandlers();
+	patch->hideFoldover();
+	return patch;
+}
+
+bool Renderer::fitImage(const QString &filename, unsigned int patches, unsigned int iterations,
+	MeshFitter::ProgressCallback progress)
+{
+	QImage image(filename);
+	if (image.isNull())
+		return false;
+
+	MeshFitter fitter(image);
+	fitter.onProgress(progress);
+
+	GradientMesh mesh = fitter.initialMesh(patches, patches);
+	fitter.fit(mesh, iterations);
+	loadMesh(mesh);
+	return true;
+}
+
+void Renderer::setKey()
 {
-	makeCurrent();
 	std::shared_ptr<FergusonPatch> patch = 
 		std::dynamic_pointer_cast<FergusonPatch>(canvas_->getDrawing(0));
-	patch->hideInterpolateLines();
-	update();
-	doneCurrent();
+	animation_.setKeys(clock_.time(), patch->pose());
+	clock_.duration(animation_.duration());
 }
 
-void Renderer::showHandlers()
+void Renderer::removeKey()
 {
-	makeCurrent();
+	animation_.removeKeys(clock_.time());
+	clock_.duration(animation_.duration());
+}
+
+void Renderer::clearKeys()
+{
+	pause();
+	animation_.clear();
+	clock_.duration(0.f);
+}
+
+void Renderer::play()
+{
+	if (animation_.empty())
+		return;
+
+	clock_.duration(animation_.duration());
+	clock_.play();
+	playbackTimer_.start(16);
+}
+
+void Renderer::pause()
+{
+	clock_.pause();
+	playbackTimer_.stop();
+}
+
+void Renderer::seek(float time)
+{
+	clock_.seek(time);
+	applyAnimation(clock_.time());
+}
+
+void Renderer::applyAnimation(float time)
+{
+	if (animation_.empty())
+		return;
+
+	canvas_->makeCurrent();
 	std::shared_ptr<FergusonPatch> patch = 
 		std::dynamic_pointer_cast<FergusonPatch>(canvas_->getDrawing(0));
-	patch->showHandlers();
-	update();
-	doneCurrent();
+	patch->setPose(animation_.evaluate(time, patch->pose()));
+	canvas_->update();
+	canvas_->doneCurrent();
 }
 
-void Renderer::hideHandlers()
+bool Renderer::renderAnimation(const QString &directory, QSize size, float fps)
 {
-	makeCurrent();
 	std::shared_ptr<FergusonPatch> patch = 
 		std::dynamic_pointer_cast<FergusonPatch>(canvas_->getDrawing(0));
-	patch->hideHandlers();
+
+	AnimationRenderer animationRenderer(*patch, animation_, size, fps);
+	// lines keep their on-screen width relative to the image
+	animationRenderer.lineWidth(canvas_->lineWidth() * float(size.width()) / float(width()));
+	animationRenderer.samples(format().samples());
+
+	makeCurrent();
+	bool ok = animationRenderer.render(directory);
+	doneCurrent();
+	return ok;
+}
+
+void Renderer::interpolateInnerPoint(float u, float v)
+{
+	canvas_->makeCurrent();
+	for (const std::shared_ptr<FergusonPatch> &patch : patches()) {
+		patch->interpolateInnerPoint(u, v);
+		patch->showInterpolateLines();
+	}
+	canvas_->update();
+	canvas_->doneCurrent();
+}
+
+void Renderer::hideInnerPointInterpolation()
+{
+	canvas_->makeCurrent();
+	for (const std::shared_ptr<FergusonPatch> &patch : patches())
+		patch->hideInterpolateLines();
+	canvas_->update();
+	canvas_->doneCurrent();
+}
+
+void Renderer::showHandlers()
+{
+	canvas_->makeCurrent();
+	for (const std::shared_ptr<FergusonPatch> &patch : patches())
+		patch->showHandlers();
+	canvas_->update();
+	canvas_->doneCurrent();
+}
+
+void Renderer::hideHandlers()
+{
+	canvas_->makeCurrent();
+	for (const std::shared_ptr<FergusonPatch> &patch : patches())
+		patch->hideHandlers();
+	canvas_->update();
+	canvas_->doneCurrent();
+}
+
+void Renderer::showInterior()
+{
+	canvas_->makeCurrent();
+	for (const std::shared_ptr<FergusonPatch> &patch : patches())
+		patch->showInterior();
+	canvas_->update();
+	canvas_->doneCurrent();
+}
+
+void Renderer::hideInterior()
+{
+	canvas_->makeCurrent();
+	for (const std::shared_ptr<FergusonPatch> &patch : patches())
+		patch->hideInterior();
+	canvas_->update();
+	canvas_->doneCurrent();
+}
+
+void Renderer::showFoldover()
+{
+	canvas_->makeCurrent();
+	for (const std::shared_ptr<FergusonPatch> &patch : patches())
+		patch->showFoldover();
+	canvas_->update();
+	canvas_->doneCurrent();
+}
+
+void Renderer::hideFoldover()
+{
+	canvas_->makeCurrent();
+	for (const std::shared_ptr<FergusonPatch> &patch : patches())
+		patch->hideFoldover();
+	canvas_->update();
+	canvas_->doneCurrent();
+}
+
+void Renderer::showIsoGrid()
+{
+	canvas_->makeCurrent();
+	for (const std::shared_ptr<FergusonPatch> &patch : patches())
+		patch->showIsoGrid();
+	canvas_->update();
+	canvas_->doneCurrent();
+}
+
+void Renderer::hideIsoGrid()
+{
+	canvas_->makeCurrent();
+	for (const std::shared_ptr<FergusonPatch> &patch : patches())
+		patch->hideIsoGrid();
+	canvas_->update();
+	canvas_->doneCurrent();
+}
+
+void Renderer::setIsoGridLines(unsigned int lines)
+{
+	canvas_->makeCurrent();
+	for (const std::shared_ptr<FergusonPatch> &patch : patches())
+		patch->setIsoGridLines(lines, lines);
+	canvas_->update();
+	canvas_->doneCurrent();
+}
+
+void Renderer::setSketching(bool enabled)
+{
+	sketching_ = enabled;
+	sketch_->clear();
+
+	// a stroke needs every sample of a fast device, not one per frame
+	QCoreApplication::setAttribute(Qt::AA_CompressHighFrequencyEvents, !enabled);
+}
+
+void Renderer::clearSelection()
+{
+	drag_ = Drag::None;
+	selection_.clear();
+	selectionOverlay_->setMarquee(QRectF());
+	selectionOverlay_->setHandles({});
+}
+
+void Renderer::setContinuity(ContinuityConstraints::Continuity continuity)
+{
+	if (continuity == ContinuityConstraints::Continuity::None)
+		constraints_.clear();
+	else
+		constraints_.detect(patches(), continuity);
+}
+
+void Renderer::applyConstraints(const std::vector<std::uint32_t> &edited)
+{
+	if (continuity() == ContinuityConstraints::Continuity::None || edited.empty())
+		return;
+
+	const ContinuityConstraints::Patches &patches = constraints_.patches();
+	for (const std::pair<std::size_t, PatchPose> &changed : constraints_.enforce(edited))
+		if (changed.second != patches[changed.first]->pose())
+			patches[changed.first]->setPose(changed.second);
+}
+
+QTransform Renderer::selectionDrag(QPointF p) const
+{
+	if (drag_ == Drag::Translate)
+		return QTransform::fromTranslate(p.x() - dragStart_.x(), p.y() - dragStart_.y());
+
+	// rotations and scales are in pixels, NDC is stretched with the canvas
+	QTransform toPixels = QTransform::fromScale(0.5 * width(), 0.5 * height());
+	QPointF start = toPixels.map(dragStart_ - dragCentre_), now = toPixels.map(p - dragCentre_);
+
+	QTransform m;
+	if (drag_ == Drag::Rotate) {
+		double angle = std::atan2(now.y(), now.x()) - std::atan2(start.y(), start.x());
+		m.rotateRadians(angle);
+	} else {
+		double from = std::hypot(start.x(), start.y());
+		double factor = from > 1e-9 ? std::hypot(now.x(), now.y()) / from : 1.0;
+		m.scale(factor, factor);
+	}
+
+	// about the centre: to it, into pixels, the change, and back
+	return QTransform::fromTranslate(-dragCentre_.x(), -dragCentre_.y()) * toPixels * m * toPixels.inverted() *
+		QTransform::fromTranslate(dragCentre_.x(), dragCentre_.y());
+}
+
+QPointF Renderer::toViewportCoordSystem(const QPointF &screenCoords) const
+{
+	return QPointF(2.f * screenCoords.x() / width() - 1.f, 1.f - 2.f * screenCoords.y() / height());
+}
+
+void Renderer::applyStroke()
+{
+	const StrokeFitter &fitter = sketch_->fitter();
+	std::vector<std::shared_ptr<FergusonPatch>> all = patches();
+	if (fitter.empty() || all.empty())
+		return;
+
+	StrokeFitter::Segment stroke = fitter.boundary();
+	std::vector<PatchPose> poses(all.size());
+	for (std::size_t p = 0; p < all.size(); ++p)
+		poses[p] = all[p]->pose();
+
+	// boundary curves as corner a, tangent at a, corner b, tangent at b
+	const PatchPose::Channel curves[4][4] = {
+		{ PatchPose::P0, PatchPose::T01, PatchPose::P1, PatchPose::T10 },
+		{ PatchPose::P1, PatchPose::T13, PatchPose::P3, PatchPose::T31 },
+		{ PatchPose::P2, PatchPose::T23, PatchPose::P3, PatchPose::T32 },
+		{ PatchPose::P0, PatchPose::T02, PatchPose::P2, PatchPose::T20 }
+	};
+
+	auto distance = [](QPointF a, QPointF b) { return std::hypot(a.x() - b.x(), a.y() - b.y()); };
+
+	// the patch, curve and direction whose corners are closest to the stroke ends
+	std::size_t patch = 0;
+	unsigned int best = 0;
+	bool reversed = false;
+	double bestDistance = std::numeric_limits<double>::max();
+	for (std::size_t p = 0; p < poses.size(); ++p)
+		for (unsigned int k = 0; k < 4; ++k) {
+			QPointF a = poses[p][curves[k][0]], b = poses[p][curves[k][2]];
+			double forward = distance(a, stroke.p0) + distance(b, stroke.p1);
+			double backward = distance(a, stroke.p1) + distance(b, stroke.p0);
+			if (std::min(forward, backward) < bestDistance) {
+				bestDistance = std::min(forward, backward);
+				patch = p;
+				best = k;
+				reversed = backward < forward;
+			}
+		}
+
+	// run backwards, the stroke's end tangent becomes the start tangent negated
+	if (reversed)
+		stroke = { stroke.p1, -stroke.t1, stroke.p0, -stroke.t0 };
+	StrokeFitter::Segment backwards = { stroke.p1, -stroke.t1, stroke.p0, -stroke.t0 };
+
+	// Neighbours joined to the edge follow it: a curve between the same two
+	// corners takes the stroke, either way round, and a corner on one of its
+	// ends moves with it. Joined means within the default tolerance of
+	// ContinuityConstraints::detect.
+	const QPointF a = poses[patch][curves[best][0]], b = poses[patch][curves[best][2]];
+	auto joined = [&](QPointF p, QPointF q) { return distance(p, q) <= 1e-6; };
+
+	std::vector<std::uint32_t> edited;
+	std::vector<bool> changed(all.size(), false);
+	for (std::size_t p = 0; p < poses.size(); ++p) {
+		const PatchPose before = poses[p];
+		auto set = [&](unsigned int channel, QPointF value) {
+			poses[p][channel] = value;
+			edited.push_back(std::uint32_t(p * ContinuityConstraints::Handles + channel));
+			changed[p] = true;
+		};
+
+		for (unsigned int k = 0; k < 4; ++k) {
+			const PatchPose::Channel *curve = curves[k];
+			bool forward = joined(before[curve[0]], a) && joined(before[curve[2]], b);
+			bool backward = !forward && joined(before[curve[0]], b) && joined(before[curve[2]], a);
+			if (!forward && !backward)
+				continue;
+
+			const StrokeFitter::Segment &along = forward ? stroke : backwards;
+			set(curve[1], along.t0);
+			set(curve[3], along.t1);
+		}
+
+		for (unsigned int channel = PatchPose::P0; channel <= PatchPose::P3; ++channel) {
+			if (joined(before[channel], a))
+				set(channel, stroke.p0);
+			else if (joined(before[channel], b))
+				set(channel, stroke.p1);
+		}
+	}
+
+	canvas_->makeCurrent();
+	for (std::size_t p = 0; p < all.size(); ++p)
+		if (changed[p])
+			all[p]->setPose(poses[p]);
+	// tangents meeting the edited ones across corners keep their continuity
+	if (all == constraints_.patches())
+		applyConstraints(edited);
+	canvas_->update();
+	canvas_->doneCurrent();
+}
+
+void Renderer::setQuantised(bool quantised)
+{
+	canvas_->makeCurrent();
+	for (const std::shared_ptr<FergusonPatch> &patch : patches())
+		patch->setQuantised(quantised);
+	canvas_->update();
+	canvas_->doneCurrent();
+}
+
+void Renderer::setLayerCaching(bool enabled)
+{
+	canvas_->setLayerCaching(enabled);
 	update();
+}
+
+void Renderer::setLineWidth(float width)
+{
+	canvas_->setLineWidth(width);
+}
+
+void Renderer::setThreadedRendering(bool enabled)
+{
+	canvas_->setThreaded(enabled);
+}
+
+VertexTraffic Renderer::vertexTraffic() const
+{
+	VertexTraffic traffic;
+	for (const std::shared_ptr<FergusonPatch> &patch : patches()) {
+		VertexTraffic t = patch->lastFrameTraffic();
+		traffic.uploaded += t.uploaded;
+		traffic.fetched += t.fetched;
+		traffic.saved += t.saved;
+	}
+	return traffic;
+}
+
+std::vector<PatchMeasures> Renderer::measures() const
+{
+	std::vector<FergusonGeometry> geometries;
+	for (const std::shared_ptr<FergusonPatch> &patch : patches())
+		geometries.push_back(patch->geometry());
+	return FergusonGeometry::measures(geometries);
+}
+
+GpuEvaluator::Benchmark Renderer::benchmarkEvaluation(std::size_t samples, bool derivatives)
+{
+	std::vector<FergusonGeometry> geometries;
+	for (const std::shared_ptr<FergusonPatch> &patch : patches())
+		geometries.push_back(patch->geometry());
+
+	makeCurrent();
+	GpuEvaluator::Benchmark result = GpuEvaluator::benchmark(geometries, samples, derivatives);
 	doneCurrent();
+	return result;
+}
+
+std::vector<std::shared_ptr<FergusonPatch>> Renderer::patches() const
+{
+	std::vector<std::shared_ptr<FergusonPatch>> result;
+	for (std::size_t i = 0; i < canvas_->drawingCount(); ++i)
+		if (auto patch = std::dynamic_pointer_cast<FergusonPatch>(canvas_->getDrawing(i)))
+			result.push_back(patch);
+	return result;
+}
+
+unsigned long long Renderer::updateRequests() const
+{
+	return canvas_->updateRequests();
 }
 
 void Renderer::initializeGL()
 {
 	canvas_->init();
+	capture_->init();
 }
 
 void Renderer::paintGL()
 {
 	canvas_->render();
+
+	QString filename = pendingCapture_;
+	bool sequence = filename.isEmpty() && recordingSequence();
+	if (sequence)
+		filename = QDir(sequenceDirectory_).filePath(
+			QString("frame_%1.png").arg(sequenceFrame_, 5, 10, QChar('0')));
+
+	if (!filename.isEmpty()) {
+		// when every read back is still in flight, or the encoder is a ring
+		// behind, a single capture waits for the next frame, a sequence frame
+		// is dropped
+		QSize size = QSize(width(), height()) * devicePixelRatioF();
+		if (capture_->capture(defaultFramebufferObject(), size, format().samples(), filename)) {
+			if (sequence)
+				++sequenceFrame_;
+			else
+				pendingCapture_.clear();
+		} else if (!sequence) {
+			update();
+		}
+	}
+
+	if (capture_->poll() && !pollTimer_.isActive())
+		pollTimer_.start();
 }
 
 void Renderer::keyPressEvent(QKeyEvent *e)
 {
+	if (recorder_ != nullptr)
+		recorder_->record(e);
+
+	if (e->key() == Qt::Key_Escape && !selection_.empty()) {
+		clearSelection();
+		return;
+	}
+
 	canvas_->keyPress(e);
 }
 
 void Renderer::keyReleaseEvent(QKeyEvent *e)
 {
+	if (recorder_ != nullptr)
+		recorder_->record(e);
+
 	canvas_->keyRelease(e);
 }
 
 void Renderer::mouseMoveEvent(QMouseEvent *e)
 {
+	if (recorder_ != nullptr)
+		recorder_->record(e);
+
+	if (sketching_) {
+		if (sketch_->fitter().drawing())
+			sketch_->addPoint(toViewportCoordSystem(e->localPos()));
+		return;
+	}
+
+	QPointF p = toViewportCoordSystem(e->localPos());
+	if (drag_ == Drag::Marquee) {
+		selectionOverlay_->setMarquee(QRectF(dragStart_, p).normalized());
+		return;
+	}
+	if (drag_ != Drag::None) {
+		// moves are compressed to one per event loop pass, so the selected
+		// patches are re-tessellated once per frame at most
+		dragMoved_ = true;
+		selection_.transform(selectionDrag(p));
+		// the selection numbers handles in the same scene the ties were found in
+		if (selection_.patches() == constraints_.patches())
+			applyConstraints(selection_.indices());
+		selectionOverlay_->setHandles(selection_.positions());
+		return;
+	}
+
 	canvas_->mouseMove(e);
+	applyConstraints(grabbed_);
 }
 
 void Renderer::mousePressEvent(QMouseEvent *e)
 {
+	if (recorder_ != nullptr)
+		recorder_->record(e);
+
+	if (sketching_) {
+		sketch_->begin(toViewportCoordSystem(e->localPos()));
+		return;
+	}
+
+	dragStart_ = toViewportCoordSystem(e->localPos());
+	dragMoved_ = false;
+	if (e->modifiers() & Qt::ShiftModifier) {
+		drag_ = Drag::Marquee;
+		return;
+	}
+	if (!selection_.empty()) {
+		drag_ = e->modifiers() & Qt::ControlModifier ? Drag::Rotate :
+		        e->modifiers() & Qt::AltModifier ? Drag::Scale : Drag::Translate;
+		dragCentre_ = selection_.centre();
+		selection_.begin();
+		return;
+	}
+
 	canvas_->mousePress(e);
+
+	grabbed_.clear();
+	if (continuity() != ContinuityConstraints::Continuity::None) {
+		const ContinuityConstraints::Patches &patches = constraints_.patches();
+		for (std::size_t p = 0; p < patches.size(); ++p)
+			for (unsigned int channel : patches[p]->grabbedChannels())
+				grabbed_.push_back(std::uint32_t(p * ContinuityConstraints::Handles + channel));
+	}
 }
 
 void Renderer::mouseReleaseEvent(QMouseEvent *e)
 {
+	if (recorder_ != nullptr)
+		recorder_->record(e);
+
+	if (sketching_) {
+		sketch_->finish();
+		applyStroke();
+		sketch_->clear();
+		return;
+	}
+
+	QPointF p = toViewportCoordSystem(e->localPos());
+	if (drag_ == Drag::Marquee) {
+		drag_ = Drag::None;
+		selection_.select(patches(), QRectF(dragStart_, p), e->modifiers() & Qt::ControlModifier);
+		selectionOverlay_->setMarquee(QRectF());
+		selectionOverlay_->setHandles(selection_.positions());
+		return;
+	}
+	if (drag_ != Drag::None) {
+		drag_ = Drag::None;
+		selection_.end();
+		if (!dragMoved_)
+			clearSelection();
+		return;
+	}
+
 	canvas_->mouseRelease(e);
+	grabbed_.clear();
 }
 
 Renderer::~Renderer()
 {
+	makeCurrent();
 	canvas_->destroy();
+	capture_->cleanUp();
+	doneCurrent();
+	// finishes encoding while the widget is still whole
+	capture_.reset();
 }
\ No newline at end of file
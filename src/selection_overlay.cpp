@@ -0,0 +1,146 @@
+#include <selection_overlay.hpp>
+#include <scene_snapshot.hpp>
+#include <shader_registry.hpp>
+
+#include <QDebug>
+
+namespace
+{
+	const QVector3D SelectionColour(1.0f, 0.55f, 0.1f);
+	// half the side of the square around a selected handle, in NDC
+	const float Marker = 0.012f;
+
+	void addRect(std::vector<float> &vertices, float left, float top, float right, float bottom)
+	{
+		const float lines[16] = {
+			left, top, right, top,   right, top, right, bottom,
+			right, bottom, left, bottom,   left, bottom, left, top };
+		vertices.insert(vertices.end(), lines, lines + 16);
+	}
+}
+
+SelectionOverlay::SelectionOverlay(std::shared_ptr<FergusonCanvas> canvas)
+	:canvas_{canvas}, commandsDirty_{true}
+{ }
+
+void SelectionOverlay::setMarquee(const QRectF &rect)
+{
+	marquee_ = rect;
+	updateVertices();
+}
+
+void SelectionOverlay::setHandles(const std::vector<QPointF> &handles)
+{
+	handles_ = handles;
+	updateVertices();
+}
+
+void SelectionOverlay::updateVertices()
+{
+	std::size_t count = vertices_.size();
+	vertices_.clear();
+	if (!marquee_.isNull())
+		addRect(vertices_, float(marquee_.left()), float(marquee_.top()),
+			float(marquee_.right()), float(marquee_.bottom()));
+	for (const QPointF &h : handles_)
+		addRect(vertices_, float(h.x()) - Marker, float(h.y()) - Marker,
+			float(h.x()) + Marker, float(h.y()) + Marker);
+
+	updateGPUBuffers();
+	// the packet only changes with the number of lines
+	if (vertices_.size() != count)
+		commandsDirty_ = true;
+	canvas_->update();
+}
+
+void SelectionOverlay::updateGPUBuffers()
+{
+	// the render thread draws from snapshots
+	if (lineShader_ == nullptr || canvas_->threaded() || vertices_.empty())
+		return;
+
+	canvas_->makeCurrent();
+	VertexArena &arena = canvas_->arena(VertexArena::Position);
+	if (arena.resize(range_, GLsizei(vertices_.size() / 2)))
+		commandsDirty_ = true;
+	arena.write(range_, 0, vertices_.data(), vertices_.size() * sizeof(float));
+	canvas_->doneCurrent();
+}
+
+void SelectionOverlay::init()
+{
+	initializeOpenGLFunctions();
+	lineShader_ = ShaderRegistry::acquire("ferguson_line");
+	if (lineShader_ == nullptr) {
+		// the registry has logged why
+		qWarning() << "SelectionOverlay: no line program, the selection is not drawn";
+		return;
+	}
+
+	canvas_->arena(VertexArena::Position).resize(range_, 512);
+	updateGPUBuffers();
+}
+
+void SelectionOverlay::render()
+{
+	renderOverlay();
+}
+
+void SelectionOverlay::renderOverlay()
+{
+	if (lineShader_ == nullptr || vertices_.empty())
+		return;
+
+	QOpenGLVertexArrayObject::Binder vaoBinder(canvas_->arena(VertexArena::Position).vao());
+	lineShader_->bind();
+	lineShader_->setUniformValue("offset", QVector2D(0.f, 0.f));
+	lineShader_->setUniformValue("scale", QVector2D(1.f, 1.f));
+	lineShader_->setUniformValue("colour", SelectionColour);
+	glDrawArrays(GL_LINES, range_.first, GLsizei(vertices_.size() / 2));
+}
+
+bool SelectionOverlay::record(CommandList &list)
+{
+	if (lineShader_ != nullptr && !vertices_.empty()) {
+		DrawPacket p;
+		p.layer = DrawPacket::Overlay;
+		p.shader = lineShader_.get();
+		p.vao = canvas_->arena(VertexArena::Position).vao();
+		p.colour = SelectionColour;
+		p.mode = GL_LINES;
+		p.first = range_.first;
+		p.count = GLsizei(vertices_.size() / 2);
+		list.add(p);
+	}
+
+	commandsDirty_ = false;
+	return true;
+}
+
+void SelectionOverlay::snapshot(SceneSnapshot &scene) const
+{
+	if (vertices_.empty())
+		return;
+
+	GLint first = scene.vertexCount();
+	scene.vertices.insert(scene.vertices.end(), vertices_.begin(), vertices_.end());
+	scene.draws.push_back({ GL_LINES, first, GLsizei(vertices_.size() / 2), SelectionColour });
+}
+
+void SelectionOverlay::syncGPUBuffers()
+{
+	updateGPUBuffers();
+}
+
+void SelectionOverlay::cleanUp()
+{
+	if (lineShader_ != nullptr) {
+		canvas_->arena(VertexArena::Position).free(range_);
+		lineShader_.reset();
+	}
+}
+
+SelectionOverlay::~SelectionOverlay()
+{
+	cleanUp();
+}
\ No newline at end of file
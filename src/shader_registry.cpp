@@ -0,0 +1,90 @@
+#include <shader_registry.hpp>
+
+#include <QOpenGLContext>
+#include <QOpenGLFunctions_3_2_Core>
+#include <QDebug>
+
+#include <vector>
+
+std::map<ShaderRegistry::Key, std::weak_ptr<QOpenGLShaderProgram>> ShaderRegistry::registry_;
+std::mutex ShaderRegistry::mutex_;
+
+std::shared_ptr<QOpenGLShaderProgram> ShaderRegistry::acquire(const QString &name)
+{
+	QOpenGLContext *context = QOpenGLContext::currentContext();
+	Key key{context, name};
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	std::shared_ptr<QOpenGLShaderProgram> program = registry_[key].lock();
+	if (program != nullptr)
+		return program;
+
+	QOpenGLShaderProgram *built = build(name);
+	if (built == nullptr) {
+		registry_.erase(key);
+		return nullptr;
+	}
+
+	// the last owner releases the program, with the context current
+	program = std::shared_ptr<QOpenGLShaderProgram>(built, [key](QOpenGLShaderProgram *p) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto it = registry_.find(key);
+		if (it != registry_.end() && it->second.expired())
+			registry_.erase(it);
+		delete p;
+	});
+	registry_[key] = program;
+
+	return program;
+}
+
+QOpenGLShaderProgram *ShaderRegistry::build(const QString &name)
+{
+	// programs with feedback outputs are captured by transform feedback
+	// instead of being rasterised, and have no fragment shader
+	struct Sources { const char *vertex; const char *geometry; const char *fragment; std::vector<const char *> feedback; };
+	static const std::map<QString, Sources> programs = {
+		{ "ferguson",      { "ferguson.vs",      nullptr,       "ferguson.fs",      {} } },
+		{ "ferguson_line", { "ferguson.vs",      "ferguson.gs", "ferguson.fs",      {} } },
+		{ "ferguson_fill", { "ferguson_fill.vs", nullptr,       "ferguson_fill.fs", {} } },
+		{ "ferguson_eval", { "ferguson_eval.vs", nullptr,       nullptr,            { "position" } } },
+		{ "ferguson_eval_derivatives", { "ferguson_eval.vs", nullptr, nullptr,      { "position", "su", "sv" } } },
+	};
+
+	auto sources = programs.find(name);
+	if (sources == programs.end()) {
+		qWarning() << "unknown shader program" << name;
+		return nullptr;
+	}
+
+	const QString prefix = ":/shaders/";
+	const std::vector<const char *> &feedback = sources->second.feedback;
+	QOpenGLShaderProgram *program = new QOpenGLShaderProgram();
+
+	if (feedback.empty()) {
+		program->addCacheableShaderFromSourceFile(QOpenGLShader::Vertex, prefix + sources->second.vertex);
+		if (sources->second.geometry != nullptr)
+			program->addCacheableShaderFromSourceFile(QOpenGLShader::Geometry, prefix + sources->second.geometry);
+		program->addCacheableShaderFromSourceFile(QOpenGLShader::Fragment, prefix + sources->second.fragment);
+	} else {
+		// the disk cache keys binaries by source only, while the captured
+		// outputs differ between programs sharing a source
+		program->addShaderFromSourceFile(QOpenGLShader::Vertex, prefix + sources->second.vertex);
+		QOpenGLFunctions_3_2_Core *gl = QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_3_2_Core>();
+		gl->initializeOpenGLFunctions();
+		gl->glTransformFeedbackVaryings(program->programId(), GLsizei(feedback.size()), feedback.data(),
+			GL_INTERLEAVED_ATTRIBS);
+	}
+
+	// attribute locations shared by every program
+	program->bindAttributeLocation("pos", 0);
+	program->bindAttributeLocation("vertexColour", 1);
+
+	if (!program->link()) {
+		qWarning() << "cannot link shader program" << name << program->log();
+		delete program;
+		return nullptr;
+	}
+
+	return program;
+}
\ No newline at end of file
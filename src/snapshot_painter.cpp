@@ -0,0 +1,118 @@
+#include <snapshot_painter.hpp>
+
+#include <QDebug>
+#include <QOpenGLContext>
+#include <QOpenGLVertexArrayObject>
+#include <QVector2D>
+#include <QVector4D>
+
+SnapshotPainter::SnapshotPainter()
+	:gl_{nullptr}, vao_{nullptr}, fillVao_{nullptr}
+{ }
+
+bool SnapshotPainter::init()
+{
+	gl_ = QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_3_2_Core>();
+	gl_->initializeOpenGLFunctions();
+
+	shader_ = ShaderRegistry::acquire("ferguson");
+	lineShader_ = ShaderRegistry::acquire("ferguson_line");
+	fillShader_ = ShaderRegistry::acquire("ferguson_fill");
+	if (shader_ == nullptr || lineShader_ == nullptr || fillShader_ == nullptr) {
+		// the registry has logged why; paint only clears
+		qWarning() << "SnapshotPainter: missing shader programs, nothing is drawn";
+		shader_.reset();
+		lineShader_.reset();
+		fillShader_.reset();
+		return false;
+	}
+
+	vao_ = new QOpenGLVertexArrayObject();
+	vao_->create();
+	{
+		QOpenGLVertexArrayObject::Binder vaoBinder(vao_);
+		vbo_.create();
+		vbo_.bind();
+		gl_->glEnableVertexAttribArray(0);
+		gl_->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	}
+
+	fillVao_ = new QOpenGLVertexArrayObject();
+	fillVao_->create();
+	{
+		QOpenGLVertexArrayObject::Binder vaoBinder(fillVao_);
+		fillVbo_.create();
+		fillVbo_.bind();
+		gl_->glEnableVertexAttribArray(0);
+		gl_->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 5*sizeof(float), 0);
+		gl_->glEnableVertexAttribArray(1);
+		gl_->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 5*sizeof(float),
+			reinterpret_cast<void*>(2*sizeof(float)));
+	}
+	return true;
+}
+
+void SnapshotPainter::paint(const SceneSnapshot &scene, QSize viewport)
+{
+	gl_->glViewport(0, 0, viewport.width(), viewport.height());
+	gl_->glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+	gl_->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	if (shader_ == nullptr)
+		return;
+
+	gl_->glEnable(GL_BLEND);
+	gl_->glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+	if (!scene.colouredDraws.empty()) {
+		QOpenGLVertexArrayObject::Binder vaoBinder(fillVao_);
+		fillVbo_.bind();
+		fillVbo_.allocate(scene.colouredVertices.data(), int(scene.colouredVertices.size() * sizeof(float)));
+
+		fillShader_->bind();
+		fillShader_->setUniformValue("view", QVector4D(1.f, 1.f, 0.f, 0.f));
+		fillShader_->setUniformValue("offset", QVector2D(0.f, 0.f));
+		fillShader_->setUniformValue("scale", QVector2D(1.f, 1.f));
+		for (const SceneSnapshot::Draw &draw : scene.colouredDraws)
+			gl_->glDrawArrays(draw.mode, draw.first, draw.count);
+	}
+
+	if (!scene.draws.empty()) {
+		QOpenGLVertexArrayObject::Binder vaoBinder(vao_);
+		vbo_.bind();
+		vbo_.allocate(scene.vertices.data(), int(scene.vertices.size() * sizeof(float)));
+
+		for (QOpenGLShaderProgram *program : { shader_.get(), lineShader_.get() }) {
+			program->bind();
+			program->setUniformValue("view", QVector4D(1.f, 1.f, 0.f, 0.f));
+			program->setUniformValue("offset", QVector2D(0.f, 0.f));
+			program->setUniformValue("scale", QVector2D(1.f, 1.f));
+		}
+		lineShader_->setUniformValue("lineWidth", scene.lineWidth);
+		lineShader_->setUniformValue("viewport", QVector2D(float(viewport.width()), float(viewport.height())));
+
+		QOpenGLShaderProgram *current = nullptr;
+		for (const SceneSnapshot::Draw &draw : scene.draws) {
+			bool line = draw.mode == GL_LINES || draw.mode == GL_LINE_STRIP;
+			QOpenGLShaderProgram *program = line ? lineShader_.get() : shader_.get();
+			if (program != current) {
+				program->bind();
+				current = program;
+			}
+			program->setUniformValue("colour", draw.colour);
+			gl_->glDrawArrays(draw.mode, draw.first, draw.count);
+		}
+	}
+}
+
+void SnapshotPainter::cleanUp()
+{
+	vbo_.destroy();
+	fillVbo_.destroy();
+	delete vao_;
+	delete fillVao_;
+	vao_ = fillVao_ = nullptr;
+
+	shader_.reset();
+	lineShader_.reset();
+	fillShader_.reset();
+}
\ No newline at end of file
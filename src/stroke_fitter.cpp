@@ -0,0 +1,163 @@
+#include <stroke_fitter.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// bounds the work per point for strokes that are long and smooth
+	const std::size_t MaxSegmentPoints = 64;
+
+	double length(const QPointF &p)
+	{
+		return std::sqrt(p.x()*p.x() + p.y()*p.y());
+	}
+
+	double dot(const QPointF &a, const QPointF &b)
+	{
+		return a.x()*b.x() + a.y()*b.y();
+	}
+}
+
+StrokeFitter::StrokeFitter(float tolerance)
+	:tolerance_{tolerance}, drawing_{false}, points_{0}
+{ }
+
+void StrokeFitter::begin(QPointF p)
+{
+	drawing_ = true;
+	points_ = 1;
+	active_.assign(1, p);
+	segments_.clear();
+}
+
+void StrokeFitter::addPoint(QPointF p)
+{
+	if (!drawing_)
+		return;
+
+	// jitter well below the tolerance only makes the fit slower
+	if (length(p - active_.back()) < 0.25 * tolerance_)
+		return;
+
+	++points_;
+	active_.push_back(p);
+
+	// the open segment leaves the last final one in the same direction
+	bool open = active_.size() > 2;
+	std::size_t finals = open ? segments_.size() - 1 : segments_.size();
+	const QPointF *direction = finals > 0 ? &segments_[finals - 1].t1 : nullptr;
+
+	Segment segment;
+	float error = fit(active_, direction, segment);
+
+	if (!open) {
+		segments_.push_back(segment);
+		return;
+	}
+
+	if (error <= tolerance_ && active_.size() <= MaxSegmentPoints) {
+		segments_.back() = segment;
+		return;
+	}
+
+	// the fit up to the previous point is final, the next segment starts there
+	active_.erase(active_.begin(), active_.end() - 2);
+	fit(active_, &segments_.back().t1, segment);
+	segments_.push_back(segment);
+}
+
+void StrokeFitter::finish()
+{
+	drawing_ = false;
+}
+
+StrokeFitter::Segment StrokeFitter::boundary() const
+{
+	Segment segment;
+	if (segments_.empty())
+		return segment;
+
+	// the chain is smooth, a few samples per segment are enough
+	const unsigned int samples = 8;
+	std::vector<QPointF> points;
+	points.reserve(segments_.size() * samples + 1);
+	for (const Segment &s : segments_) {
+		CubicCurve curve = s.curve();
+		for (unsigned int i = 0; i < samples; ++i)
+			points.push_back(curve.point(float(i) / float(samples)));
+	}
+	points.push_back(segments_.back().p1);
+
+	fit(points, nullptr, segment);
+	return segment;
+}
+
+float StrokeFitter::fit(const std::vector<QPointF> &points, const QPointF *direction, Segment &segment)
+{
+	const QPointF &p0 = points.front(), &p1 = points.back();
+	segment.p0 = p0;
+	segment.p1 = p1;
+
+	// unit start direction, if any
+	QPointF d(0.f, 0.f);
+	if (direction != nullptr && length(*direction) > 0.0)
+		d = *direction / length(*direction);
+	bool along = d != QPointF(0.f, 0.f);
+
+	// a straight segment when there is nothing in between to fit
+	QPointF chord = p1 - p0;
+	segment.t0 = along ? length(chord) * d : chord;
+	segment.t1 = chord;
+
+	double total = 0.0;
+	for (std::size_t j = 1; j < points.size(); ++j)
+		total += length(points[j] - points[j-1]);
+	if (points.size() < 3 || total <= 0.0)
+		return 0.f;
+
+	// With the ends fixed, sum_j |b1 t0 + b2 t1 - r_j|^2 is quadratic in
+	// the tangents, r_j being what the end point terms leave of q_j
+	double s11 = 0.0, s12 = 0.0, s22 = 0.0;
+	QPointF r1(0.f, 0.f), r2(0.f, 0.f);
+	std::vector<double> parameters(points.size(), 0.0);
+
+	double travelled = 0.0;
+	for (std::size_t j = 1; j + 1 < points.size(); ++j) {
+		travelled += length(points[j] - points[j-1]);
+		double u = travelled / total;
+		parameters[j] = u;
+
+		double u2 = u*u, u3 = u2*u;
+		double b0 = 2.0*u3 - 3.0*u2 + 1.0, b1 = u3 - 2.0*u2 + u;
+		double b2 = u3 - u2, b3 = -2.0*u3 + 3.0*u2;
+
+		QPointF r = points[j] - b0 * p0 - b3 * p1;
+		s11 += b1 * b1;
+		s12 += b1 * b2;
+		s22 += b2 * b2;
+		r1 += b1 * r;
+		r2 += b2 * r;
+	}
+	parameters.back() = 1.0;
+
+	double det = s11 * s22 - s12 * s12;
+	if (std::abs(det) < 1e-18)
+		return 0.f;
+
+	if (along) {
+		// t0 = alpha d; a tangent turning back would make a cusp
+		double alpha = std::max(0.0, (s22 * dot(d, r1) - s12 * dot(d, r2)) / det);
+		segment.t0 = alpha * d;
+		segment.t1 = (r2 - s12 * alpha * d) / s22;
+	} else {
+		segment.t0 = (s22 * r1 - s12 * r2) / det;
+		segment.t1 = (s11 * r2 - s12 * r1) / det;
+	}
+
+	CubicCurve curve = segment.curve();
+	double error = 0.0;
+	for (std::size_t j = 1; j + 1 < points.size(); ++j)
+		error = std::max(error, length(curve.point(float(parameters[j])) - points[j]));
+	return float(error);
+}
\ No newline at end of file
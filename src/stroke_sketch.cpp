@@ -0,0 +1,165 @@
+#include <stroke_sketch.hpp>
+#include <scene_snapshot.hpp>
+#include <shader_registry.hpp>
+
+#include <QDebug>
+#include <algorithm>
+
+namespace
+{
+	const unsigned int PerSegment = 16;
+	const QVector3D StrokeColour(0.1f, 0.55f, 0.2f);
+}
+
+StrokeSketch::StrokeSketch(std::shared_ptr<FergusonCanvas> canvas)
+	:canvas_{canvas}, finalSegments_{0}, commandsDirty_{true}
+{ }
+
+void StrokeSketch::begin(QPointF p)
+{
+	fitter_.begin(p);
+	vertices_.clear();
+	finalSegments_ = 0;
+	updateVertices();
+}
+
+void StrokeSketch::addPoint(QPointF p)
+{
+	std::size_t points = fitter_.points();
+	fitter_.addPoint(p);
+	if (fitter_.points() != points)
+		updateVertices();
+}
+
+void StrokeSketch::finish()
+{
+	fitter_.finish();
+	updateVertices();
+}
+
+void StrokeSketch::clear()
+{
+	fitter_ = StrokeFitter(fitter_.tolerance());
+	vertices_.clear();
+	finalSegments_ = 0;
+	commandsDirty_ = true;
+	canvas_->update();
+}
+
+void StrokeSketch::updateVertices()
+{
+	const std::vector<StrokeFitter::Segment> &segments = fitter_.segments();
+
+	// everything before the first segment that was still open stays
+	std::size_t first = std::min(finalSegments_, segments.size());
+	vertices_.resize(2 * first * PerSegment);
+	vertices_.resize(segments.empty() ? 0 : 2 * (segments.size() * PerSegment + 1));
+
+	for (std::size_t i = first; i < segments.size(); ++i)
+		segments[i].curve().tessellate(PerSegment, &vertices_[2 * i * PerSegment], false);
+	if (!segments.empty()) {
+		vertices_[vertices_.size() - 2] = float(segments.back().p1.x());
+		vertices_[vertices_.size() - 1] = float(segments.back().p1.y());
+	}
+
+	finalSegments_ = fitter_.finalSegments();
+	updateGPUBuffers(2 * first * PerSegment);
+	commandsDirty_ = true;
+	canvas_->update();
+}
+
+void StrokeSketch::updateGPUBuffers(std::size_t first)
+{
+	// the render thread draws from snapshots
+	if (lineShader_ == nullptr || canvas_->threaded())
+		return;
+
+	canvas_->makeCurrent();
+	// grows geometrically, the whole stroke is uploaded again when it moves
+	VertexArena &arena = canvas_->arena(VertexArena::Position);
+	if (arena.resize(range_, GLsizei(vertices_.size() / 2))) {
+		first = 0;
+		commandsDirty_ = true;
+	}
+	if (first < vertices_.size())
+		arena.write(range_, first * sizeof(float), &vertices_[first], (vertices_.size() - first) * sizeof(float));
+	canvas_->doneCurrent();
+}
+
+void StrokeSketch::init()
+{
+	initializeOpenGLFunctions();
+	lineShader_ = ShaderRegistry::acquire("ferguson_line");
+	if (lineShader_ == nullptr) {
+		// the registry has logged why
+		qWarning() << "StrokeSketch: no line program, the stroke is not drawn";
+		return;
+	}
+
+	canvas_->arena(VertexArena::Position).resize(range_, 2048);
+	updateGPUBuffers(0);
+}
+
+void StrokeSketch::render()
+{
+	renderOverlay();
+}
+
+void StrokeSketch::renderOverlay()
+{
+	if (lineShader_ == nullptr || vertices_.size() < 4)
+		return;
+
+	QOpenGLVertexArrayObject::Binder vaoBinder(canvas_->arena(VertexArena::Position).vao());
+	lineShader_->bind();
+	lineShader_->setUniformValue("offset", QVector2D(0.f, 0.f));
+	lineShader_->setUniformValue("scale", QVector2D(1.f, 1.f));
+	lineShader_->setUniformValue("colour", StrokeColour);
+	glDrawArrays(GL_LINE_STRIP, range_.first, GLsizei(vertices_.size() / 2));
+}
+
+bool StrokeSketch::record(CommandList &list)
+{
+	if (lineShader_ != nullptr && vertices_.size() >= 4) {
+		DrawPacket p;
+		p.layer = DrawPacket::Overlay;
+		p.shader = lineShader_.get();
+		p.vao = canvas_->arena(VertexArena::Position).vao();
+		p.colour = StrokeColour;
+		p.mode = GL_LINE_STRIP;
+		p.first = range_.first;
+		p.count = GLsizei(vertices_.size() / 2);
+		list.add(p);
+	}
+
+	commandsDirty_ = false;
+	return true;
+}
+
+void StrokeSketch::snapshot(SceneSnapshot &scene) const
+{
+	if (vertices_.size() < 4)
+		return;
+
+	GLint first = scene.vertexCount();
+	scene.vertices.insert(scene.vertices.end(), vertices_.begin(), vertices_.end());
+	scene.draws.push_back({ GL_LINE_STRIP, first, GLsizei(vertices_.size() / 2), StrokeColour });
+}
+
+void StrokeSketch::syncGPUBuffers()
+{
+	updateGPUBuffers(0);
+}
+
+void StrokeSketch::cleanUp()
+{
+	if (lineShader_ != nullptr) {
+		canvas_->arena(VertexArena::Position).free(range_);
+		lineShader_.reset();
+	}
+}
+
+StrokeSketch::~StrokeSketch()
+{
+	cleanUp();
+}
\ No newline at end of file
@@ -0,0 +1,308 @@
+#include <svg_mesh_reader.hpp>
+
+#include <QColor>
+#include <QFile>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+namespace
+{
+	bool isSeparator(char c)
+	{
+		return c == ' ' || c == ',' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+	// reads up to max numbers from p on, stopping at anything that is not one
+	std::size_t readNumbers(const char *&p, const char *end, double *out, std::size_t max)
+	{
+		std::size_t count = 0;
+		while (count < max) {
+			while (p < end && isSeparator(*p))
+				++p;
+			const char *start = p;
+			if (p < end && *p == '+')
+				++p;
+			std::from_chars_result result = std::from_chars(p, end, out[count]);
+			if (p == end || result.ec != std::errc()) {
+				p = start;
+				break;
+			}
+			p = result.ptr;
+			++count;
+		}
+		return count;
+	}
+
+	// One edge as a Bezier path from start: "c" or "C" with three points, or
+	// "l" or "L" with one. The edge closing the patch may leave out its last
+	// point, which is then end.
+	bool readEdge(const QByteArray &path, QPointF start, const QPointF *end, std::array<QPointF, 4> &points)
+	{
+		const char *p = path.constData(), *stop = p + path.size();
+		while (p < stop && isSeparator(*p))
+			++p;
+		if (p == stop)
+			return false;
+
+		char command = *p++;
+		bool relative = command == 'c' || command == 'l';
+		QPointF offset = relative ? start : QPointF(0.0, 0.0);
+
+		double v[6];
+		std::size_t count = readNumbers(p, stop, v, 6);
+
+		points[0] = start;
+		if (command == 'c' || command == 'C') {
+			if (count != 6 && !(count == 4 && end != nullptr))
+				return false;
+			points[1] = offset + QPointF(v[0], v[1]);
+			points[2] = offset + QPointF(v[2], v[3]);
+			points[3] = count == 6 ? offset + QPointF(v[4], v[5]) : *end;
+		} else if (command == 'l' || command == 'L') {
+			if (count != 2 && !(count == 0 && end != nullptr))
+				return false;
+			points[3] = count == 2 ? offset + QPointF(v[0], v[1]) : *end;
+			points[1] = (2.0 * points[0] + points[3]) / 3.0;
+			points[2] = (points[0] + 2.0 * points[3]) / 3.0;
+		} else {
+			return false;
+		}
+		return true;
+	}
+
+	QTransform readTransform(const QString &text)
+	{
+		QByteArray data = text.toLatin1();
+		const char *p = data.constData(), *end = p + data.size();
+
+		QTransform transform;
+		while (p < end) {
+			while (p < end && isSeparator(*p))
+				++p;
+			const char *name = p;
+			while (p < end && *p != '(')
+				++p;
+			if (p == end)
+				break;
+			QByteArray op = QByteArray(name, int(p - name)).trimmed();
+
+			++p;
+			double v[6];
+			std::size_t count = readNumbers(p, end, v, 6);
+			while (p < end && *p != ')')
+				++p;
+			if (p < end)
+				++p;
+
+			const double degrees = 3.14159265358979323846 / 180.0;
+			QTransform m;
+			if (op == "matrix" && count == 6) {
+				m = QTransform(v[0], v[1], v[2], v[3], v[4], v[5]);
+			} else if (op == "translate" && count >= 1) {
+				m.translate(v[0], count > 1 ? v[1] : 0.0);
+			} else if (op == "scale" && count >= 1) {
+				m.scale(v[0], count > 1 ? v[1] : v[0]);
+			} else if (op == "rotate" && count == 1) {
+				m.rotate(v[0]);
+			} else if (op == "rotate" && count == 3) {
+				m.translate(v[1], v[2]).rotate(v[0]).translate(-v[1], -v[2]);
+			} else if (op == "skewX" && count == 1) {
+				m.shear(std::tan(v[0] * degrees), 0.0);
+			} else if (op == "skewY" && count == 1) {
+				m.shear(0.0, std::tan(v[0] * degrees));
+			}
+
+			// the leftmost transformation is applied last
+			transform = m * transform;
+		}
+		return transform;
+	}
+
+	QVector3D readColour(const QXmlStreamAttributes &attributes)
+	{
+		QString text = attributes.value("stop-color").toString();
+
+		// the style attribute wins over the presentation attribute
+		for (const QStringRef &declaration : attributes.value("style").split(';')) {
+			int colon = declaration.indexOf(':');
+			if (colon >= 0 && declaration.left(colon).trimmed() == QLatin1String("stop-color"))
+				text = declaration.mid(colon + 1).trimmed().toString();
+		}
+
+		if (text.startsWith("rgb(")) {
+			QByteArray data = text.toLatin1();
+			const char *p = data.constData() + 4, *end = data.constData() + data.size();
+			double c[3];
+			for (unsigned int i = 0; i < 3; ++i) {
+				if (readNumbers(p, end, &c[i], 1) != 1)
+					return QVector3D(0.f, 0.f, 0.f);
+				bool percent = p < end && *p == '%';
+				c[i] = std::min(1.0, std::max(0.0, percent ? c[i] / 100.0 : c[i] / 255.0));
+				if (percent)
+					++p;
+			}
+			return QVector3D(float(c[0]), float(c[1]), float(c[2]));
+		}
+
+		// unset, currentColor and inherit end up black, the initial value
+		QColor colour(text);
+		if (!colour.isValid())
+			return QVector3D(0.f, 0.f, 0.f);
+		return QVector3D(float(colour.redF()), float(colour.greenF()), float(colour.blueF()));
+	}
+
+	std::array<QPointF, 4> reversed(const std::array<QPointF, 4> &points)
+	{
+		return { points[3], points[2], points[1], points[0] };
+	}
+}
+
+SvgMeshReader::SvgMeshReader()
+	:origin_{0.0, 0.0}, row_{-1}, column_{-1}, meshes_{0}, patches_{0}
+{ }
+
+bool SvgMeshReader::read(const QString &filename, PatchCallback onPatch)
+{
+	QFile file(filename);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+	return read(file, onPatch);
+}
+
+bool SvgMeshReader::read(QIODevice &device, PatchCallback onPatch)
+{
+	meshes_ = 0;
+	patches_ = 0;
+
+	QXmlStreamReader xml(&device);
+	bool inMesh = false, inPatch = false;
+
+	while (!xml.atEnd()) {
+		QXmlStreamReader::TokenType token = xml.readNext();
+
+		if (token == QXmlStreamReader::StartElement) {
+			QStringRef name = xml.name();
+			if (name == QLatin1String("meshgradient")) {
+				beginMesh(xml.attributes());
+				inMesh = true;
+				++meshes_;
+			} else if (!inMesh) {
+				continue;
+			} else if (name == QLatin1String("meshrow")) {
+				above_.swap(current_);
+				current_.clear();
+				++row_;
+				column_ = -1;
+			} else if (name == QLatin1String("meshpatch")) {
+				++column_;
+				stops_.clear();
+				inPatch = true;
+			} else if (name == QLatin1String("stop") && inPatch) {
+				stops_.push_back({ xml.attributes().value("path").toLatin1(), readColour(xml.attributes()) });
+			}
+		} else if (token == QXmlStreamReader::EndElement) {
+			QStringRef name = xml.name();
+			if (name == QLatin1String("meshpatch") && inPatch) {
+				inPatch = false;
+				if (!endPatch(onPatch))
+					return false;
+			} else if (name == QLatin1String("meshgradient")) {
+				inMesh = false;
+			}
+		}
+	}
+
+	return !xml.hasError();
+}
+
+void SvgMeshReader::beginMesh(const QXmlStreamAttributes &attributes)
+{
+	origin_ = QPointF(attributes.value("x").toDouble(), attributes.value("y").toDouble());
+	transform_ = readTransform(attributes.value("gradientTransform").toString());
+	row_ = -1;
+	column_ = -1;
+	above_.clear();
+	current_.clear();
+}
+
+bool SvgMeshReader::endPatch(PatchCallback &onPatch)
+{
+	// the top edge comes from the row above, the left one from the patch
+	// before; only the others have stops
+	const Edges *up = row_ > 0 && std::size_t(column_) < above_.size() ? &above_[column_] : nullptr;
+	const Edges *before = column_ > 0 ? &current_.back() : nullptr;
+	if (row_ < 0 || (row_ > 0 && up == nullptr))
+		return false;
+
+	std::size_t needed = 4 - (up != nullptr) - (before != nullptr);
+	if (stops_.size() < needed)
+		return false;
+
+	Edges e;
+	std::size_t next = 0;
+
+	// top, c0 to c1
+	if (up != nullptr) {
+		e.points[0] = reversed(up->points[2]);
+		e.colours[0] = up->colours[3];
+		e.colours[1] = up->colours[2];
+	} else {
+		QPointF start = before != nullptr ? before->points[1][0] : origin_;
+		if (!readEdge(stops_[next].path, start, nullptr, e.points[0]))
+			return false;
+		e.colours[0] = before != nullptr ? before->colours[1] : stops_[next].colour;
+		++next;
+	}
+
+	// right, c1 to c2
+	if (!readEdge(stops_[next].path, e.points[0][3], nullptr, e.points[1]))
+		return false;
+	if (up == nullptr)
+		e.colours[1] = stops_[next].colour;
+	++next;
+
+	// bottom, c2 to c3
+	const QPointF *c3 = before != nullptr ? &before->points[2][0] : nullptr;
+	if (!readEdge(stops_[next].path, e.points[1][3], c3, e.points[2]))
+		return false;
+	e.colours[2] = stops_[next].colour;
+	++next;
+
+	// left, c3 to c0
+	if (before != nullptr) {
+		e.points[3] = reversed(before->points[1]);
+		e.colours[3] = before->colours[2];
+	} else {
+		if (!readEdge(stops_[next].path, e.points[2][3], &e.points[0][0], e.points[3]))
+			return false;
+		e.colours[3] = stops_[next].colour;
+	}
+
+	current_.push_back(e);
+	onPatch(toPatch(e));
+	++patches_;
+	return true;
+}
+
+SvgMeshReader::Patch SvgMeshReader::toPatch(const Edges &edges) const
+{
+	std::array<std::array<QPointF, 4>, 4> b;
+	for (unsigned int i = 0; i < 4; ++i)
+		for (unsigned int j = 0; j < 4; ++j)
+			b[i][j] = transform_.map(edges.points[i][j]);
+
+	// the bottom and left edges run against the patch's curves
+	Patch patch;
+	PatchPose &pose = patch.pose;
+	pose[PatchPose::P0]  = b[0][0]; pose[PatchPose::P1]  = b[0][3];
+	pose[PatchPose::P2]  = b[2][3]; pose[PatchPose::P3]  = b[1][3];
+	pose[PatchPose::T01] = 3.0 * (b[0][1] - b[0][0]); pose[PatchPose::T10] = 3.0 * (b[0][3] - b[0][2]);
+	pose[PatchPose::T13] = 3.0 * (b[1][1] - b[1][0]); pose[PatchPose::T31] = 3.0 * (b[1][3] - b[1][2]);
+	pose[PatchPose::T23] = 3.0 * (b[2][2] - b[2][3]); pose[PatchPose::T32] = 3.0 * (b[2][0] - b[2][1]);
+	pose[PatchPose::T02] = 3.0 * (b[3][2] - b[3][3]); pose[PatchPose::T20] = 3.0 * (b[3][0] - b[3][1]);
+	pose[PatchPose::InnerPoint] = QPointF(0.5f, 0.5f);
+
+	patch.colours = { edges.colours[0], edges.colours[1], edges.colours[3], edges.colours[2] };
+	return patch;
+}
\ No newline at end of file
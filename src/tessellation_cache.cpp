@@ -0,0 +1,116 @@
+#include <tessellation_cache.hpp>
+
+#include <cstring>
+
+std::mutex TessellationCache::mutex_;
+std::list<TessellationCache::Entry> TessellationCache::entries_;
+std::unordered_map<TessellationCache::Key, std::list<TessellationCache::Entry>::iterator, TessellationCache::KeyHash> TessellationCache::index_;
+std::size_t TessellationCache::capacity_ = std::size_t(32) << 20;
+TessellationCache::Stats TessellationCache::stats_;
+
+namespace
+{
+	// 64 bit FNV-1a, one word at a time
+	const std::uint64_t HashBasis = 14695981039346656037ull;
+	const std::uint64_t HashPrime = 1099511628211ull;
+}
+
+TessellationCache::Key::Key(unsigned int kind)
+	:hash_{std::size_t(HashBasis)}
+{
+	words_.reserve(48);
+	add(kind);
+}
+
+TessellationCache::Key &TessellationCache::Key::add(unsigned int value)
+{
+	words_.push_back(std::uint32_t(value));
+	hash_ = std::size_t((std::uint64_t(hash_) ^ value) * HashPrime);
+	return *this;
+}
+
+TessellationCache::Key &TessellationCache::Key::add(float value)
+{
+	std::uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return add(unsigned(bits));
+}
+
+TessellationCache::Key &TessellationCache::Key::add(double value)
+{
+	std::uint32_t bits[2];
+	std::memcpy(bits, &value, sizeof(bits));
+	return add(unsigned(bits[0])).add(unsigned(bits[1]));
+}
+
+TessellationCache::Block TessellationCache::get(const Key &key, const std::function<std::vector<float>()> &compute)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto found = index_.find(key);
+		if (found != index_.end()) {
+			entries_.splice(entries_.begin(), entries_, found->second);
+			++stats_.hits;
+			return found->second->second;
+		}
+		++stats_.misses;
+	}
+
+	Block block = std::make_shared<const std::vector<float>>(compute());
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	// another thread may have computed the same block meanwhile
+	if (index_.count(key) != 0)
+		return block;
+
+	entries_.emplace_front(key, block);
+	index_.emplace(key, entries_.begin());
+	++stats_.blocks;
+	stats_.bytes += bytes(entries_.front());
+	evict();
+	return block;
+}
+
+std::size_t TessellationCache::capacity()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return capacity_;
+}
+
+void TessellationCache::setCapacity(std::size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	capacity_ = bytes;
+	evict();
+}
+
+TessellationCache::Stats TessellationCache::stats()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return stats_;
+}
+
+void TessellationCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	index_.clear();
+	entries_.clear();
+	stats_ = Stats();
+}
+
+std::size_t TessellationCache::bytes(const Entry &entry)
+{
+	return entry.first.size() * sizeof(std::uint32_t) + entry.second->size() * sizeof(float);
+}
+
+void TessellationCache::evict()
+{
+	while (stats_.bytes > capacity_ && !entries_.empty()) {
+		const Entry &last = entries_.back();
+		stats_.bytes -= bytes(last);
+		--stats_.blocks;
+		++stats_.evictions;
+		index_.erase(last.first);
+		entries_.pop_back();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include <tiled_exporter.hpp>
+#include <ferguson_canvas.hpp>
+#include <png_stream_writer.hpp>
+
+#include <QDebug>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions>
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+	// upper bound of the samples read back at once
+	const std::size_t ReadbackBytes = 4 << 20;
+}
+
+TiledExporter::TiledExporter(FergusonCanvas *canvas, QSize size, int supersampling, int tileSize)
+	:canvas_{canvas}, size_{size}, supersampling_{std::max(1, supersampling)}, tileSize_{std::max(1, tileSize)}
+{ }
+
+bool TiledExporter::write(const QString &filename)
+{
+	QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+
+	const int ss = supersampling_;
+	const int width = size_.width();
+	const int height = size_.height();
+
+	// the tile shrinks to what the driver can render into in one piece
+	GLint maxRenderbuffer = 0, maxTexture = 0;
+	f->glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxRenderbuffer);
+	f->glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexture);
+	const int tileSize = std::min(tileSize_, std::min(maxRenderbuffer, maxTexture) / ss);
+	if (tileSize < 1) {
+		qWarning() << "TiledExporter: supersampling" << ss << "exceeds the framebuffer size limit";
+		return false;
+	}
+
+	QOpenGLFramebufferObjectFormat format;
+	format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+	QOpenGLFramebufferObject fbo(tileSize * ss, tileSize * ss, format);
+	if (!fbo.isValid())
+		return false;
+
+	// only now, a failed export leaves an existing file alone
+	PngStreamWriter png;
+	if (!png.open(filename, width, height))
+		return false;
+
+	// lines keep their on-screen width relative to the image
+	float pixelScale = float(width) / float(canvas_->width()) * float(ss);
+
+	// samples are read back a few output rows at a time rather than a tile at once
+	const std::size_t rowSamples = std::size_t(tileSize) * ss * ss * 4;
+	const int readRows = int(std::max<std::size_t>(1, ReadbackBytes / rowSamples));
+	std::vector<unsigned char> band(std::size_t(width) * tileSize * 3);
+	std::vector<unsigned char> samples(rowSamples * std::min(readRows, tileSize));
+
+	fbo.bind();
+	f->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+	bool ok = true;
+	for (int y0 = 0; y0 < height && ok; y0 += tileSize) {
+		int th = std::min(tileSize, height - y0);
+
+		for (int x0 = 0; x0 < width; x0 += tileSize) {
+			int tw = std::min(tileSize, width - x0);
+
+			// NDC has y up, image rows go down
+			QRectF region(
+				-1.f + 2.f * x0 / width, 1.f - 2.f * (y0 + th) / height,
+				2.f * tw / width, 2.f * th / height);
+			canvas_->renderRegion(region, QSize(tw * ss, th * ss), pixelScale);
+
+			const int stride = tw * ss * 4;
+			for (int r0 = 0; r0 < th; r0 += readRows) {
+				// output rows [r0, r1) are sample rows from (th - r1) * ss up
+				int r1 = std::min(th, r0 + readRows);
+				f->glReadPixels(0, (th - r1) * ss, tw * ss, (r1 - r0) * ss, GL_RGBA, GL_UNSIGNED_BYTE, samples.data());
+
+				// box filter the samples of each pixel, flipping rows on the way
+				for (int r = r0; r < r1; ++r) {
+					unsigned char *out = &band[(std::size_t(r) * width + x0) * 3];
+					for (int c = 0; c < tw; ++c) {
+						unsigned int sum[3] = { 0, 0, 0 };
+						for (int dy = 0; dy < ss; ++dy) {
+							const unsigned char *in = &samples[std::size_t((r1 - 1 - r) * ss + dy) * stride + c * ss * 4];
+							for (int dx = 0; dx < ss; ++dx, in += 4) {
+								sum[0] += in[0];
+								sum[1] += in[1];
+								sum[2] += in[2];
+							}
+						}
+
+						const unsigned int n = ss * ss;
+						for (int k = 0; k < 3; ++k)
+							out[3*c + k] = (unsigned char)((sum[k] + n / 2) / n);
+					}
+				}
+			}
+		}
+
+		ok = png.writeRows(band.data(), th);
+	}
+
+	fbo.release();
+	return png.close() && ok;
+}
\ No newline at end of file
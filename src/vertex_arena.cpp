@@ -0,0 +1,175 @@
+#include <vertex_arena.hpp>
+#include <vertex_quantiser.hpp>
+
+#include <QOpenGLContext>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+
+namespace
+{
+	// enough for a few patches before the first doubling
+	const GLsizei InitialCapacity = 1 << 14;
+}
+
+VertexArena::VertexArena(Format format)
+	:format_{format}, gl_{nullptr}, vbo_{QOpenGLBuffer::VertexBuffer}, capacity_{0}
+{ }
+
+std::size_t VertexArena::vertexSize() const
+{
+	switch (format_) {
+	case ColouredPosition:       return 5 * sizeof(float);
+	case PackedPosition:         return 2 * sizeof(GLshort);
+	case PackedColouredPosition: return sizeof(PackedColourVertex);
+	default:                     return 2 * sizeof(float);
+	}
+}
+
+void VertexArena::create()
+{
+	gl_ = QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_3_2_Core>();
+	gl_->initializeOpenGLFunctions();
+
+	vao_.create();
+	capacity_ = 0;
+	free_.clear();
+	grow(InitialCapacity);
+}
+
+void VertexArena::destroy()
+{
+	vao_.destroy();
+	vbo_.destroy();
+	capacity_ = 0;
+	free_.clear();
+}
+
+bool VertexArena::resize(Range &range, GLsizei count)
+{
+	if (count <= range.capacity) {
+		range.count = count;
+		return false;
+	}
+
+	GLsizei capacity = std::max(count, 2 * range.capacity);
+	if (range.capacity > 0)
+		release(range.first, range.capacity);
+	range.first = allocate(capacity);
+	range.count = count;
+	range.capacity = capacity;
+	return true;
+}
+
+void VertexArena::free(Range &range)
+{
+	// ranges outliving the buffer went with it
+	if (isCreated() && range.capacity > 0)
+		release(range.first, range.capacity);
+	range = Range();
+}
+
+void VertexArena::write(const Range &range, std::size_t offset, const void *data, std::size_t bytes)
+{
+	vbo_.bind();
+	vbo_.write(int(range.first * vertexSize() + offset), data, int(bytes));
+	vbo_.release();
+}
+
+GLint VertexArena::allocate(GLsizei count)
+{
+	for (auto it = free_.begin(); it != free_.end(); ++it) {
+		if (it->second < count)
+			continue;
+
+		GLint first = it->first;
+		GLsizei rest = it->second - count;
+		free_.erase(it);
+		if (rest > 0)
+			free_.emplace(first + count, rest);
+		return first;
+	}
+
+	// the new space joins the free range at the end, if any
+	grow(count);
+	return allocate(count);
+}
+
+void VertexArena::release(GLint first, GLsizei count)
+{
+	auto next = free_.lower_bound(first);
+	if (next != free_.end() && first + count == next->first) {
+		count += next->second;
+		next = free_.erase(next);
+	}
+
+	if (next != free_.begin()) {
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == first) {
+			previous->second += count;
+			return;
+		}
+	}
+
+	free_.emplace(first, count);
+}
+
+void VertexArena::grow(GLsizei count)
+{
+	GLsizei capacity = std::max(2 * capacity_, capacity_ + count);
+	std::size_t size = vertexSize();
+
+	QOpenGLBuffer grown(QOpenGLBuffer::VertexBuffer);
+	grown.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+	grown.create();
+	grown.bind();
+	grown.allocate(int(capacity * size));
+
+	// ranges already handed out keep their place
+	if (capacity_ > 0) {
+		gl_->glBindBuffer(GL_COPY_READ_BUFFER, vbo_.bufferId());
+		gl_->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_ARRAY_BUFFER, 0, 0, GLsizeiptr(capacity_ * size));
+		gl_->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	}
+	grown.release();
+
+	vbo_.destroy();
+	vbo_ = grown;
+	release(capacity_, capacity - capacity_);
+	capacity_ = capacity;
+
+	setupAttributes();
+}
+
+void VertexArena::setupAttributes()
+{
+	// the attribute pointers refer to the buffer, so they follow it
+	QOpenGLVertexArrayObject::Binder vaoBinder(&vao_);
+	vbo_.bind();
+
+	GLsizei stride = GLsizei(vertexSize());
+	gl_->glEnableVertexAttribArray(0);
+
+	switch (format_) {
+	case Position:
+		gl_->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, nullptr);
+		break;
+	case ColouredPosition:
+		gl_->glEnableVertexAttribArray(1);
+		gl_->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, nullptr);
+		gl_->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride,
+			reinterpret_cast<void*>(2*sizeof(float)));
+		break;
+	case PackedPosition:
+		gl_->glVertexAttribPointer(0, 2, GL_SHORT, GL_TRUE, stride, nullptr);
+		break;
+	case PackedColouredPosition:
+		gl_->glEnableVertexAttribArray(1);
+		gl_->glVertexAttribPointer(0, 2, GL_SHORT, GL_TRUE, stride, nullptr);
+		gl_->glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+			reinterpret_cast<void*>(offsetof(PackedColourVertex, colour)));
+		break;
+	default:
+		break;
+	}
+}
\ No newline at end of file
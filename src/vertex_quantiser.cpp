@@ -0,0 +1,47 @@
+#include <vertex_quantiser.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+VertexQuantiser::VertexQuantiser(const float *vertices, std::size_t count, std::size_t stride)
+{
+	float lower[2] = {  std::numeric_limits<float>::max(),  std::numeric_limits<float>::max() };
+	float upper[2] = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+
+	for (std::size_t i = 0; i < count; ++i) {
+		const float *p = vertices + i*stride;
+		for (unsigned int k = 0; k < 2; ++k) {
+			lower[k] = std::min(lower[k], p[k]);
+			upper[k] = std::max(upper[k], p[k]);
+		}
+	}
+
+	if (count == 0) {
+		offset_ = QVector2D(0.f, 0.f);
+		scale_ = QVector2D(1.f, 1.f);
+		return;
+	}
+
+	// half extents, kept away from zero for degenerate boxes
+	offset_ = QVector2D(0.5f * (lower[0] + upper[0]), 0.5f * (lower[1] + upper[1]));
+	scale_ = QVector2D(
+		std::max(0.5f * (upper[0] - lower[0]), 1e-6f),
+		std::max(0.5f * (upper[1] - lower[1]), 1e-6f));
+}
+
+void VertexQuantiser::position(const float *p, GLshort *q) const
+{
+	for (unsigned int k = 0; k < 2; ++k) {
+		float n = (p[k] - offset_[k]) / scale_[k];
+		n = std::min(1.f, std::max(-1.f, n));
+		q[k] = GLshort(std::lround(n * 32767.f));
+	}
+}
+
+void VertexQuantiser::colour(const float *c, GLubyte *q)
+{
+	for (unsigned int k = 0; k < 3; ++k)
+		q[k] = GLubyte(std::lround(std::min(1.f, std::max(0.f, c[k])) * 255.f));
+	q[3] = 255;
+}
\ No newline at end of file
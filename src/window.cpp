@@ -2,15 +2,21 @@
 #include <renderer.hpp>
 #include <inner_point_control.hpp>
 #include <ferguson_control.hpp>
+#include <animation_control.hpp>
 
 #include <QGridLayout>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
+#include <algorithm>
 #include <memory>
 
 #include <QFileDialog>
 #include <QDir>
 #include <QMessageBox>
+#include <QInputDialog>
+#include <QApplication>
+#include <QProgressDialog>
+#include <QStatusBar>
 
 MainWidget::MainWidget()
 {
@@ -18,28 +24,202 @@ MainWidget::MainWidget()
 	renderer_ = new Renderer(this);
 	InnerPointControl *innerPointControl = new InnerPointControl(this, renderer_);
 	FergusonControl *fergusonControl = new FergusonControl(this, renderer_);
+	AnimationControl *animationControl = new AnimationControl(this, renderer_);
 
 	QGridLayout *layout = new QGridLayout();
 	QVBoxLayout *controlLayout = new QVBoxLayout();
 	controlLayout->addWidget(fergusonControl);
 	controlLayout->addWidget(innerPointControl);
+	controlLayout->addWidget(animationControl);
 	controlLayout->setAlignment(Qt::AlignTop);
 	controlLayout->addStretch(0);
 	layout->addLayout(controlLayout, 0, 0);
 	layout->addWidget(renderer_, 0, 1);
 
 	setLayout(layout);
+
+	renderer_->onCaptureDone([this](const QString &filename, bool ok) {
+		if (ok)
+			return;
+		// a sequence would keep failing on every frame
+		renderer_->stopImageSequence();
+		QMessageBox::warning(this, tr("Save Image"), tr("Error saving image %1").arg(filename));
+	});
 }
 
 void MainWidget::save()
 {
 	QString filename = QFileDialog::getSaveFileName(this, tr("Save File"), 
 		QDir::currentPath(), tr("PNG (*.png);;JPEG (*.jpg, *.jpeg)")); 
-	
-	if (!renderer_->save(filename))
-		QMessageBox::warning(this, tr("Save Image"), tr("Error saving image"));
+	if (filename.isEmpty())
+		return;
+
+	// errors are reported once the image has been encoded
+	renderer_->save(filename);
+}
+
+bool MainWidget::recordSequence(bool record)
+{
+	if (!record) {
+		renderer_->stopImageSequence();
+		return true;
+	}
+
+	QString directory = QFileDialog::getExistingDirectory(this, tr("Record Image Sequence"), 
+		QDir::currentPath());
+	if (directory.isEmpty())
+		return false;
+
+	renderer_->startImageSequence(directory);
+	return true;
+}
+
+void MainWidget::exportImage()
+{
+	QString filename = QFileDialog::getSaveFileName(this, tr("Export Image"), 
+		QDir::currentPath(), tr("PNG (*.png)"));
+	if (filename.isEmpty())
+		return;
+
+	bool ok;
+	int width = QInputDialog::getInt(this, tr("Export Image"), tr("Width in pixels:"), 
+		4096, 1, 1 << 20, 1, &ok);
+	if (!ok)
+		return;
+
+	int supersampling = QInputDialog::getInt(this, tr("Export Image"), tr("Samples per pixel side:"), 
+		2, 1, 8, 1, &ok);
+	if (!ok)
+		return;
+
+	int height = int(qint64(width) * renderer_->height() / renderer_->width());
+	if (!renderer_->exportImage(filename, QSize(width, std::max(1, height)), supersampling))
+		QMessageBox::warning(this, tr("Export Image"), tr("Error exporting image"));
+}
+
+void MainWidget::renderAnimation()
+{
+	if (renderer_->animation().empty()) {
+		QMessageBox::information(this, tr("Render Animation"), tr("Set at least one key first"));
+		return;
+	}
+
+	QString directory = QFileDialog::getExistingDirectory(this, tr("Render Animation"), 
+		QDir::currentPath());
+	if (directory.isEmpty())
+		return;
+
+	bool ok;
+	int width = QInputDialog::getInt(this, tr("Render Animation"), tr("Width in pixels:"), 
+		1920, 1, 16384, 1, &ok);
+	if (!ok)
+		return;
+
+	double fps = QInputDialog::getDouble(this, tr("Render Animation"), tr("Frames per second:"), 
+		30.0, 1.0, 240.0, 2, &ok);
+	if (!ok)
+		return;
+
+	renderer_->pause();
+	int height = int(qint64(width) * renderer_->height() / renderer_->width());
+
+	QApplication::setOverrideCursor(Qt::WaitCursor);
+	ok = renderer_->renderAnimation(directory, QSize(width, std::max(1, height)), float(fps));
+	QApplication::restoreOverrideCursor();
+
+	if (!ok)
+		QMessageBox::warning(this, tr("Render Animation"), tr("Error rendering animation"));
 }
 
+void MainWidget::warpImage()
+{
+	QString input = QFileDialog::getOpenFileName(this, tr("Warp Image"), 
+		QDir::currentPath(), tr("Images (*.png *.jpg *.jpeg *.bmp *.tif *.tiff)"));
+	if (input.isEmpty())
+		return;
+
+	QString output = QFileDialog::getSaveFileName(this, tr("Warp Image"), 
+		QDir::currentPath(), tr("PNG (*.png)"));
+	if (output.isEmpty())
+		return;
+
+	QApplication::setOverrideCursor(Qt::WaitCursor);
+	bool ok = renderer_->warpImage(input, output);
+	QApplication::restoreOverrideCursor();
+
+	if (!ok)
+		QMessageBox::warning(this, tr("Warp Image"), tr("Error warping image"));
+}
+
+void MainWidget::fitImage()
+{
+	QString input = QFileDialog::getOpenFileName(this, tr("Fit to Image"), 
+		QDir::currentPath(), tr("Images (*.png *.jpg *.jpeg *.bmp *.tif *.tiff)"));
+	if (input.isEmpty())
+		return;
+
+	bool ok;
+	int patches = QInputDialog::getInt(this, tr("Fit to Image"), tr("Patches per side:"), 
+		16, 1, 256, 1, &ok);
+	if (!ok)
+		return;
+
+	int iterations = QInputDialog::getInt(this, tr("Fit to Image"), tr("Iterations:"), 
+		20, 1, 1000, 1, &ok);
+	if (!ok)
+		return;
+
+	QProgressDialog progress(tr("Fitting the mesh..."), tr("Stop"), 0, iterations, this);
+	progress.setWindowModality(Qt::WindowModal);
+	progress.setMinimumDuration(0);
+
+	// the fit runs on this thread, the dialog is kept alive between iterations
+	ok = renderer_->fitImage(input, unsigned(patches), unsigned(iterations),
+		[&](const MeshFitter::Progress &p) {
+			progress.setValue(int(p.iteration));
+			progress.setLabelText(tr("Iteration %1, error %2").arg(p.iteration).arg(p.error, 0, 'f', 4));
+			QApplication::processEvents();
+			return !progress.wasCanceled();
+		});
+	progress.reset();
+
+	if (!ok)
+		QMessageBox::warning(this, tr("Fit to Image"), tr("Error reading image"));
+}
+
+void MainWidget::importSvg()
+{
+	QString input = QFileDialog::getOpenFileName(this, tr("Import SVG Mesh"), 
+		QDir::currentPath(), tr("SVG (*.svg)"));
+	if (input.isEmpty())
+		return;
+
+	QApplication::setOverrideCursor(Qt::WaitCursor);
+	bool ok = renderer_->importSvg(input);
+	QApplication::restoreOverrideCursor();
+
+	if (!ok)
+		QMessageBox::warning(this, tr("Import SVG Mesh"), tr("No mesh gradient could be read"));
+}
+
+bool MainWidget::watchSvg(bool watch)
+{
+	if (!watch) {
+		renderer_->stopWatchingSvg();
+		return true;
+	}
+
+	QString input = QFileDialog::getOpenFileName(this, tr("Watch SVG Mesh"), 
+		QDir::currentPath(), tr("SVG (*.svg)"));
+	if (input.isEmpty())
+		return false;
+
+	if (!renderer_->watchSvg(input)) {
+		QMessageBox::warning(this, tr("Watch SVG Mesh"), tr("No mesh gradient could be read"));
+		return false;
+	}
+	return true;
+}
 
 Window::Window()
 {
@@ -51,12 +231,106 @@ Window::Window()
 	saveAct_->setStatusTip(tr("Save canvas into a file"));
 	connect(saveAct_, &QAction::triggered, this, &Window::save);
 
+	exportAct_ = new QAction(tr("&Export..."), this);
+	exportAct_->setStatusTip(tr("Render the canvas at any size into a PNG file"));
+	connect(exportAct_, &QAction::triggered, this, &Window::exportImage);
+
+	sequenceAct_ = new QAction(tr("&Record Image Sequence..."), this);
+	sequenceAct_->setCheckable(true);
+	sequenceAct_->setStatusTip(tr("Save every frame into a directory while checked"));
+	connect(sequenceAct_, &QAction::triggered, this, &Window::recordSequence);
+
+	animationAct_ = new QAction(tr("Render &Animation..."), this);
+	animationAct_->setStatusTip(tr("Render every frame of the animation into a directory"));
+	connect(animationAct_, &QAction::triggered, this, &Window::renderAnimation);
+
+	warpAct_ = new QAction(tr("&Warp Image..."), this);
+	warpAct_->setStatusTip(tr("Map an image through the patch"));
+	connect(warpAct_, &QAction::triggered, this, &Window::warpImage);
+
+	fitAct_ = new QAction(tr("&Fit to Image..."), this);
+	fitAct_->setStatusTip(tr("Replace the patch with a mesh fitted to an image"));
+	connect(fitAct_, &QAction::triggered, this, &Window::fitImage);
+
+	svgAct_ = new QAction(tr("&Import SVG Mesh..."), this);
+	svgAct_->setStatusTip(tr("Replace the patch with the mesh gradients of an SVG file"));
+	connect(svgAct_, &QAction::triggered, this, &Window::importSvg);
+
+	watchAct_ = new QAction(tr("W&atch SVG Mesh..."), this);
+	watchAct_->setCheckable(true);
+	watchAct_->setStatusTip(tr("Show the mesh gradients of an SVG file and follow its changes while checked"));
+	connect(watchAct_, &QAction::triggered, this, &Window::watchSvg);
+
+	renderer()->onSceneReloaded([this](const SceneDiff &diff) {
+		statusBar()->showMessage(tr("Reloaded: %1 moved, %2 recoloured, %3 added, %4 removed, %5 unchanged")
+			.arg(diff.moved).arg(diff.recoloured).arg(diff.added).arg(diff.removed).arg(diff.unchanged), 5000);
+	});
+
 	fileMenu_ = menuBar()->addMenu(tr("&File"));
 	fileMenu_->addAction(saveAct_);
+	fileMenu_->addAction(exportAct_);
+	fileMenu_->addAction(sequenceAct_);
+	fileMenu_->addAction(animationAct_);
+	fileMenu_->addAction(warpAct_);
+	fileMenu_->addAction(fitAct_);
+	fileMenu_->addAction(svgAct_);
+	fileMenu_->addAction(watchAct_);
 }
 
 void Window::save()
 {
 	MainWidget *w = dynamic_cast<MainWidget*>(centralWidget());
 	w->save();
+}
+
+void Window::exportImage()
+{
+	MainWidget *w = dynamic_cast<MainWidget*>(centralWidget());
+	w->exportImage();
+}
+
+void Window::recordSequence(bool record)
+{
+	MainWidget *w = dynamic_cast<MainWidget*>(centralWidget());
+	if (!w->recordSequence(record))
+		sequenceAct_->setChecked(false);
+}
+
+void Window::renderAnimation()
+{
+	MainWidget *w = dynamic_cast<MainWidget*>(centralWidget());
+	w->renderAnimation();
+}
+
+void Window::warpImage()
+{
+	MainWidget *w = dynamic_cast<MainWidget*>(centralWidget());
+	w->warpImage();
+}
+
+void Window::fitImage()
+{
+	MainWidget *w = dynamic_cast<MainWidget*>(centralWidget());
+	w->fitImage();
+	watchAct_->setChecked(renderer()->watchingSvg());
+}
+
+void Window::importSvg()
+{
+	MainWidget *w = dynamic_cast<MainWidget*>(centralWidget());
+	w->importSvg();
+	watchAct_->setChecked(renderer()->watchingSvg());
+}
+
+void Window::watchSvg(bool watch)
+{
+	MainWidget *w = dynamic_cast<MainWidget*>(centralWidget());
+	if (!w->watchSvg(watch))
+		watchAct_->setChecked(false);
+}
+
+Renderer *Window::renderer() const
+{
+	MainWidget *w = dynamic_cast<MainWidget*>(centralWidget());
+	return w->renderer();
 }
\ No newline at end of file